@@ -0,0 +1,98 @@
+#define BOOST_TEST_MODULE BatchedSolve
+#include <boost/test/unit_test.hpp>
+#include <vexcl/vector.hpp>
+#include <vexcl/dynamic_multivector.hpp>
+#include <vexcl/batched.hpp>
+#include "context_setup.hpp"
+
+// Fills a batch of matrices stored by components (the k-th component starts
+// at k * nsys). Matrices are diagonally dominant; with swap_rows set the
+// first two rows are swapped, so that LU needs pivoting.
+inline std::vector<double> random_batch(size_t nsys, size_t N, bool symmetric, bool swap_rows) {
+    std::vector<double> a(nsys * N * N);
+    std::vector<double> r = random_vector<double>(nsys * N * N);
+
+    for(size_t s = 0; s < nsys; ++s) {
+        for(size_t i = 0; i < N; ++i) {
+            for(size_t j = 0; j < N; ++j) {
+                double v = symmetric
+                    ? r[(std::min(i, j) * N + std::max(i, j)) * nsys + s]
+                    : r[(i * N + j) * nsys + s];
+                if (i == j) v += N;
+
+                size_t row = i;
+                if (swap_rows && i < 2) row = 1 - i;
+
+                a[(row * N + j) * nsys + s] = v;
+            }
+        }
+    }
+
+    return a;
+}
+
+// b = A x on the host, both stored by components.
+inline std::vector<double> host_product(const std::vector<double> &a,
+        const std::vector<double> &x, size_t nsys, size_t N)
+{
+    std::vector<double> b(nsys * N, 0.0);
+    for(size_t s = 0; s < nsys; ++s)
+        for(size_t i = 0; i < N; ++i)
+            for(size_t j = 0; j < N; ++j)
+                b[i * nsys + s] += a[(i * N + j) * nsys + s] * x[j * nsys + s];
+    return b;
+}
+
+BOOST_AUTO_TEST_CASE(batched_lu)
+{
+    const size_t nsys = 1000;
+    const size_t sizes[] = {4, 7};
+
+    vex::layout layouts[] = {vex::layout::soa, vex::layout::aos};
+
+    for(int k = 0; k < 2; ++k) {
+        const size_t N = sizes[k];
+
+        std::vector<double> a = random_batch(nsys, N, false, true);
+        std::vector<double> x = random_vector<double>(nsys * N);
+        std::vector<double> b = host_product(a, x, nsys, N);
+
+        for(int l = 0; l < 2; ++l) {
+            vex::dynamic_multivector<double> A(ctx, nsys, N * N, a.data(), layouts[l]);
+            vex::dynamic_multivector<double> X(ctx, nsys, N, b.data(), layouts[1 - l]);
+
+            vex::batched_lu<double> lu(A);
+            lu.solve(X);
+
+            for(size_t s = 0; s < SAMPLE_SIZE; ++s) {
+                size_t i = rand() % nsys;
+                for(size_t j = 0; j < N; ++j)
+                    BOOST_CHECK_CLOSE(static_cast<double>(X(i, j)), x[j * nsys + i], 1e-6);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(batched_cholesky)
+{
+    const size_t nsys = 1000;
+    const size_t N    = 5;
+
+    std::vector<double> a = random_batch(nsys, N, true, false);
+    std::vector<double> x = random_vector<double>(nsys * N);
+    std::vector<double> b = host_product(a, x, nsys, N);
+
+    vex::dynamic_multivector<double> A(ctx, nsys, N * N, a.data());
+    vex::dynamic_multivector<double> X(ctx, nsys, N, b.data(), vex::layout::aos);
+
+    vex::batched_cholesky<double> chol(A);
+    chol.solve(X);
+
+    for(size_t s = 0; s < SAMPLE_SIZE; ++s) {
+        size_t i = rand() % nsys;
+        for(size_t j = 0; j < N; ++j)
+            BOOST_CHECK_CLOSE(static_cast<double>(X(i, j)), x[j * nsys + i], 1e-6);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,6 +2,8 @@
 #include <boost/test/unit_test.hpp>
 #include <vexcl/devlist.hpp>
 #include <vexcl/vector.hpp>
+#include <vexcl/spmat.hpp>
+#include <vexcl/stencil.hpp>
 
 void local_context() {
 #ifdef VEXCL_BACKEND_OPENCL
@@ -29,3 +31,97 @@ BOOST_AUTO_TEST_CASE(create_destroy)
     local_context();
     local_context();
 }
+
+#if defined(VEXCL_BACKEND_OPENCL) && defined(CL_VERSION_1_2)
+BOOST_AUTO_TEST_CASE(device_fission)
+{
+    vex::Context ctx( vex::Filter::Env, 0, false,
+            CL_DEVICE_AFFINITY_DOMAIN_NEXT_PARTITIONABLE );
+
+    BOOST_CHECK( !ctx.empty() );
+
+    const size_t n = 1024;
+
+    std::vector<int> host(n);
+    for(size_t i = 0; i < n; i++) host[i] = static_cast<int>(i);
+
+    vex::vector<int> x(ctx, host);
+    vex::vector<int> y(ctx, n);
+
+    y = 2 * x;
+
+    vex::copy(y, host);
+    for(size_t i = 0; i < n; i++)
+        BOOST_CHECK_EQUAL(host[i], static_cast<int>(2 * i));
+
+    vex::purge_kernel_caches(ctx);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(shared_context)
+{
+    vex::Context ctx( vex::Filter::Env, 0, /*shared_context=*/true );
+
+    BOOST_CHECK( !ctx.empty() );
+
+    const size_t n = 1024;
+
+    // Ghost values in SpMV and halos in stencil convolution are exchanged
+    // directly between devices here.
+    std::vector<size_t> row;
+    std::vector<int>    col;
+    std::vector<double> val;
+
+    row.push_back(0);
+    for(size_t i = 0; i < n; i++) {
+        if (i > 0) {
+            col.push_back(static_cast<int>(i - 1));
+            val.push_back(-1);
+        }
+
+        col.push_back(static_cast<int>(i));
+        val.push_back(2);
+
+        if (i + 1 < n) {
+            col.push_back(static_cast<int>(i + 1));
+            val.push_back(-1);
+        }
+
+        row.push_back(col.size());
+    }
+
+    std::vector<double> x(n);
+    for(size_t i = 0; i < n; i++) x[i] = static_cast<double>(i * i);
+
+    vex::SpMat<double, int, size_t> A(ctx, n, n, row.data(), col.data(), val.data());
+
+    std::vector<double> s = {-1, 2, -1};
+    vex::stencil<double> S(ctx, s, 1);
+
+    vex::vector<double> X(ctx, x);
+    vex::vector<double> Y(ctx, n);
+    vex::vector<double> Z(ctx, n);
+
+    Y = A * X;
+    Z = X * S;
+
+    std::vector<double> y(n), z(n);
+    vex::copy(Y, y);
+    vex::copy(Z, z);
+
+    for(size_t i = 0; i < n; i++) {
+        double sum_y = 2 * x[i];
+        double sum_z = 2 * x[i];
+
+        sum_y -= (i > 0     ? x[i-1] : 0);
+        sum_y -= (i + 1 < n ? x[i+1] : 0);
+
+        sum_z -= x[i > 0 ? i - 1 : 0];
+        sum_z -= x[i + 1 < n ? i + 1 : n - 1];
+
+        BOOST_CHECK_CLOSE(y[i], sum_y, 1e-8);
+        BOOST_CHECK_CLOSE(z[i], sum_z, 1e-8);
+    }
+
+    vex::purge_kernel_caches(ctx);
+}
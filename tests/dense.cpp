@@ -0,0 +1,125 @@
+#define BOOST_TEST_MODULE DenseMatrix
+#include <boost/test/unit_test.hpp>
+#include <vexcl/vector.hpp>
+#include <vexcl/dynamic_multivector.hpp>
+#include <vexcl/dense.hpp>
+#include "context_setup.hpp"
+
+// Host element of n x m matrix stored in the given order.
+inline double host_element(const std::vector<double> &a,
+        size_t n, size_t m, vex::matrix_order ord, size_t i, size_t j)
+{
+    return ord == vex::matrix_order::row_major ? a[i * m + j] : a[j * n + i];
+}
+
+BOOST_AUTO_TEST_CASE(matrix_vector_product)
+{
+    const size_t n = 1000;
+    const size_t m = 321;
+
+    std::vector<double> a = random_vector<double>(n * m);
+    std::vector<double> x = random_vector<double>(m);
+
+    vex::matrix_order orders[] = {vex::matrix_order::row_major, vex::matrix_order::col_major};
+
+    for(int o = 0; o < 2; ++o) {
+        vex::dense_matrix<double> A(ctx, n, m, a.data(), orders[o]);
+
+        std::vector<double> back(n * m);
+        A.read(back.data());
+        BOOST_CHECK(a == back);
+
+        vex::vector<double> X(ctx, x);
+        vex::vector<double> Y(ctx, n);
+
+        Y = 1;
+        Y += 2 * (A * X);
+
+        check_sample(Y, [&](size_t i, double v) {
+                double sum = 1;
+                for(size_t j = 0; j < m; ++j)
+                    sum += 2 * host_element(a, n, m, orders[o], i, j) * x[j];
+                BOOST_CHECK_CLOSE(v, sum, 1e-8);
+                });
+    }
+}
+
+BOOST_AUTO_TEST_CASE(matrix_matrix_product)
+{
+    const size_t n = 300;
+    const size_t k = 45;
+    const size_t p = 37;
+
+    std::vector<double> a = random_vector<double>(n * k);
+    std::vector<double> b = random_vector<double>(k * p);
+    std::vector<double> c = random_vector<double>(n * p);
+
+    vex::matrix_order orders[] = {vex::matrix_order::row_major, vex::matrix_order::col_major};
+
+    for(int oa = 0; oa < 2; ++oa) {
+        for(int ob = 0; ob < 2; ++ob) {
+            vex::dense_matrix<double> A(ctx, n, k, a.data(), orders[oa]);
+            vex::dense_matrix<double> B(ctx, k, p, b.data(), orders[ob]);
+            vex::dense_matrix<double> C(ctx, n, p, c.data(), orders[1 - oa]);
+
+            vex::gemm(A, B, C, 2.0, 1.0);
+
+            std::vector<double> res(n * p);
+            C.read(res.data());
+
+            for(size_t s = 0; s < SAMPLE_SIZE; ++s) {
+                size_t i = rand() % n;
+                size_t j = rand() % p;
+
+                double sum = host_element(c, n, p, orders[1 - oa], i, j);
+                for(size_t l = 0; l < k; ++l)
+                    sum += 2 * host_element(a, n, k, orders[oa], i, l)
+                             * host_element(b, k, p, orders[ob], l, j);
+
+                BOOST_CHECK_CLOSE(host_element(res, n, p, orders[1 - oa], i, j), sum, 1e-8);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(block_orthogonalization)
+{
+    const size_t n = 1024;
+    const size_t m = 4;
+    const size_t p = 3;
+
+    std::vector<double> q = random_vector<double>(n * m);
+    std::vector<double> v = random_vector<double>(n * p);
+
+    vex::layout layouts[] = {vex::layout::soa, vex::layout::aos};
+
+    for(int l = 0; l < 2; ++l) {
+        vex::dynamic_multivector<double> Q(ctx, n, m, q.data(), layouts[l]);
+        vex::dynamic_multivector<double> V(ctx, n, p, v.data(), layouts[1 - l]);
+
+        std::vector<double> S = vex::block_dot(Q, V);
+
+        BOOST_REQUIRE_EQUAL(S.size(), m * p);
+
+        for(size_t a = 0; a < m; ++a) {
+            for(size_t b = 0; b < p; ++b) {
+                double sum = 0;
+                for(size_t i = 0; i < n; ++i) sum += q[a * n + i] * v[b * n + i];
+                BOOST_CHECK_CLOSE(S[a * p + b], sum, 1e-8);
+            }
+        }
+
+        vex::gemm(Q, S, V, -1.0, 1.0);
+
+        for(size_t s = 0; s < SAMPLE_SIZE; ++s) {
+            size_t i = rand() % n;
+            for(size_t b = 0; b < p; ++b) {
+                double sum = v[b * n + i];
+                for(size_t a = 0; a < m; ++a) sum -= q[a * n + i] * S[a * p + b];
+                BOOST_CHECK_CLOSE(static_cast<double>(V(i, b)), sum, 1e-8);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
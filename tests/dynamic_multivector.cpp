@@ -0,0 +1,81 @@
+#define BOOST_TEST_MODULE DynamicMultivector
+#include <boost/test/unit_test.hpp>
+#include <vexcl/vector.hpp>
+#include <vexcl/dynamic_multivector.hpp>
+#include <vexcl/reductor.hpp>
+#include "context_setup.hpp"
+
+BOOST_AUTO_TEST_CASE(create_and_copy)
+{
+    const size_t n = 1024;
+    const size_t m = 3;
+
+    std::vector<double> host = random_vector<double>(n * m);
+
+    vex::layout layouts[] = {vex::layout::soa, vex::layout::aos};
+
+    for(int l = 0; l < 2; ++l) {
+        vex::dynamic_multivector<double> X(ctx, n, m, host.data(), layouts[l]);
+
+        BOOST_CHECK_EQUAL(X.size(), n);
+        BOOST_CHECK_EQUAL(X.components(), m);
+
+        std::vector<double> back(n * m);
+        vex::copy(X, back);
+
+        BOOST_CHECK(host == back);
+
+        for(size_t k = 0; k < m; ++k) {
+            for(size_t s = 0; s < SAMPLE_SIZE; ++s) {
+                size_t i = rand() % n;
+                BOOST_CHECK_EQUAL(static_cast<double>(X(i, k)), host[k * n + i]);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(expressions_and_components)
+{
+    const size_t n = 1024;
+    const size_t m = 4;
+
+    std::vector<double> host = random_vector<double>(n * m);
+
+    vex::layout layouts[] = {vex::layout::soa, vex::layout::aos};
+
+    for(int l = 0; l < 2; ++l) {
+        vex::dynamic_multivector<double> X(ctx, n, m, host.data(), layouts[l]);
+        vex::dynamic_multivector<double> Y(ctx, n, m, layouts[l]);
+
+        Y = 2 * X + 1;
+
+        vex::Reductor<double, vex::SUM> sum(ctx);
+        double expected = 0;
+        for(size_t i = 0; i < n * m; ++i) expected += 2 * host[i] + 1;
+        BOOST_CHECK_CLOSE(sum(Y), expected, 1e-6);
+
+        vex::vector<double> y(ctx, n);
+        for(size_t k = 0; k < m; ++k) {
+            Y.get(k, y);
+            check_sample(y, [&](size_t i, double v) {
+                    BOOST_CHECK_CLOSE(v, 2 * host[k * n + i] + 1, 1e-8);
+                    });
+        }
+
+        y = 42;
+        Y.set(1, y);
+
+        for(size_t s = 0; s < SAMPLE_SIZE; ++s) {
+            size_t i = rand() % n;
+            BOOST_CHECK_EQUAL(static_cast<double>(Y(i, 1)), 42);
+            BOOST_CHECK_CLOSE(static_cast<double>(Y(i, 0)), 2 * host[i] + 1, 1e-8);
+        }
+
+        // Elements of multivectors with different layouts can not be paired.
+        vex::dynamic_multivector<double> Z(ctx, n, m, layouts[1 - l]);
+        BOOST_CHECK_THROW(Z = X, std::runtime_error);
+        BOOST_CHECK_THROW(Y = X + Z, std::runtime_error);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
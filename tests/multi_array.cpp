@@ -80,4 +80,93 @@ BOOST_AUTO_TEST_CASE(reducing)
     }
 }
 
+BOOST_AUTO_TEST_CASE(multidevice_slicing)
+{
+    using vex::extents;
+    using vex::indices;
+    using vex::range;
+    using vex::_;
+
+    const size_t n = 32;
+
+    vex::multi_array<double, 3> x(ctx, extents[n][n][n]);
+
+    for(size_t i = 0; i < n; ++i)
+        x(indices[i][_][_]) = i;
+
+    // Column crossing all slabs.
+    vex::vector<double> y;
+    x(indices[_][5][7]).get(y);
+
+    BOOST_CHECK_EQUAL(y.size(), n);
+
+    std::vector<double> host(n);
+    vex::copy(y, host);
+
+    for(size_t i = 0; i < n; ++i)
+        BOOST_CHECK_EQUAL(host[i], i);
+
+    // Strided range over the slowest dimension.
+    vex::vector<double> z;
+    x(indices[range(1, 3, n)][_][2]).get(z);
+
+    host.resize(z.size());
+    vex::copy(z, host);
+
+    for(size_t i = 0; i < host.size(); ++i)
+        BOOST_CHECK_EQUAL(host[i], 1 + 3 * i);
+
+    z = 2 * z;
+    x(indices[range(1, 3, n)][_][2]).set(z);
+    x(indices[_][_][2]).get(y);
+
+    host.resize(y.size());
+    vex::copy(y, host);
+
+    for(size_t i = 0; i < n; ++i)
+        for(size_t j = 0; j < n; ++j)
+            BOOST_CHECK_EQUAL(host[i * n + j], i % 3 == 1 ? 2.0 * i : i);
+
+    // Element positions are not known across slabs.
+    if (x(indices[_][5][7]).nslabs() > 1)
+        BOOST_CHECK_THROW(x(indices[_][5][7]) = vex::element_index(), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(multidevice_reducing)
+{
+    using vex::extents;
+    using vex::indices;
+    using vex::_;
+
+    const size_t n = 32;
+
+    vex::multi_array<int, 3> x(ctx, extents[n][n][n]);
+
+    for(size_t i = 0; i < n; ++i)
+        x(indices[i][_][_]) = static_cast<int>(i);
+
+    vex::vector<int> y;
+
+    vex::reduce<vex::SUM>(x, 0, y);
+    BOOST_CHECK_EQUAL(y.size(), n * n);
+    check_sample(y, [n](size_t, int v) {
+            BOOST_CHECK_EQUAL(v, static_cast<int>(n * (n - 1) / 2));
+            });
+
+    vex::reduce<vex::MAX>(x, 0, y);
+    check_sample(y, [n](size_t, int v) {
+            BOOST_CHECK_EQUAL(v, static_cast<int>(n - 1));
+            });
+
+    std::array<size_t, 2> dims = {{1, 2}};
+    vex::reduce<vex::SUM>(x, dims, y);
+    BOOST_CHECK_EQUAL(y.size(), n);
+
+    std::vector<int> host(n);
+    vex::copy(y, host);
+
+    for(size_t i = 0; i < n; ++i)
+        BOOST_CHECK_EQUAL(host[i], static_cast<int>(i * n * n));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,152 @@
+#define BOOST_TEST_MODULE KrylovSolvers
+#include <boost/test/unit_test.hpp>
+#include <vexcl/vector.hpp>
+#include <vexcl/reductor.hpp>
+#include <vexcl/spmat.hpp>
+#include <vexcl/solver.hpp>
+#include "context_setup.hpp"
+
+// Diagonal of the test matrices varies from row to row, so that the Jacobi
+// preconditioner is not a scaled identity.
+double diagonal(double di, size_t i) {
+    return di + i % 4;
+}
+
+// Tridiagonal matrix with the given off-diagonals.
+void tridiag(size_t n, double lo, double di, double up,
+        std::vector<size_t> &row, std::vector<size_t> &col, std::vector<double> &val)
+{
+    row.clear(); col.clear(); val.clear();
+
+    row.push_back(0);
+    for(size_t i = 0; i < n; ++i) {
+        if (i > 0) {
+            col.push_back(i - 1);
+            val.push_back(lo);
+        }
+
+        col.push_back(i);
+        val.push_back(diagonal(di, i));
+
+        if (i + 1 < n) {
+            col.push_back(i + 1);
+            val.push_back(up);
+        }
+
+        row.push_back(col.size());
+    }
+}
+
+// Jacobi preconditioner.
+struct jacobi {
+    const vex::vector<double> &dia;
+
+    jacobi(const vex::vector<double> &dia) : dia(dia) {}
+
+    void apply(const vex::vector<double> &rhs, vex::vector<double> &x) const {
+        x = rhs / dia;
+    }
+};
+
+template <class Solver>
+void test_solver(const vex::Context &ctx, bool symmetric, size_t maxiter)
+{
+    const size_t n = 1024;
+
+    std::vector<size_t> row, col;
+    std::vector<double> val;
+
+    if (symmetric)
+        tridiag(n, -1, 2.5, -1, row, col, val);
+    else
+        tridiag(n, -1.2, 3, -0.8, row, col, val);
+
+    vex::SpMat <double> A(ctx, n, n, row.data(), col.data(), val.data());
+
+    vex::vector<double> b(ctx, random_vector<double>(n));
+    vex::vector<double> x(ctx, n);
+    vex::vector<double> r(ctx, n);
+    std::vector<double> dia(n);
+    for(size_t i = 0; i < n; ++i) dia[i] = diagonal(symmetric ? 2.5 : 3, i);
+
+    vex::vector<double> d(ctx, dia);
+
+    vex::Reductor<double, vex::SUM> sum(ctx);
+
+    const double norm_b = sqrt(sum(b * b));
+    const vex::solver::params prm(maxiter, 1e-8);
+
+    Solver solve(ctx, n, prm);
+
+    size_t iters;
+    double res;
+
+    x = 0;
+    std::tie(iters, res) = solve(A, b, x);
+
+    BOOST_CHECK(iters < maxiter);
+    BOOST_CHECK_SMALL(res, 1e-8);
+
+    r = b - A * x;
+    BOOST_CHECK_SMALL(sqrt(sum(r * r)) / norm_b, 1e-7);
+
+    x = 0;
+    std::tie(iters, res) = solve(A, jacobi(d), b, x);
+
+    BOOST_CHECK(iters < maxiter);
+    BOOST_CHECK_SMALL(res, 1e-8);
+
+    r = b - A * x;
+    BOOST_CHECK_SMALL(sqrt(sum(r * r)) / norm_b, 1e-7);
+}
+
+BOOST_AUTO_TEST_CASE(conjugate_gradient)
+{
+    test_solver< vex::solver::cg<double> >(ctx, true, 100);
+}
+
+BOOST_AUTO_TEST_CASE(pipelined_conjugate_gradient)
+{
+    test_solver< vex::solver::pipelined_cg<double> >(ctx, true, 100);
+}
+
+BOOST_AUTO_TEST_CASE(bicgstab)
+{
+    test_solver< vex::solver::bicgstab<double> >(ctx, false, 100);
+}
+
+BOOST_AUTO_TEST_CASE(gmres)
+{
+    test_solver< vex::solver::gmres<double> >(ctx, false, 100);
+}
+
+BOOST_AUTO_TEST_CASE(zero_rhs)
+{
+    const size_t n = 1024;
+
+    std::vector<size_t> row, col;
+    std::vector<double> val;
+
+    tridiag(n, -1, 2.5, -1, row, col, val);
+
+    vex::SpMat <double> A(ctx, n, n, row.data(), col.data(), val.data());
+
+    vex::vector<double> b(ctx, n);
+    vex::vector<double> x(ctx, n);
+
+    b = 0;
+    x = 1;
+
+    vex::solver::cg<double> solve(ctx, n);
+
+    size_t iters;
+    double res;
+
+    std::tie(iters, res) = solve(A, b, x);
+
+    BOOST_CHECK_EQUAL(iters, 0u);
+    BOOST_CHECK_EQUAL(res, 0);
+    BOOST_CHECK_EQUAL(x[0], 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,4 +1,5 @@
 #define BOOST_TEST_MODULE SparseMatrixVectorProduct
+#include <map>
 #include <boost/test/unit_test.hpp>
 #include <vexcl/vector.hpp>
 #include <vexcl/multivector.hpp>
@@ -85,6 +86,55 @@ BOOST_AUTO_TEST_CASE(non_square_matrix)
             });
 }
 
+BOOST_AUTO_TEST_CASE(transposed_product)
+{
+    const size_t n = 1024;
+    const size_t m = 2 * n;
+
+    std::vector<size_t> row;
+    std::vector<size_t> col;
+    std::vector<double> val;
+
+    random_matrix(n, m, 16, row, col, val);
+
+    std::vector<double> x = random_vector<double>(n);
+
+    vex::SpMat <double> A(ctx, n, m, row.data(), col.data(), val.data());
+    vex::vector<double> X(ctx, x);
+    vex::vector<double> Y(ctx, m);
+
+    auto check = [&]() {
+        std::vector<double> y(m, 0.0);
+        for(size_t i = 0; i < n; i++)
+            for(size_t j = row[i]; j < row[i + 1]; j++)
+                y[col[j]] += val[j] * x[i];
+
+        Y = 1;
+        A.apply_transposed(X, Y, 2, true);
+
+        check_sample(Y, [&](size_t idx, double a) {
+                BOOST_CHECK_CLOSE(a, 1 + 2 * y[idx], 1e-8);
+                });
+
+        Y = A.transposed() * X;
+
+        check_sample(Y, [&](size_t idx, double a) {
+                BOOST_CHECK_CLOSE(a, y[idx], 1e-8);
+                });
+    };
+
+    check();
+
+    BOOST_CHECK_EQUAL(A.transposed().rows(), m);
+    BOOST_CHECK_EQUAL(A.transposed().cols(), n);
+    BOOST_CHECK_EQUAL(A.transposed().nonzeros(), A.nonzeros());
+
+    // The transposed matrix is rebuilt after update of the values.
+    random_vector<double>(val.size()).swap(val);
+    A.update_values(val.data());
+    check();
+}
+
 BOOST_AUTO_TEST_CASE(non_default_types)
 {
     const size_t n = 1024;
@@ -112,6 +162,88 @@ BOOST_AUTO_TEST_CASE(non_default_types)
             });
 }
 
+BOOST_AUTO_TEST_CASE(mixed_precision)
+{
+    const size_t n = 1024;
+
+    std::vector<size_t> row;
+    std::vector<size_t> col;
+    std::vector<double> val;
+
+    random_matrix(n, n, 16, row, col, val);
+
+    // Values are stored in single precision, vectors are in double precision.
+    vex::SpMat<double, size_t, size_t, float> A(ctx, n, n, row.data(), col.data(), val.data());
+
+    BOOST_CHECK(sizeof(decltype(A)::dev_col_t) == 4);
+    BOOST_CHECK(sizeof(decltype(A)::dev_idx_t) == 4);
+
+    std::vector<double> x = random_vector<double>(n);
+    vex::vector<double> X(ctx, x);
+    vex::vector<double> Y(ctx, n);
+
+    Y = A * X;
+
+    check_sample(Y, [&](size_t idx, double a) {
+            double sum = 0;
+            for(size_t j = row[idx]; j < row[idx + 1]; j++)
+                sum += static_cast<float>(val[j]) * x[col[j]];
+
+            BOOST_CHECK_CLOSE(a, sum, 1e-8);
+            });
+}
+
+BOOST_AUTO_TEST_CASE(format_selection)
+{
+    const size_t n = 1024;
+
+    std::vector<size_t> row;
+    std::vector<size_t> col;
+    std::vector<double> val;
+
+    // Long rows are processed by a group of threads on GPUs.
+    random_matrix(n, n, 128, row, col, val);
+
+    vex::SpMat<double> A(ctx, n, n, row.data(), col.data(), val.data());
+
+    for(unsigned d = 0; d < ctx.size(); d++) {
+        const vex::spmat_format_choice &f = A.format(d);
+
+        BOOST_CHECK(!f.reason.empty());
+        BOOST_CHECK_EQUAL(f.stat.nonzeros,
+                A.nonzero_partition()[d + 1] - A.nonzero_partition()[d]);
+
+        if (vex::is_cpu(ctx.queue(d)))
+            BOOST_CHECK(f.format == vex::spmat_format::csr);
+        else
+            BOOST_CHECK(f.format == vex::spmat_format::csr_vector);
+    }
+
+    std::vector<double> x = random_vector<double>(n);
+    vex::vector<double> X(ctx, x);
+    vex::vector<double> Y(ctx, n);
+
+    Y = A * X;
+
+    check_sample(Y, [&](size_t idx, double a) {
+            double sum = 0;
+            for(size_t j = row[idx]; j < row[idx + 1]; j++)
+                sum += val[j] * x[col[j]];
+
+            BOOST_CHECK_CLOSE(a, sum, 1e-8);
+            });
+
+    Y = X + A * X;
+
+    check_sample(Y, [&](size_t idx, double a) {
+            double sum = x[idx];
+            for(size_t j = row[idx]; j < row[idx + 1]; j++)
+                sum += val[j] * x[col[j]];
+
+            BOOST_CHECK_CLOSE(a, sum, 1e-8);
+            });
+}
+
 BOOST_AUTO_TEST_CASE(empty_rows)
 {
     const size_t n = 1024;
@@ -229,6 +361,149 @@ BOOST_AUTO_TEST_CASE(ccsr_vector_product)
             });
 }
 
+BOOST_AUTO_TEST_CASE(bsr_vector_product)
+{
+    const size_t nb = 512;
+    const size_t B  = 3;
+
+    std::vector<size_t> ptr;
+    std::vector<size_t> col;
+    std::vector<double> v;
+
+    random_matrix(nb, nb, 8, ptr, col, v);
+
+    std::vector<double> val = random_vector<double>(col.size() * B * B);
+
+    std::vector<vex::command_queue> queue(1, ctx.queue(0));
+
+    vex::SpMatBSR<double, B> A(queue[0], nb, nb, ptr.data(), col.data(), val.data());
+
+    auto product = [&](const std::vector<double> &x, size_t i) {
+        size_t ib = i / B, r = i % B;
+        double sum = 0;
+        for(size_t j = ptr[ib]; j < ptr[ib + 1]; j++)
+            for(size_t k = 0; k < B; k++)
+                sum += val[j * B * B + r * B + k] * x[col[j] * B + k];
+        return sum;
+    };
+
+    // Interleaved vectors.
+    std::vector<double> x = random_vector<double>(nb * B);
+
+    vex::vector<double> X(queue, x);
+    vex::vector<double> Y(queue, nb * B);
+
+    Y = A * X;
+
+    check_sample(Y, [&](size_t i, double a) {
+            BOOST_CHECK_CLOSE(a, product(x, i), 1e-8);
+            });
+
+    Y = X - 2 * (A * X);
+
+    check_sample(Y, [&](size_t i, double a) {
+            BOOST_CHECK_CLOSE(a, x[i] - 2 * product(x, i), 1e-8);
+            });
+
+    // Multivectors.
+    vex::multivector<double, B> MX(queue, nb);
+    vex::multivector<double, B> MY(queue, nb);
+
+    for(size_t k = 0; k < B; k++)
+        MX(k) = vex::permutation(vex::element_index() * B + k)(X);
+
+    MY = A * MX;
+
+    for(size_t k = 0; k < B; k++) {
+        check_sample(MY(k), [&](size_t i, double a) {
+                BOOST_CHECK_CLOSE(a, product(x, i * B + k), 1e-8);
+                });
+    }
+}
+
+BOOST_AUTO_TEST_CASE(triangular_solve)
+{
+    const size_t n = 1024;
+
+    std::vector<size_t> r;
+    std::vector<size_t> c;
+    std::vector<double> v;
+
+    random_matrix(n, n, 8, r, c, v);
+
+    // Add dominant diagonal.
+    std::vector<size_t> row(1, 0);
+    std::vector<size_t> col;
+    std::vector<double> val;
+
+    for(size_t i = 0; i < n; ++i) {
+        col.push_back(i);
+        val.push_back(8);
+
+        for(size_t j = r[i]; j < r[i + 1]; ++j) {
+            if (c[j] == i) {
+                val[row[i]] += v[j];
+            } else {
+                col.push_back(c[j]);
+                val.push_back(v[j]);
+            }
+        }
+
+        row.push_back(col.size());
+    }
+
+    std::vector<vex::command_queue> queue(1, ctx.queue(0));
+
+    std::vector<double> x = random_vector<double>(n);
+
+    vex::triangle tri[] = {vex::triangle::lower, vex::triangle::upper};
+
+    for(int t = 0; t < 2; ++t) {
+        bool lower = tri[t] == vex::triangle::lower;
+        bool unit  = !lower;
+
+        // b = T x
+        std::vector<double> b(n);
+        for(size_t i = 0; i < n; ++i) {
+            double sum = unit ? x[i] : val[row[i]] * x[i];
+            for(size_t j = row[i] + 1; j < row[i + 1]; ++j)
+                if (lower ? col[j] < i : col[j] > i) sum += val[j] * x[col[j]];
+            b[i] = sum;
+        }
+
+        vex::sparse_triangular_solver<double> T(queue, n,
+                row.data(), col.data(), val.data(), tri[t], unit);
+
+        BOOST_CHECK(T.levels() > 1);
+
+        vex::vector<double> B(queue, b);
+        vex::vector<double> X(queue, n);
+
+        T.apply(B, X);
+
+        check_sample(X, [&](size_t i, double a) {
+                BOOST_CHECK_CLOSE(a, x[i], 1e-8);
+                });
+
+        // In place.
+        T.apply(B, B);
+
+        check_sample(B, [&](size_t i, double a) {
+                BOOST_CHECK_CLOSE(a, x[i], 1e-8);
+                });
+    }
+
+    // Rows without stored diagonal are rejected unless the diagonal is unit.
+    std::vector<size_t> erow = {0, 1, 1};
+    std::vector<size_t> ecol = {0};
+    std::vector<double> eval = {2};
+
+    BOOST_CHECK_THROW(
+            vex::sparse_triangular_solver<double>(queue, 2,
+                erow.data(), ecol.data(), eval.data()),
+            std::runtime_error);
+}
+
 BOOST_AUTO_TEST_CASE(inline_spmv)
 {
     const size_t n = 1024;
@@ -258,6 +533,343 @@ BOOST_AUTO_TEST_CASE(inline_spmv)
             });
 }
 
+BOOST_AUTO_TEST_CASE(inline_spmv_multidevice)
+{
+    const size_t n = 1024;
+
+    std::vector<size_t> row;
+    std::vector<size_t> col;
+    std::vector<double> val;
+
+    random_matrix(n, n, 16, row, col, val);
+
+    std::vector<double> x = random_vector<double>(n);
+    std::vector<double> f = random_vector<double>(n);
+
+    vex::SpMat <double> A(ctx, n, n, row.data(), col.data(), val.data());
+    vex::vector<double> X(ctx, x);
+    vex::vector<double> F(ctx, f);
+    vex::vector<double> Y(ctx, n);
+
+    Y = sin(F - vex::make_inline(A * X));
+
+    check_sample(Y, [&](size_t idx, double a) {
+            double sum = 0;
+            for(size_t j = row[idx]; j < row[idx + 1]; j++)
+                sum += val[j] * x[col[j]];
+
+            BOOST_CHECK_CLOSE(a, sin(f[idx] - sum), 1e-8);
+            });
+
+    // Inlined products of the same matrix with different vectors:
+    std::vector<double> z = random_vector<double>(n);
+    vex::vector<double> Z(ctx, z);
+
+    Y = vex::make_inline(A * X) - 2 * vex::make_inline(A * Z);
+
+    check_sample(Y, [&](size_t idx, double a) {
+            double sum = 0;
+            for(size_t j = row[idx]; j < row[idx + 1]; j++)
+                sum += val[j] * (x[col[j]] - 2 * z[col[j]]);
+
+            BOOST_CHECK_CLOSE(a, sum, 1e-8);
+            });
+
+    // Stored inlined product sees the current value of the vector:
+    auto AX = vex::make_inline(A * X);
+    X = F;
+    Y = AX;
+
+    check_sample(Y, [&](size_t idx, double a) {
+            double sum = 0;
+            for(size_t j = row[idx]; j < row[idx + 1]; j++)
+                sum += val[j] * f[col[j]];
+
+            BOOST_CHECK_CLOSE(a, sum, 1e-8);
+            });
+}
+
+BOOST_AUTO_TEST_CASE(inline_spmv_mixed_partitions)
+{
+    // Single- and multi-partition matrices of the same type share the
+    // inlined kernel on the first device.
+    const size_t n = 1024;
+
+    std::vector<size_t> row;
+    std::vector<size_t> col;
+    std::vector<double> val;
+
+    random_matrix(n, n, 16, row, col, val);
+
+    std::vector<double> x = random_vector<double>(n);
+
+    std::vector<vex::command_queue> queue(1, ctx.queue(0));
+
+    vex::SpMat <double> A1(queue, n, n, row.data(), col.data(), val.data());
+    vex::vector<double> X1(queue, x);
+    vex::vector<double> Y1(queue, n);
+
+    vex::SpMat <double> A(ctx, n, n, row.data(), col.data(), val.data());
+    vex::vector<double> X(ctx, x);
+    vex::vector<double> Y(ctx, n);
+
+    Y1 = vex::make_inline(A1 * X1);
+    Y  = vex::make_inline(A  * X);
+
+    check_sample(Y, Y1, [&](size_t idx, double a, double b) {
+            double sum = 0;
+            for(size_t j = row[idx]; j < row[idx + 1]; j++)
+                sum += val[j] * x[col[j]];
+
+            BOOST_CHECK_CLOSE(a, sum, 1e-8);
+            BOOST_CHECK_CLOSE(b, sum, 1e-8);
+            });
+}
+
+BOOST_AUTO_TEST_CASE(chebyshev_polynomial)
+{
+    const size_t n = 1024;
+
+    std::vector<size_t> row;
+    std::vector<size_t> col;
+    std::vector<double> val;
+
+    random_matrix(n, n, 16, row, col, val);
+
+    std::vector<double> x = random_vector<double>(n);
+    std::vector<double> c = {0.5, -1.0, 0.25, 2.0, -0.75};
+
+    const double lmin = -1, lmax = 3;
+
+    vex::SpMat<double> A(ctx, n, n, row.data(), col.data(), val.data());
+    vex::chebyshev_polynomial<double> P(A, c, lmin, lmax);
+
+    BOOST_CHECK_EQUAL(P.degree(), c.size() - 1);
+
+    vex::vector<double> X(ctx, x);
+    vex::vector<double> Y(ctx, n);
+
+    P.apply(X, Y);
+
+    // Host recurrence.
+    const double delta = 2 / (lmax - lmin), sigma = (lmax + lmin) / (lmax - lmin);
+
+    auto scaled = [&](const std::vector<double> &v) {
+        std::vector<double> w(n);
+        for(size_t i = 0; i < n; ++i) {
+            double sum = 0;
+            for(size_t j = row[i]; j < row[i + 1]; ++j) sum += val[j] * v[col[j]];
+            w[i] = delta * sum - sigma * v[i];
+        }
+        return w;
+    };
+
+    std::vector<double> prev = x, curr = scaled(x), y(n);
+    for(size_t i = 0; i < n; ++i) y[i] = c[0] * x[i] + c[1] * curr[i];
+
+    for(size_t k = 2; k < c.size(); ++k) {
+        std::vector<double> next = scaled(curr);
+        for(size_t i = 0; i < n; ++i) {
+            next[i] = 2 * next[i] - prev[i];
+            y[i] += c[k] * next[i];
+        }
+        prev.swap(curr);
+        curr.swap(next);
+    }
+
+    check_sample(Y, [&](size_t i, double a) {
+            BOOST_CHECK_CLOSE(a, y[i], 1e-8);
+            });
+}
+
+BOOST_AUTO_TEST_CASE(update_values)
+{
+    const size_t n = 1024;
+
+    std::vector<size_t> row;
+    std::vector<size_t> col;
+    std::vector<double> val;
+
+    random_matrix(n, n, 16, row, col, val);
+
+    vex::SpMat<double> A(ctx, n, n, row.data(), col.data(), val.data());
+
+    std::vector<double> x = random_vector<double>(n);
+    vex::vector<double> X(ctx, x);
+    vex::vector<double> Y(ctx, n);
+
+    auto check = [&]() {
+        Y = A * X;
+
+        check_sample(Y, [&](size_t idx, double a) {
+                double sum = 0;
+                for(size_t j = row[idx]; j < row[idx + 1]; j++)
+                    sum += val[j] * x[col[j]];
+
+                BOOST_CHECK_CLOSE(a, sum, 1e-8);
+                });
+    };
+
+    // Values on host.
+    random_vector<double>(val.size()).swap(val);
+    A.update_values(val.data());
+    check();
+
+    // Values on compute devices.
+    random_vector<double>(val.size()).swap(val);
+
+    vex::vector<double> V(ctx, val);
+    A.update_values(V);
+    check();
+}
+
+BOOST_AUTO_TEST_CASE(reordered_matrix)
+{
+    const size_t n = 1024;
+
+    std::vector<size_t> row;
+    std::vector<size_t> col;
+    std::vector<double> val;
+
+    random_matrix(n, n, 16, row, col, val);
+
+    vex::SpMat<double> A(ctx, n, n, row.data(), col.data(), val.data(),
+            vex::ordering::rcm);
+
+    BOOST_REQUIRE(A.reordering().size() == n);
+
+    std::vector<double> x = random_vector<double>(n);
+    vex::vector<double> X(ctx, x);
+    vex::vector<double> Xp(ctx, n);
+    vex::vector<double> Yp(ctx, n);
+    vex::vector<double> Y(ctx, n);
+
+    auto check = [&]() {
+        A.permute(X, Xp);
+        Yp = A * Xp;
+        A.unpermute(Yp, Y);
+
+        check_sample(Y, [&](size_t idx, double a) {
+                double sum = 0;
+                for(size_t j = row[idx]; j < row[idx + 1]; j++)
+                    sum += val[j] * x[col[j]];
+
+                BOOST_CHECK_CLOSE(a, sum, 1e-8);
+                });
+    };
+
+    check();
+
+    // Values are given in the original order.
+    random_vector<double>(val.size()).swap(val);
+    A.update_values(val.data());
+    check();
+}
+
+BOOST_AUTO_TEST_CASE(coo_assembly)
+{
+    const size_t n   = 1024;
+    const size_t nnz = 16 * n;
+
+    std::vector<vex::command_queue> queue(1, ctx.queue(0));
+
+    // Unordered triplets with duplicates.
+    std::vector<size_t> row(nnz);
+    std::vector<size_t> col(nnz);
+    std::vector<double> val = random_vector<double>(nnz);
+
+    for(size_t j = 0; j < nnz; ++j) {
+        row[j] = rand() % n;
+        col[j] = rand() % 32;
+    }
+
+    vex::vector<size_t> R(queue, row);
+    vex::vector<size_t> C(queue, col);
+    vex::vector<double> V(queue, val);
+
+    vex::SpMat<double> A(queue, n, n, R, C, V);
+
+    std::vector<double> x = random_vector<double>(n);
+    vex::vector<double> X(queue, x);
+    vex::vector<double> Y(queue, n);
+
+    Y = A * X;
+
+    std::vector<double> y(n, 0.0);
+    for(size_t j = 0; j < nnz; ++j)
+        y[row[j]] += val[j] * x[col[j]];
+
+    check_sample(Y, [&](size_t idx, double a) {
+            BOOST_CHECK_CLOSE(a, y[idx], 1e-8);
+            });
+}
+
+BOOST_AUTO_TEST_CASE(sparse_matrix_product)
+{
+    const size_t n = 256;
+    const size_t k = 128;
+    const size_t m = 192;
+
+    std::vector<size_t> arow, brow;
+    std::vector<size_t> acol, bcol;
+    std::vector<double> aval, bval;
+
+    random_matrix(n, k, 8, arow, acol, aval);
+    random_matrix(k, m, 8, brow, bcol, bval);
+
+    std::vector<vex::command_queue> queue(1, ctx.queue(0));
+
+    vex::vector<size_t> Aptr(queue, arow), Bptr(queue, brow);
+    vex::vector<size_t> Acol(queue, acol), Bcol(queue, bcol);
+    vex::vector<double> Aval(queue, aval), Bval(queue, bval);
+
+    vex::vector<size_t> Cptr, Ccol;
+    vex::vector<double> Cval;
+
+    vex::spgemm(Aptr, Acol, Aval, Bptr, Bcol, Bval, m, Cptr, Ccol, Cval);
+
+    std::vector<size_t> crow(n + 1), ccol(Ccol.size());
+    std::vector<double> cval(Cval.size());
+
+    vex::copy(Cptr, crow);
+    vex::copy(Ccol, ccol);
+    vex::copy(Cval, cval);
+
+    BOOST_REQUIRE_EQUAL(crow.back(), ccol.size());
+
+    for(size_t i = 0; i < n; ++i) {
+        std::map<size_t, double> r;
+        for(size_t j = arow[i]; j < arow[i + 1]; ++j)
+            for(size_t l = brow[acol[j]]; l < brow[acol[j] + 1]; ++l)
+                r[bcol[l]] += aval[j] * bval[l];
+
+        BOOST_REQUIRE_EQUAL(crow[i + 1] - crow[i], r.size());
+
+        size_t j = crow[i];
+        for(auto e = r.begin(); e != r.end(); ++e, ++j) {
+            BOOST_CHECK_EQUAL(ccol[j], e->first);
+            BOOST_CHECK_CLOSE(cval[j], e->second, 1e-8);
+        }
+    }
+
+    // Product as a matrix ready for matrix-vector products.
+    auto C = vex::spgemm(Aptr, Acol, Aval, Bptr, Bcol, Bval, m);
+
+    std::vector<double> x = random_vector<double>(m);
+    vex::vector<double> X(queue, x);
+    vex::vector<double> Y(queue, n);
+
+    Y = C * X;
+
+    check_sample(Y, [&](size_t idx, double a) {
+            double sum = 0;
+            for(size_t j = crow[idx]; j < crow[idx + 1]; j++)
+                sum += cval[j] * x[ccol[j]];
+
+            BOOST_CHECK_CLOSE(a, sum, 1e-8);
+            });
+}
+
 BOOST_AUTO_TEST_CASE(multivector_product)
 {
     const size_t n = 1024;
@@ -305,6 +917,99 @@ BOOST_AUTO_TEST_CASE(multivector_product)
             });
 }
 
+BOOST_AUTO_TEST_CASE(dynamic_multivector_product)
+{
+    const size_t n = 1024;
+    const size_t m = 20;
+
+    std::vector<size_t> row;
+    std::vector<size_t> col;
+    std::vector<double> val;
+
+    random_matrix(n, n, 16, row, col, val);
+
+    std::vector<double> x = random_vector<double>(n * m);
+
+    vex::SpMat <double> A(ctx, n, n, row.data(), col.data(), val.data());
+
+    vex::dynamic_multivector<double> X(ctx, n, m, x.data(), vex::layout::aos);
+    vex::dynamic_multivector<double> Y(ctx, n, m, vex::layout::soa);
+
+    A.apply(X, Y);
+
+    std::vector<double> y(n * m);
+    vex::copy(Y, y);
+
+    for(size_t s = 0; s < SAMPLE_SIZE; ++s) {
+        size_t i = rand() % n;
+
+        for(size_t k = 0; k < m; ++k) {
+            double sum = 0;
+            for(size_t j = row[i]; j < row[i + 1]; j++)
+                sum += val[j] * x[k * n + col[j]];
+
+            BOOST_CHECK_CLOSE(y[k * n + i], sum, 1e-8);
+        }
+    }
+
+    A.apply(X, Y, -1, true);
+    vex::copy(Y, y);
+
+    for(size_t s = 0; s < SAMPLE_SIZE; ++s) {
+        size_t i = rand() % n;
+
+        for(size_t k = 0; k < m; ++k)
+            BOOST_CHECK_SMALL(y[k * n + i], 1e-8);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(wide_multivector_one_way_coupling)
+{
+    // Lower bidiagonal matrix: each device only receives ghost values from
+    // the previous one. The multivector is split into several chunks, and
+    // the interleaved rows of the last one do not fit a single vector load.
+    const size_t n = 1024;
+    const size_t m = 39;
+
+    std::vector<size_t> row;
+    std::vector<size_t> col;
+    std::vector<double> val;
+
+    row.push_back(0);
+    for(size_t i = 0; i < n; ++i) {
+        if (i > 0) {
+            col.push_back(i - 1);
+            val.push_back(-1);
+        }
+
+        col.push_back(i);
+        val.push_back(2);
+
+        row.push_back(col.size());
+    }
+
+    std::vector<double> x = random_vector<double>(n * m);
+
+    vex::SpMat <double> A(ctx, n, n, row.data(), col.data(), val.data());
+
+    vex::dynamic_multivector<double> X(ctx, n, m, x.data(), vex::layout::aos);
+    vex::dynamic_multivector<double> Y(ctx, n, m);
+
+    A.apply(X, Y);
+
+    std::vector<double> y(n * m);
+    vex::copy(Y, y);
+
+    for(size_t i = 0; i < n; ++i) {
+        for(size_t k = 0; k < m; ++k) {
+            double sum = 2 * x[k * n + i];
+            if (i > 0) sum -= x[k * n + i - 1];
+
+            BOOST_CHECK_CLOSE(y[k * n + i], sum, 1e-8);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(inline_multivector_product)
 {
     const size_t n = 1024;
@@ -435,6 +1140,107 @@ BOOST_AUTO_TEST_CASE(ccsr_multivector_product)
             });
 }
 
+BOOST_AUTO_TEST_CASE(ccsr_multidevice_product)
+{
+    const size_t n = 32;
+    const size_t N = n * n * n;
+    const double h2i = (n - 1) * (n - 1);
+
+    typedef std::array<double, 2> elem_t;
+
+    std::vector<size_t> idx;
+    std::vector<size_t> row = {0, 1, 8};
+    std::vector<int>    col = {
+        0,
+        -static_cast<int>(n * n), -static_cast<int>(n), -1, 0, 1,
+        static_cast<int>(n), static_cast<int>(n * n)
+    };
+    std::vector<double> val = {
+        1, -h2i, -h2i, -h2i, h2i * 6, -h2i, -h2i, -h2i
+    };
+
+    idx.reserve(N);
+
+    for(size_t k = 0; k < n; k++) {
+        for(size_t j = 0; j < n; j++) {
+            for(size_t i = 0; i < n; i++) {
+                if (
+                        i == 0 || i + 1 == n ||
+                        j == 0 || j + 1 == n ||
+                        k == 0 || k + 1 == n
+                   )
+                {
+                    idx.push_back(0);
+                } else {
+                    idx.push_back(1);
+                }
+            }
+        }
+    }
+
+    auto product = [&](const std::vector<double> &x, size_t ii, size_t shift) {
+        double sum = 0;
+        size_t i = idx[ii];
+        for(size_t j = row[i]; j < row[i + 1]; j++)
+            sum += val[j] * x[shift + ii + col[j]];
+        return sum;
+    };
+
+    vex::SpMatCCSR<double,int> A(ctx, N, row.size() - 1,
+            idx.data(), row.data(), col.data(), val.data());
+
+    BOOST_CHECK_EQUAL(A.lhalo.front(), 0u);
+    BOOST_CHECK_EQUAL(A.rhalo.back(),  0u);
+
+    for(unsigned d = 0; d < ctx.size(); d++) {
+        BOOST_CHECK(A.lhalo[d] <= n * n);
+        BOOST_CHECK(A.rhalo[d] <= n * n);
+    }
+
+    std::vector<double> x = random_vector<double>(N * 2);
+
+    vex::vector<double> X(ctx, N);
+    vex::vector<double> Y(ctx, N);
+
+    vex::copy(x.begin(), x.begin() + N, X.begin());
+
+    Y = X - A * X;
+
+    check_sample(Y, [&](size_t ii, double a) {
+            BOOST_CHECK_CLOSE(a, x[ii] - product(x, ii, 0), 1e-8);
+            });
+
+    vex::multivector<double,2> MX(ctx, x);
+    vex::multivector<double,2> MY(ctx, N);
+
+    MY = A * MX;
+
+    check_sample(MY, [&](size_t ii, elem_t a) {
+            BOOST_CHECK_CLOSE(a[0], product(x, ii, 0), 1e-8);
+            BOOST_CHECK_CLOSE(a[1], product(x, ii, N), 1e-8);
+            });
+
+    // Halo buffers of the matrix are reused, but products in the same
+    // expression should get different ones.
+    vex::vector<double> Z(ctx, N);
+    vex::copy(x.begin() + N, x.end(), Z.begin());
+
+    Y = A * X + A * Z;
+
+    check_sample(Y, [&](size_t ii, double a) {
+            BOOST_CHECK_CLOSE(a, product(x, ii, 0) + product(x, ii, N), 1e-8);
+            });
+
+    // Stored product sees the current value of the vector.
+    auto AX = A * X;
+    X = Z;
+    Y = AX;
+
+    check_sample(Y, [&](size_t ii, double a) {
+            BOOST_CHECK_CLOSE(a, product(x, ii, N), 1e-8);
+            });
+}
+
 #ifdef VEXCL_BACKEND_OPENCL
 BOOST_AUTO_TEST_CASE(vector_valued_matrix)
 {
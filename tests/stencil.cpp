@@ -3,6 +3,7 @@
 #include <vexcl/vector.hpp>
 #include <vexcl/multivector.hpp>
 #include <vexcl/stencil.hpp>
+#include <vexcl/stencil_nd.hpp>
 #include "context_setup.hpp"
 
 struct index {
@@ -56,6 +57,69 @@ BOOST_AUTO_TEST_CASE(stencil_convolution)
     });
 }
 
+BOOST_AUTO_TEST_CASE(inlined_coefficients)
+{
+    const size_t n = 1024;
+
+    // Symmetric, antisymmetric, unit and zero coefficients.
+    std::vector<double> s = {0.5, -1, 0, 2, 0, 1, 0.5, 0.25};
+    const int center = 3;
+
+    vex::stencil<double> S(ctx, s, center, vex::stencil_coefficients::inlined);
+
+    std::vector<double> x = random_vector<double>(n);
+
+    vex::vector<double> X(ctx, x);
+    vex::vector<double> Y(ctx, n);
+
+    Y = 1;
+    Y += X * S;
+
+    index idx(n);
+
+    check_sample(Y, [&](size_t i, double a) {
+        double sum = 1;
+        for(int j = 0; j < static_cast<int>(s.size()); j++)
+            sum += s[j] * x[idx(i, j - center)];
+        BOOST_CHECK_CLOSE(a, sum, 1e-8);
+    });
+}
+
+BOOST_AUTO_TEST_CASE(temporal_blocking)
+{
+    const size_t   n = 1024;
+    const unsigned k = 4;
+
+    std::vector<double> s = {0.25, 0.5, 0.125, 0.125};
+    const int center = 1;
+
+    vex::stencil<double> S(ctx, s, center);
+
+    std::vector<double> x = random_vector<double>(n);
+
+    vex::vector<double> X(ctx, x);
+    vex::vector<double> Y(ctx, n);
+
+    S.apply_k(X, Y, k);
+
+    index idx(n);
+
+    std::vector<double> y(n);
+    for(unsigned t = 0; t < k; ++t) {
+        for(size_t i = 0; i < n; ++i) {
+            double sum = 0;
+            for(int j = 0; j < static_cast<int>(s.size()); j++)
+                sum += s[j] * x[idx(i, j - center)];
+            y[i] = sum;
+        }
+        x.swap(y);
+    }
+
+    check_sample(Y, [&](size_t i, double a) {
+        BOOST_CHECK_CLOSE(a, x[i], 1e-8);
+    });
+}
+
 #if BOOST_VERSION >= 105000
 // Boost upto v1.49 segfaults on this test
 BOOST_AUTO_TEST_CASE(two_stencils)
@@ -217,4 +281,123 @@ BOOST_AUTO_TEST_CASE(user_defined_stencil)
 #endif
 }
 
+BOOST_AUTO_TEST_CASE(stencil_3d)
+{
+    const size_t n = 32;
+
+    typedef vex::stencil_nd<double, 3>::offset_type offset;
+
+    // 7-point stencil extended by a point two planes away in the slowest
+    // dimension, so that halo widths differ.
+    std::vector<offset> off = {
+        {{0, 0, 0}},
+        {{-1, 0, 0}}, {{1, 0, 0}}, {{2, 0, 0}},
+        {{0, -1, 0}}, {{0, 1, 0}},
+        {{0, 0, -1}}, {{0, 0, 1}}
+    };
+
+    std::vector<double> coef = random_vector<double>(off.size());
+
+    vex::multi_array<double, 3> X(ctx, vex::extents[n][n][n]);
+    vex::multi_array<double, 3> Y(ctx, vex::extents[n][n][n]);
+
+    std::vector<double> x = random_vector<double>(n * n * n);
+    vex::copy(x, X.vec());
+
+    vex::stencil_nd<double, 3> L(X, off, coef);
+
+    Y.vec() = L * X;
+
+    index idx(n);
+
+    auto conv = [&](size_t i) {
+        size_t c[3] = {i / (n * n), (i / n) % n, i % n};
+        double sum = 0;
+        for(size_t j = 0; j < off.size(); ++j)
+            sum += coef[j] * x[
+                (idx(c[0], off[j][0]) * n + idx(c[1], off[j][1])) * n + idx(c[2], off[j][2])
+                ];
+        return sum;
+    };
+
+    check_sample(Y.vec(), [&](size_t i, double a) {
+        BOOST_CHECK_CLOSE(a, conv(i), 1e-8);
+    });
+
+    Y.vec() = 2 * X.vec() - L * X;
+
+    check_sample(Y.vec(), [&](size_t i, double a) {
+        BOOST_CHECK_CLOSE(a, 2 * x[i] - conv(i), 1e-8);
+    });
+}
+
+BOOST_AUTO_TEST_CASE(stencil_2d)
+{
+    const size_t n = 100;
+    const size_t m = 200;
+
+    std::vector<vex::command_queue> queue(1, ctx.queue(0));
+
+    vex::stencil_nd<double, 2> L(queue, vex::extents[n][m],
+            {{{0, 0}}, {{-1, 0}}, {{1, 0}}, {{0, -1}}, {{0, 1}}},
+            {4, -1, -1, -1, -1});
+
+    std::vector<double> x = random_vector<double>(n * m);
+
+    vex::vector<double> X(queue, x);
+    vex::vector<double> Y(queue, n * m);
+
+    Y = 1;
+    Y += L * X;
+
+    index ix(n), iy(m);
+
+    check_sample(Y, [&](size_t k, double a) {
+        size_t i = k / m, j = k % m;
+        double s = 4 * x[k]
+            - x[ix(i, -1) * m + j] - x[ix(i, 1) * m + j]
+            - x[i * m + iy(j, -1)] - x[i * m + iy(j, 1)];
+        BOOST_CHECK_CLOSE(a, 1 + s, 1e-8);
+    });
+}
+
+BOOST_AUTO_TEST_CASE(stencil_2d_multidevice)
+{
+    // Plane size is odd, so that the default partitioning of a vector on
+    // several devices does not follow the planes.
+    const size_t n = 100;
+    const size_t m = 201;
+
+    vex::stencil_nd<double, 2> L(ctx, vex::extents[n][m],
+            {{{0, 0}}, {{-1, 0}}, {{1, 0}}, {{0, -1}}, {{0, 1}}},
+            {4, -1, -1, -1, -1});
+
+    std::vector<double> x = random_vector<double>(n * m);
+
+    vex::vector<double> X(ctx, x);
+    vex::vector<double> Y(ctx, n * m);
+
+    index ix(n), iy(m);
+
+    auto conv = [&](size_t k) {
+        size_t i = k / m, j = k % m;
+        return 4 * x[k]
+            - x[ix(i, -1) * m + j] - x[ix(i, 1) * m + j]
+            - x[i * m + iy(j, -1)] - x[i * m + iy(j, 1)];
+    };
+
+    Y = X - L * X;
+
+    check_sample(Y, [&](size_t k, double a) {
+        BOOST_CHECK_CLOSE(a, x[k] - conv(k), 1e-8);
+    });
+
+    Y = 1;
+    Y += L * X;
+
+    check_sample(Y, [&](size_t k, double a) {
+        BOOST_CHECK_CLOSE(a, 1 + conv(k), 1e-8);
+    });
+}
+
 BOOST_AUTO_TEST_SUITE_END()
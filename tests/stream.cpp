@@ -0,0 +1,58 @@
+#define BOOST_TEST_MODULE Streams
+#include <boost/test/unit_test.hpp>
+#include <vexcl/vector.hpp>
+#include <vexcl/stream.hpp>
+#include "context_setup.hpp"
+
+BOOST_AUTO_TEST_CASE(stream_bound_vector)
+{
+    const size_t n = 1024;
+
+    vex::vector<double> x(ctx, random_vector<double>(n));
+    vex::vector<double> y(ctx, n);
+
+    vex::stream s(ctx);
+
+    auto Y = s(y);
+    Y = 2 * s(x);
+    s.finish();
+
+    check_sample(x, y, [](size_t, double a, double b) {
+            BOOST_CHECK_CLOSE(b, 2 * a, 1e-8);
+            });
+}
+
+BOOST_AUTO_TEST_CASE(parallel_section)
+{
+    const size_t n = 1024;
+    const size_t m = 8;
+
+    std::vector< vex::vector<double> > x, y;
+    for(size_t i = 0; i < m; ++i) {
+        x.push_back(vex::vector<double>(ctx, random_vector<double>(n)));
+        y.push_back(vex::vector<double>(ctx, n));
+    }
+
+    vex::parallel_section par(ctx, 3);
+
+    for(int iter = 0; iter < 2; ++iter) {
+        for(size_t i = 0; i < m; ++i) {
+            const vex::stream &s = par.next();
+
+            auto Y = s(y[i]);
+            Y = s(x[i]) * static_cast<double>(i + iter);
+        }
+
+        par.join();
+
+        // Reads through the context queues are ordered after the join.
+        for(size_t i = 0; i < m; ++i) {
+            double a = static_cast<double>(i + iter);
+            check_sample(x[i], y[i], [a](size_t, double X, double Y) {
+                    BOOST_CHECK_CLOSE(Y, a * X, 1e-8);
+                    });
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
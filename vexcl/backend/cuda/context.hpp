@@ -78,6 +78,13 @@ struct deleter_impl<CUstream> {
     }
 };
 
+template <>
+struct deleter_impl<CUevent> {
+    static void dispose(CUevent event) {
+        cuda_check( cuEventDestroy(event) );
+    }
+};
+
 // Knows how to dispose of various CUDA handles.
 struct deleter {
     template <class Handle>
@@ -254,11 +261,71 @@ inline kernel_cache_key cache_key(const command_queue &q) {
 }
 /// \endcond
 
+/// Checks if the two queues belong to the same context.
+/**
+ * Device memory may be copied directly between queues sharing a context.
+ */
+inline bool is_same_context(const command_queue &q1, const command_queue &q2) {
+    return q1.context().raw() == q2.context().raw();
+}
+
 /// Create command queue on the same context and device as the given one.
 inline command_queue duplicate_queue(const command_queue &q) {
     return command_queue(q.context(), q.device(), q.flags());
 }
 
+/// Synchronization point that may be shared between command queues.
+/** With the CUDA backend, this is a wrapper around CUevent. */
+class event {
+    public:
+        /// Empty constructor.
+        event() {}
+
+        /// Creates an event in the context of the given queue.
+        explicit event(const command_queue &q)
+            : e( create(q), detail::deleter() )
+        { }
+
+        /// Blocks until the event has completed.
+        void wait() const {
+            cuda_check( cuEventSynchronize( e.get() ) );
+        }
+
+        /// Returns raw CUevent handle.
+        CUevent raw() const {
+            return e.get();
+        }
+    private:
+        std::shared_ptr<std::remove_pointer<CUevent>::type> e;
+
+        static CUevent create(const command_queue &q) {
+            q.context().set_current();
+
+            CUevent e;
+            cuda_check( cuEventCreate(&e, CU_EVENT_DISABLE_TIMING) );
+
+            return e;
+        }
+};
+
+/// Enqueues a marker into the queue.
+/**
+ * The returned event completes when all commands previously submitted to the
+ * queue have completed.
+ */
+inline event enqueue_marker(const command_queue &q) {
+    event e(q);
+    cuda_check( cuEventRecord(e.raw(), q.raw()) );
+    return e;
+}
+
+/// Makes commands submitted to the queue after this call wait for the events.
+inline void enqueue_wait(const command_queue &q, const std::vector<event> &events) {
+    q.context().set_current();
+    for(auto e = events.begin(); e != events.end(); ++e)
+        cuda_check( cuStreamWaitEvent(q.raw(), e->raw(), 0) );
+}
+
 /// Checks if the compute device is CPU.
 /**
  * Always returns false with the CUDA backend.
@@ -267,6 +334,14 @@ inline bool is_cpu(const command_queue&) {
     return false;
 }
 
+/// Checks if the queue is associated with a sub-device.
+/**
+ * Device fission is not supported by the CUDA backend.
+ */
+inline bool is_sub_device(const command_queue&) {
+    return false;
+}
+
 /// Select devices by given criteria.
 /**
  * \param filter  Device filter functor. Functors may be combined with logical
@@ -294,19 +369,32 @@ std::vector<device> device_list(DevFilter&& filter) {
     return device;
 }
 
+/// Affinity domain used to split CPU devices into sub-devices.
+/**
+ * Device fission is not supported by the CUDA backend.
+ */
+typedef unsigned device_affinity_domain;
+
 /// Create command queues on devices by given criteria.
 /**
  * \param filter  Device filter functor. Functors may be combined with logical
  *                operators.
  * \param properties Command queue properties.
+ * \param shared_context Ignored with the CUDA backend, where each
+ *                device always gets its own context.
+ * \param fission Ignored with the CUDA backend.
  *
  * \returns list of queues accociated with selected devices.
  * \see device_list
  */
 template<class DevFilter>
 std::pair< std::vector<context>, std::vector<command_queue> >
-queue_list(DevFilter &&filter, unsigned queue_flags = 0)
+queue_list(DevFilter &&filter, unsigned queue_flags = 0,
+        bool shared_context = false, device_affinity_domain fission = 0)
 {
+    (void)shared_context;
+    (void)fission;
+
     cuda_check( do_init() );
 
     std::vector<context>       ctx;
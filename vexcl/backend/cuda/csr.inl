@@ -40,7 +40,8 @@ struct SpMatCSR : public sparse_matrix {
             const idx_t *row_begin, const idx_t *row_end,
             const col_t *col, const val_t *val,
             col_t col_begin, col_t col_end,
-            std::set<col_t> ghost_cols
+            std::set<col_t> ghost_cols,
+            const spmat_format_choice&
             ) : queue(queue)
     {
         auto is_local = [col_begin, col_end](col_t c) {
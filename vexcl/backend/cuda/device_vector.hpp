@@ -133,6 +133,19 @@ class device_vector {
             }
         }
 
+        /// Copies data from another buffer residing in the same context.
+        void copy_from(const command_queue &q, const device_vector &src,
+                size_t src_offset, size_t dst_offset, size_t size) const
+        {
+            if (size) {
+                q.context().set_current();
+                cuda_check( cuMemcpyDtoD(
+                            raw() + dst_offset * sizeof(T),
+                            src.raw() + src_offset * sizeof(T),
+                            size * sizeof(T)) );
+            }
+        }
+
         /// Returns size (in elements) of the memory buffer.
         size_t size() const {
             return n;
@@ -31,6 +31,9 @@ THE SOFTWARE.
  * \brief  OpenCL source code compilation wrapper.
  */
 
+#include <vector>
+#include <algorithm>
+
 #include <vexcl/backend/common.hpp>
 
 #ifndef __CL_ENABLE_EXCEPTIONS
@@ -53,11 +56,18 @@ inline void save_program_binaries(
     std::vector<size_t> sizes    = program.getInfo<CL_PROGRAM_BINARY_SIZES>();
     std::vector<char*>  binaries = program.getInfo<CL_PROGRAM_BINARIES>();
 
-    assert(sizes.size() == 1);
+    // The program is built for a single device, but it may be associated
+    // with a context shared by several devices. Binaries for the devices it
+    // was not built for are empty.
+    size_t idx = std::find_if(sizes.begin(), sizes.end(),
+            [](size_t s) { return s > 0; }) - sizes.begin();
+
+    assert(idx < sizes.size());
 
-    bfile.write((char*)&sizes[0], sizeof(size_t));
-    bfile.write(binaries[0], sizes[0]);
-    delete[] binaries[0];
+    bfile.write((char*)&sizes[idx], sizeof(size_t));
+    bfile.write(binaries[idx], sizes[idx]);
+
+    for(auto b = binaries.begin(); b != binaries.end(); ++b) delete[] *b;
 
     bfile << "\n" << source << "\n";
 }
@@ -108,7 +118,10 @@ inline cl::Program build_sources(
 #endif
 
     auto context = queue.getInfo<CL_QUEUE_CONTEXT>();
-    auto device  = context.getInfo<CL_CONTEXT_DEVICES>();
+
+    // The context may be shared by several devices; only build for the one
+    // the queue is attached to.
+    std::vector<cl::Device> device(1, queue.getInfo<CL_QUEUE_DEVICE>());
 
     std::string compile_options = options + " " + get_compile_options(queue);
 
@@ -32,7 +32,9 @@ THE SOFTWARE.
  */
 
 #include <vector>
+#include <utility>
 #include <iostream>
+#include <set>
 
 #ifndef __CL_ENABLE_EXCEPTIONS
 #  define __CL_ENABLE_EXCEPTIONS
@@ -65,19 +67,58 @@ inline device_id get_device_id(const command_queue &q) {
 }
 
 /// \cond INTERNAL
-typedef cl_context                  kernel_cache_key;
+/// Several devices may share a context, and kernels are configured per device.
+typedef std::pair<cl_context, cl_device_id> kernel_cache_key;
 /// Returns kernel cache key for the given queue.
 inline kernel_cache_key cache_key(const command_queue &q) {
-    return q.getInfo<CL_QUEUE_CONTEXT>()();
+    return std::make_pair(
+            q.getInfo<CL_QUEUE_CONTEXT>()(), q.getInfo<CL_QUEUE_DEVICE>()()
+            );
 }
 /// \endcond
 
+/// Checks if the two queues belong to the same context.
+/**
+ * Device memory may be copied directly between queues sharing a context.
+ */
+inline bool is_same_context(const command_queue &q1, const command_queue &q2) {
+    return q1.getInfo<CL_QUEUE_CONTEXT>()() == q2.getInfo<CL_QUEUE_CONTEXT>()();
+}
+
 /// Create command queue on the same context and device as the given one.
 inline command_queue duplicate_queue(const command_queue &q) {
     return command_queue(
             q.getInfo<CL_QUEUE_CONTEXT>(), q.getInfo<CL_QUEUE_DEVICE>());
 }
 
+/// Synchronization point that may be shared between command queues.
+typedef cl::Event event;
+
+/// Enqueues a marker into the queue.
+/**
+ * The returned event completes when all commands previously submitted to the
+ * queue have completed.
+ */
+inline event enqueue_marker(const command_queue &q) {
+    event e;
+#if defined(CL_VERSION_1_2)
+    const_cast<command_queue&>(q).enqueueMarkerWithWaitList(0, &e);
+#else
+    q.enqueueMarker(&e);
+#endif
+    return e;
+}
+
+/// Makes commands submitted to the queue after this call wait for the events.
+inline void enqueue_wait(const command_queue &q, const std::vector<event> &events) {
+    if (events.empty()) return;
+#if defined(CL_VERSION_1_2)
+    const_cast<command_queue&>(q).enqueueBarrierWithWaitList(&events);
+#else
+    q.enqueueWaitForEvents(events);
+#endif
+}
+
 /// Checks if the compute device is CPU.
 inline bool is_cpu(const command_queue &q) {
     cl::Device d = q.getInfo<CL_QUEUE_DEVICE>();
@@ -127,18 +168,88 @@ std::vector<cl::Device> device_list(DevFilter&& filter) {
     return device;
 }
 
+/// Affinity domain used to split CPU devices into sub-devices.
+/**
+ * One of CL_DEVICE_AFFINITY_DOMAIN_* constants (e.g.
+ * CL_DEVICE_AFFINITY_DOMAIN_NUMA). Zero means no splitting.
+ */
+typedef cl_bitfield device_affinity_domain;
+
+/// \cond INTERNAL
+// Sub-devices created by split_device(). These are recorded at creation, so
+// that allocations do not need to query the parent device (the query is not
+// supported by OpenCL 1.1 runtimes).
+inline std::set<cl_device_id>& sub_devices() {
+    static std::set<cl_device_id> dev;
+    return dev;
+}
+/// \endcond
+
+/// Checks if the queue is associated with a sub-device created by split_device().
+inline bool is_sub_device(const command_queue &q) {
+    const std::set<cl_device_id> &dev = sub_devices();
+    return !dev.empty() && dev.count(q.getInfo<CL_QUEUE_DEVICE>()());
+}
+
+/// Splits CPU device into sub-devices by the given affinity domain.
+/**
+ * Returns the device itself if it is not a CPU, if the splitting is not
+ * requested, or if it is not supported by the OpenCL implementation.
+ */
+inline std::vector<cl::Device> split_device(
+        const cl::Device &device, device_affinity_domain domain)
+{
+#if defined(CL_VERSION_1_2)
+    if (domain && (device.getInfo<CL_DEVICE_TYPE>() & CL_DEVICE_TYPE_CPU)) {
+        cl_device_partition_property prop[] = {
+            CL_DEVICE_PARTITION_BY_AFFINITY_DOMAIN,
+            static_cast<cl_device_partition_property>(domain),
+            0
+        };
+
+        try {
+            cl::Device d = device;
+            std::vector<cl::Device> sub;
+            d.createSubDevices(prop, &sub);
+            if (sub.size() > 1) {
+                for(auto s = sub.begin(); s != sub.end(); ++s)
+                    sub_devices().insert((*s)());
+                return sub;
+            }
+        } catch(const cl::Error&) {
+            // Partitioning is not supported. Use the whole device.
+        }
+    }
+#else
+    (void)domain;
+#endif
+
+    return std::vector<cl::Device>(1, device);
+}
+
 /// Create command queues on devices by given criteria.
 /**
  * \param filter  Device filter functor. Functors may be combined with logical
  *                operators.
  * \param properties Command queue properties.
+ * \param shared_context When set, a single context is created for all
+ *                selected devices of a platform. This allows to copy data
+ *                between the devices without a round trip through host memory.
+ *                Otherwise, each device gets its own context.
+ * \param fission Affinity domain to split the selected CPU devices by (see
+ *                split_device()). Each of the sub-devices gets its own queue,
+ *                and hence its own partition of vexcl containers. Splitting
+ *                by NUMA node keeps memory of each partition local to the
+ *                cores that process it.
  *
  * \returns list of queues accociated with selected devices.
  * \see device_list
  */
 template<class DevFilter>
 std::pair<std::vector<cl::Context>, std::vector<command_queue>>
-queue_list(DevFilter &&filter, cl_command_queue_properties properties = 0) {
+queue_list(DevFilter &&filter, cl_command_queue_properties properties = 0,
+        bool shared_context = false, device_affinity_domain fission = 0)
+{
     std::vector<cl::Context>      context;
     std::vector<command_queue> queue;
 
@@ -155,11 +266,27 @@ queue_list(DevFilter &&filter, cl_command_queue_properties properties = 0) {
             if (!d->getInfo<CL_DEVICE_AVAILABLE>()) continue;
             if (!filter(*d)) continue;
 
-            device.push_back(*d);
+            std::vector<cl::Device> sub = split_device(*d, fission);
+            device.insert(device.end(), sub.begin(), sub.end());
         }
 
         if (device.empty()) continue;
 
+        if (shared_context) {
+            try {
+                cl::Context c(device);
+
+                for(auto d = device.begin(); d != device.end(); d++) {
+                    queue.push_back(command_queue(c, *d, properties));
+                    context.push_back(c);
+                }
+            } catch(const cl::Error&) {
+                // Something bad happened. Better skip this platform.
+            }
+
+            continue;
+        }
+
         for(auto d = device.begin(); d != device.end(); d++)
             try {
                 context.push_back(cl::Context(std::vector<cl::Device>(1, *d)));
@@ -86,6 +86,17 @@ class device_vector {
                         );
         }
 
+        /// Copies data from another buffer residing in the same context.
+        void copy_from(const cl::CommandQueue &q, const device_vector &src,
+                size_t src_offset, size_t dst_offset, size_t size) const
+        {
+            if (size)
+                q.enqueueCopyBuffer(src.buffer, buffer,
+                        sizeof(T) * src_offset, sizeof(T) * dst_offset,
+                        sizeof(T) * size
+                        );
+        }
+
         size_t size() const {
             return buffer.getInfo<CL_MEM_SIZE>() / sizeof(T);
         }
@@ -0,0 +1,352 @@
+#ifndef VEXCL_BATCHED_HPP
+#define VEXCL_BATCHED_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2026 Denis Demidov <ddemidov@ksu.ru>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/batched.hpp
+ * \author Denis Demidov <ddemidov@ksu.ru>
+ * \brief  Batched factorizations and solves of small dense systems.
+ */
+
+#include <vector>
+#include <map>
+#include <string>
+#include <sstream>
+#include <cmath>
+
+#include <vexcl/vector.hpp>
+#include <vexcl/operations.hpp>
+#include <vexcl/dynamic_multivector.hpp>
+
+namespace vex {
+
+/// \cond INTERNAL
+namespace detail {
+
+// Factorization of a batch of small dense matrices, shared by batched_lu
+// and batched_cholesky.
+//
+// Matrices are stored in a dynamic multivector with a row per system and
+// N * N components, (i, j) element being the (i * N + j)-th component. With
+// the layout::soa layout the system index is the fastest changing one, so
+// that a thread per system results in coalesced memory access. Kernels are
+// generated for the specific block size, so that all loops have compile
+// time bounds and the right-hand side is kept in a private array.
+template <typename T>
+class batched_factorization {
+    public:
+        /// Block size.
+        size_t block_size() const {
+            return N;
+        }
+
+        /// Number of systems in the batch.
+        size_t size() const {
+            return A.size();
+        }
+
+        /// Solves the systems in place.
+        /**
+         * x is a multivector with a row per system and N components. Any
+         * layout may be used; layout::aos corresponds to the natural ordering
+         * of unknowns in a block-Jacobi preconditioner.
+         */
+        void solve(dynamic_multivector<T> &x) const {
+            precondition(x.components() == N, "Wrong number of components in batched solve");
+            precondition(x.row_partition() == A.row_partition(),
+                    "Incompatible multivector in batched solve");
+
+            const std::vector<backend::command_queue> &queue = A.queue_list();
+            const std::vector<size_t> &rpart = A.row_partition();
+
+            static std::map<std::string, kernel_cache> cache;
+
+            for(unsigned d = 0; d < queue.size(); d++) {
+                size_t n = rpart[d + 1] - rpart[d];
+                if (!n) continue;
+
+                const backend::command_queue &q = queue[d];
+
+                backend::source_generator src(q);
+                define_accessors(src, x.storage_layout());
+
+                src.kernel("batched_solve").open("(")
+                    .template parameter< size_t              >("n")
+                    .template parameter< global_ptr<const T> >("a")
+                    .template parameter< global_ptr<const int> >("perm")
+                    .template parameter< global_ptr<T>       >("x")
+                    .close(")").open("{");
+
+                src.grid_stride_loop().open("{");
+                src.new_line() << type_name<T>() << " y[" << N << "];";
+                src.new_line() << "for(int i = 0; i < " << N << "; ++i) y[i] = X(i);";
+
+                if (cholesky) {
+                    // L y = b
+                    src.new_line() << "for(int i = 0; i < " << N << "; ++i)";
+                    src.open("{");
+                    src.new_line() << type_name<T>() << " s = y[i];";
+                    src.new_line() << "for(int j = 0; j < i; ++j) s -= A(i, j) * y[j];";
+                    src.new_line() << "y[i] = s / A(i, i);";
+                    src.close("}");
+
+                    // L^T x = y
+                    src.new_line() << "for(int i = " << N - 1 << "; i >= 0; --i)";
+                    src.open("{");
+                    src.new_line() << type_name<T>() << " s = y[i];";
+                    src.new_line() << "for(int j = i + 1; j < " << N << "; ++j) s -= A(j, i) * y[j];";
+                    src.new_line() << "y[i] = s / A(i, i);";
+                    src.close("}");
+                } else {
+                    // P b
+                    src.new_line() << "for(int k = 0; k < " << N << "; ++k)";
+                    src.open("{");
+                    src.new_line() << "int p = perm[k * n + idx];";
+                    src.new_line() << type_name<T>() << " t = y[k]; y[k] = y[p]; y[p] = t;";
+                    src.close("}");
+
+                    // L y = P b, unit diagonal
+                    src.new_line() << "for(int i = 1; i < " << N << "; ++i)";
+                    src.open("{");
+                    src.new_line() << type_name<T>() << " s = y[i];";
+                    src.new_line() << "for(int j = 0; j < i; ++j) s -= A(i, j) * y[j];";
+                    src.new_line() << "y[i] = s;";
+                    src.close("}");
+
+                    // U x = y
+                    src.new_line() << "for(int i = " << N - 1 << "; i >= 0; --i)";
+                    src.open("{");
+                    src.new_line() << type_name<T>() << " s = y[i];";
+                    src.new_line() << "for(int j = i + 1; j < " << N << "; ++j) s -= A(i, j) * y[j];";
+                    src.new_line() << "y[i] = s / A(i, i);";
+                    src.close("}");
+                }
+
+                src.new_line() << "for(int i = 0; i < " << N << "; ++i) X(i) = y[i];";
+                src.close("}");
+
+                src.close("}");
+                undef_accessors(src);
+
+                kernel_cache &c = cache[src.str()];
+
+                auto key    = backend::cache_key(q);
+                auto kernel = c.find(key);
+
+                backend::select_context(q);
+
+                if (kernel == c.end()) {
+                    backend::kernel krn(q, src.str(), "batched_solve");
+                    kernel = c.insert(std::make_pair(key, krn)).first;
+                }
+
+                kernel->second.push_arg(n);
+                kernel->second.push_arg(A(d));
+                kernel->second.push_arg(perm[d]);
+                kernel->second.push_arg(x(d));
+
+                kernel->second(q);
+            }
+        }
+    protected:
+        batched_factorization(dynamic_multivector<T> &A, bool cholesky)
+            : A(A), cholesky(cholesky),
+              N(static_cast<size_t>(std::sqrt(static_cast<double>(A.components())) + 0.5))
+        {
+            precondition(N * N == A.components() && N > 0,
+                    "Number of components in a batch of matrices should be a square");
+
+            factorize();
+        }
+    private:
+        dynamic_multivector<T> &A;
+        bool cholesky;
+        size_t N;
+
+        std::vector< backend::device_vector<int> > perm;
+
+        // Element accessors for the generated kernels.
+        void define_accessors(backend::source_generator &src, vex::layout xlay) const {
+            src.new_line() << "#define A(i, j) a[";
+            if (A.storage_layout() == layout::soa)
+                src << "((i) * " << N << " + (j)) * n + idx]";
+            else
+                src << "idx * " << N * N << " + (i) * " << N << " + (j)]";
+
+            src.new_line() << "#define X(i) x[";
+            if (xlay == layout::soa)
+                src << "(i) * n + idx]";
+            else
+                src << "idx * " << N << " + (i)]";
+        }
+
+        static void undef_accessors(backend::source_generator &src) {
+            src.new_line() << "#undef A";
+            src.new_line() << "#undef X";
+        }
+
+        void factorize() {
+            const std::vector<backend::command_queue> &queue = A.queue_list();
+            const std::vector<size_t> &rpart = A.row_partition();
+
+            static std::map<std::string, kernel_cache> cache;
+
+            perm.resize(queue.size());
+
+            for(unsigned d = 0; d < queue.size(); d++) {
+                size_t n = rpart[d + 1] - rpart[d];
+                if (!n) continue;
+
+                const backend::command_queue &q = queue[d];
+
+                // Pivots are only needed for LU, but the solve kernel
+                // signature is the same for both factorizations.
+                perm[d] = backend::device_vector<int>(q, cholesky ? 1 : N * n);
+
+                backend::source_generator src(q);
+                define_accessors(src, layout::soa);
+
+                src.kernel("batched_factorize").open("(")
+                    .template parameter< size_t          >("n")
+                    .template parameter< global_ptr<T>   >("a")
+                    .template parameter< global_ptr<int> >("perm")
+                    .close(")").open("{");
+
+                src.grid_stride_loop().open("{");
+
+                if (cholesky) {
+                    src.new_line() << "for(int k = 0; k < " << N << "; ++k)";
+                    src.open("{");
+                    src.new_line() << type_name<T>() << " s = A(k, k);";
+                    src.new_line() << "for(int l = 0; l < k; ++l) s -= A(k, l) * A(k, l);";
+                    src.new_line() << type_name<T>() << " d = sqrt(s);";
+                    src.new_line() << "A(k, k) = d;";
+                    src.new_line() << "for(int i = k + 1; i < " << N << "; ++i)";
+                    src.open("{");
+                    src.new_line() << type_name<T>() << " t = A(i, k);";
+                    src.new_line() << "for(int l = 0; l < k; ++l) t -= A(i, l) * A(k, l);";
+                    src.new_line() << "A(i, k) = t / d;";
+                    src.close("}");
+                    src.close("}");
+                } else {
+                    src.new_line() << "for(int k = 0; k < " << N << "; ++k)";
+                    src.open("{");
+                    src.new_line() << "int p = k;";
+                    src.new_line() << type_name<T>() << " amax = fabs(A(k, k));";
+                    src.new_line() << "for(int i = k + 1; i < " << N << "; ++i)";
+                    src.open("{");
+                    src.new_line() << type_name<T>() << " v = fabs(A(i, k));";
+                    src.new_line() << "if (v > amax) { amax = v; p = i; }";
+                    src.close("}");
+                    src.new_line() << "perm[k * n + idx] = p;";
+                    src.new_line() << "if (p != k)";
+                    src.open("{");
+                    src.new_line() << "for(int j = 0; j < " << N << "; ++j)";
+                    src.open("{");
+                    src.new_line() << type_name<T>() << " t = A(k, j); A(k, j) = A(p, j); A(p, j) = t;";
+                    src.close("}");
+                    src.close("}");
+                    src.new_line() << type_name<T>() << " d = 1 / A(k, k);";
+                    src.new_line() << "for(int i = k + 1; i < " << N << "; ++i)";
+                    src.open("{");
+                    src.new_line() << type_name<T>() << " l = A(i, k) * d;";
+                    src.new_line() << "A(i, k) = l;";
+                    src.new_line() << "for(int j = k + 1; j < " << N << "; ++j) A(i, j) -= l * A(k, j);";
+                    src.close("}");
+                    src.close("}");
+                }
+
+                src.close("}");
+
+                src.close("}");
+                undef_accessors(src);
+
+                kernel_cache &c = cache[src.str()];
+
+                auto key    = backend::cache_key(q);
+                auto kernel = c.find(key);
+
+                backend::select_context(q);
+
+                if (kernel == c.end()) {
+                    backend::kernel krn(q, src.str(), "batched_factorize");
+                    kernel = c.insert(std::make_pair(key, krn)).first;
+                }
+
+                kernel->second.push_arg(n);
+                kernel->second.push_arg(A(d));
+                kernel->second.push_arg(perm[d]);
+
+                kernel->second(q);
+            }
+        }
+};
+
+} // namespace detail
+/// \endcond
+
+/// LU factorization of a batch of small dense matrices.
+/**
+ * Factorizes in place a batch of N x N matrices stored in a dynamic
+ * multivector with a row per system and N * N components, (i, j) element of
+ * a matrix being the (i * N + j)-th component. Partial pivoting is used. The
+ * layout::soa layout (the default) places the system index innermost, so
+ * that memory accesses of the factorization and the solve are coalesced.
+ * The multivector holds the factors afterwards, and should outlive the
+ * factorization object.
+ * \code
+ * vex::dynamic_multivector<double> A(ctx, nsys, N * N, host_matrices);
+ * vex::dynamic_multivector<double> x(ctx, nsys, N, host_rhs);
+ *
+ * vex::batched_lu<double> lu(A);
+ * lu.solve(x);
+ * \endcode
+ */
+template <typename T>
+class batched_lu : public detail::batched_factorization<T> {
+    public:
+        /// Factorizes the batch in place.
+        batched_lu(dynamic_multivector<T> &A)
+            : detail::batched_factorization<T>(A, false) {}
+};
+
+/// Cholesky factorization of a batch of small symmetric positive definite matrices.
+/**
+ * Same as vex::batched_lu, but computes \f$A = LL^T\f$ without pivoting.
+ * The lower triangle of each matrix is replaced with L; the upper triangle
+ * is left intact and is not referenced.
+ */
+template <typename T>
+class batched_cholesky : public detail::batched_factorization<T> {
+    public:
+        /// Factorizes the batch in place.
+        batched_cholesky(dynamic_multivector<T> &A)
+            : detail::batched_factorization<T>(A, true) {}
+};
+
+} // namespace vex
+
+#endif
@@ -0,0 +1,924 @@
+#ifndef VEXCL_DENSE_HPP
+#define VEXCL_DENSE_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2026 Denis Demidov <ddemidov@ksu.ru>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/dense.hpp
+ * \author Denis Demidov <ddemidov@ksu.ru>
+ * \brief  Dense matrices and dense matrix products.
+ */
+
+#include <vector>
+#include <algorithm>
+#include <memory>
+
+#include <vexcl/vector.hpp>
+#include <vexcl/operations.hpp>
+#include <vexcl/dynamic_multivector.hpp>
+
+namespace vex {
+
+/// Storage order of dense matrix elements.
+enum class matrix_order {
+    row_major, ///< Elements of a row are stored contiguously.
+    col_major  ///< Elements of a column are stored contiguously.
+};
+
+/// \cond INTERNAL
+namespace detail {
+
+// Tile size for the dense matrix-matrix product. The product kernel is
+// launched with tile x tile workgroups and keeps a tile of each operand in
+// local memory.
+inline size_t gemm_tile_size(const backend::command_queue &q,
+        const backend::kernel &krn, size_t value_size)
+{
+    if (backend::is_cpu(q)) return 1;
+
+    size_t max_ws   = krn.max_threads_per_block(q);
+    size_t max_smem = krn.max_shared_memory_per_block(q);
+
+    size_t tile = 16;
+    while(tile > 1 && (tile * tile > max_ws || 2 * tile * tile * value_size > max_smem))
+        tile /= 2;
+
+    return tile;
+}
+
+// Allocates a buffer of n elements on each of the given devices, unless it
+// already has the required size.
+template <typename T>
+void reserve_replicas(const std::vector<backend::command_queue> &queue, size_t n,
+        std::vector< backend::device_vector<T> > &rep, std::vector<size_t> &rep_size)
+{
+    rep.resize(queue.size());
+    rep_size.resize(queue.size(), 0);
+
+    for(unsigned d = 0; d < queue.size(); d++) {
+        if (rep_size[d] != n) {
+            rep[d]      = backend::device_vector<T>(queue[d], n);
+            rep_size[d] = n;
+        }
+    }
+}
+
+// Copies host data into a single buffer on each of the given devices.
+template <typename T>
+void replicate(const std::vector<backend::command_queue> &queue,
+        const std::vector<T> &host,
+        std::vector< backend::device_vector<T> > &rep, std::vector<size_t> &rep_size)
+{
+    reserve_replicas(queue, host.size(), rep, rep_size);
+
+    for(unsigned d = 0; d < queue.size(); d++)
+        rep[d].write(queue[d], 0, host.size(), host.data(), true);
+}
+
+// Copies contents of a distributed vector into a single buffer on each of
+// the given devices. Parts of the vector residing in the same context as
+// the target device are copied directly, the rest is staged through host
+// memory.
+template <typename T>
+void replicate(const std::vector<backend::command_queue> &queue,
+        const vector<T> &x,
+        std::vector< backend::device_vector<T> > &rep, std::vector<size_t> &rep_size)
+{
+    const std::vector<backend::command_queue> &xq = x.queue_list();
+    const std::vector<size_t> &xp = x.partition();
+
+    reserve_replicas(queue, x.size(), rep, rep_size);
+
+    // Make sure x is ready on all devices.
+    for(unsigned p = 0; p < xq.size(); p++) xq[p].finish();
+
+    std::vector<T> host;
+
+    for(unsigned d = 0; d < queue.size(); d++) {
+        for(unsigned p = 0; p < xq.size(); p++) {
+            size_t size = xp[p + 1] - xp[p];
+            if (!size) continue;
+
+            if (backend::is_same_context(xq[p], queue[d])) {
+                rep[d].copy_from(queue[d], x(p), 0, xp[p], size);
+            } else {
+                if (host.empty()) {
+                    host.resize(x.size());
+                    vex::copy(x, host);
+                }
+
+                rep[d].write(queue[d], xp[p], size, &host[xp[p]], true);
+            }
+        }
+    }
+}
+
+// Checks if the queues are attached to the same device in the same context.
+inline bool same_device(const backend::command_queue &q1, const backend::command_queue &q2) {
+    return backend::is_same_context(q1, q2) &&
+        backend::get_device_id(q1) == backend::get_device_id(q2);
+}
+
+} // namespace detail
+/// \endcond
+
+/// Dense matrix.
+/**
+ * The matrix is partitioned across the compute devices by rows, each device
+ * holding all columns of its rows. Within a partition the elements are
+ * stored either in row-major or in column-major order. The order is also
+ * used for host data passed to the constructor, read() and write().
+ *
+ * Matrix-vector products may be used in additive expressions, so that the
+ * matrix may be passed to iterative solvers:
+ * \code
+ * vex::dense_matrix<double> A(ctx, n, m, host.data());
+ * vex::vector<double> x(ctx, m), y(ctx, n);
+ * y = A * x;
+ * \endcode
+ * Matrix-vector products are computed by a workgroup per row for row-major
+ * matrices, and by a thread per row with a local memory tile of x for
+ * column-major matrices. Matrix-matrix products are computed by
+ * vex::gemm().
+ */
+template <typename T>
+class dense_matrix {
+    public:
+        typedef T value_type;
+
+        /// Empty constructor.
+        dense_matrix() : n(0), m(0), ord(matrix_order::row_major) {}
+
+        /// Allocates n x m matrix.
+        dense_matrix(const std::vector<backend::command_queue> &queue,
+                size_t n, size_t m, matrix_order ord = matrix_order::row_major)
+            : n(n), m(m), ord(ord), rpart(vex::partition(n, queue))
+        {
+            allocate(queue);
+        }
+
+        /// Allocates n x m matrix and copies host data to it.
+        dense_matrix(const std::vector<backend::command_queue> &queue,
+                size_t n, size_t m, const T *host,
+                matrix_order ord = matrix_order::row_major)
+            : n(n), m(m), ord(ord), rpart(vex::partition(n, queue))
+        {
+            allocate(queue);
+            if (host) write(host);
+        }
+
+        /// Number of rows.
+        size_t rows() const {
+            return n;
+        }
+
+        /// Number of columns.
+        size_t cols() const {
+            return m;
+        }
+
+        /// Storage order of the elements.
+        matrix_order order() const {
+            return ord;
+        }
+
+        /// Row partitioning of the matrix across devices.
+        const std::vector<size_t>& row_partition() const {
+            return rpart;
+        }
+
+        /// Command queues the matrix is allocated on.
+        const std::vector<backend::command_queue>& queue_list() const {
+            return data.queue_list();
+        }
+
+        /// Flat storage of the matrix.
+        /**
+         * May be used in elementwise vector expressions.
+         */
+        const vector<T>& vec() const {
+            return data;
+        }
+
+        /// Flat storage of the matrix.
+        vector<T>& vec() {
+            return data;
+        }
+
+        /// Returns device buffer of d-th partition.
+        const backend::device_vector<T>& operator()(unsigned d = 0) const {
+            return data(d);
+        }
+
+        /// Position of i-th row, j-th column in the flat storage of the device.
+        size_t local_index(unsigned d, size_t i, size_t j) const {
+            return ord == matrix_order::row_major ?
+                i * m + j : j * (rpart[d + 1] - rpart[d]) + i;
+        }
+
+        /// Returns element in i-th row and j-th column.
+        typename vector<T>::element operator()(size_t i, size_t j) {
+            unsigned d = row_owner(i);
+            return data[data.part_start(d) + local_index(d, i - rpart[d], j)];
+        }
+
+        /// Returns element in i-th row and j-th column.
+        T operator()(size_t i, size_t j) const {
+            unsigned d = row_owner(i);
+            T val;
+            data(d).read(data.queue_list()[d], local_index(d, i - rpart[d], j), 1, &val, true);
+            return val;
+        }
+
+        /// Copies matrix data to host.
+        void read(T *host) const {
+            const std::vector<backend::command_queue> &queue = data.queue_list();
+
+            std::vector<T> tmp;
+            for(unsigned d = 0; d < queue.size(); d++) {
+                size_t rows = rpart[d + 1] - rpart[d];
+                if (!rows) continue;
+
+                if (ord == matrix_order::row_major) {
+                    data(d).read(queue[d], 0, rows * m, host + rpart[d] * m, true);
+                    continue;
+                }
+
+                tmp.resize(rows * m);
+                data(d).read(queue[d], 0, tmp.size(), tmp.data(), true);
+
+                for(size_t j = 0; j < m; ++j)
+                    for(size_t i = 0; i < rows; ++i)
+                        host[j * n + rpart[d] + i] = tmp[j * rows + i];
+            }
+        }
+
+        /// Copies host data to the matrix.
+        void write(const T *host) {
+            const std::vector<backend::command_queue> &queue = data.queue_list();
+
+            std::vector<T> tmp;
+            for(unsigned d = 0; d < queue.size(); d++) {
+                size_t rows = rpart[d + 1] - rpart[d];
+                if (!rows) continue;
+
+                if (ord == matrix_order::row_major) {
+                    data(d).write(queue[d], 0, rows * m, host + rpart[d] * m, true);
+                    continue;
+                }
+
+                tmp.resize(rows * m);
+                for(size_t j = 0; j < m; ++j)
+                    for(size_t i = 0; i < rows; ++i)
+                        tmp[j * rows + i] = host[j * n + rpart[d] + i];
+
+                data(d).write(queue[d], 0, tmp.size(), tmp.data(), true);
+            }
+        }
+
+        /// Matrix-vector product.
+        /**
+         * Computes y = alpha * A * x, or y += alpha * A * x if append is set.
+         * The partitioning of y should match the row partitioning of the
+         * matrix. With several devices, x is gathered on each of them
+         * (directly, when the devices share a context).
+         */
+        void apply(const vector<T> &x, vector<T> &y,
+                T alpha = 1, bool append = false) const
+        {
+            precondition(x.size() == m, "Wrong vector size in dense matrix-vector product");
+            precondition(y.partition() == rpart, "Incompatible vector in dense matrix-vector product");
+
+            const std::vector<backend::command_queue> &queue = data.queue_list();
+
+            bool local_x = queue.size() == 1 && x.nparts() == 1 &&
+                detail::same_device(queue[0], x.queue_list()[0]);
+
+            if (!local_x) detail::replicate(queue, x, xrep, xrep_size);
+
+            for(unsigned d = 0; d < queue.size(); d++) {
+                size_t rows = rpart[d + 1] - rpart[d];
+                if (!rows) continue;
+
+                const backend::command_queue &q = queue[d];
+
+                if (ord == matrix_order::row_major)
+                    gemv_rm(q, rows, data(d), local_x ? x(0) : xrep[d], y(d), alpha, append);
+                else
+                    gemv_cm(q, rows, data(d), local_x ? x(0) : xrep[d], y(d), alpha, append);
+            }
+        }
+    private:
+        size_t n, m;
+        matrix_order ord;
+        std::vector<size_t> rpart;
+        vector<T> data;
+
+        mutable std::vector< backend::device_vector<T> > xrep;
+        mutable std::vector<size_t> xrep_size;
+
+        void allocate(const std::vector<backend::command_queue> &queue) {
+            std::vector<size_t> part = rpart;
+
+            for(auto p = part.begin(); p != part.end(); ++p)
+                *p *= m;
+
+            data = vector<T>(part, queue);
+        }
+
+        unsigned row_owner(size_t i) const {
+            return static_cast<unsigned>(
+                    std::upper_bound(rpart.begin(), rpart.end(), i) - rpart.begin() - 1);
+        }
+
+        // Row-major product: a workgroup per row, threads of the group take
+        // interleaved columns and reduce their partial sums in local memory.
+        void gemv_rm(const backend::command_queue &q, size_t rows,
+                const backend::device_vector<T> &A,
+                const backend::device_vector<T> &x,
+                const backend::device_vector<T> &y,
+                T alpha, bool append) const
+        {
+            using namespace detail;
+
+            static kernel_cache cache;
+
+            auto key    = backend::cache_key(q);
+            auto kernel = cache.find(key);
+
+            backend::select_context(q);
+
+            if (kernel == cache.end()) {
+                backend::source_generator src(q);
+
+                src.kernel("dense_gemv_rm")
+                    .open("(")
+                        .template parameter< size_t              >("n")
+                        .template parameter< size_t              >("m")
+                        .template parameter< global_ptr<const T> >("A")
+                        .template parameter< global_ptr<const T> >("x")
+                        .template parameter< global_ptr<T>       >("y")
+                        .template parameter< T                   >("alpha")
+                        .template parameter< int                 >("append")
+                        .template smem_parameter<T>()
+                    .close(")").open("{");
+
+                src.smem_declaration<T>();
+                src.new_line() << type_name< shared_ptr<T> >() << " sdata = smem;";
+                src.new_line() << "size_t tid = " << src.local_id(0) << ";";
+                src.new_line() << "size_t block_size = " << src.local_size(0) << ";";
+                src.new_line() << "size_t ngroups = " << src.global_size(0) << " / block_size;";
+
+                src.new_line() << "for(size_t i = " << src.group_id(0) << "; i < n; i += ngroups)";
+                src.open("{");
+                src.new_line() << type_name<T>() << " s = 0;";
+                src.new_line() << "for(size_t j = tid; j < m; j += block_size) s += A[i * m + j] * x[j];";
+                src.new_line() << "sdata[tid] = s;";
+                src.new_line().barrier();
+                src.new_line() << "for(size_t w = block_size / 2; w > 0; w /= 2)";
+                src.open("{");
+                src.new_line() << "if (tid < w) sdata[tid] += sdata[tid + w];";
+                src.new_line().barrier();
+                src.close("}");
+                src.new_line() << "if (tid == 0) y[i] = append ? y[i] + alpha * sdata[0] : alpha * sdata[0];";
+                src.new_line().barrier();
+                src.close("}");
+
+                src.close("}");
+
+                backend::kernel krn(q, src.str(), "dense_gemv_rm", sizeof(T));
+                kernel = cache.insert(std::make_pair(key, krn)).first;
+            }
+
+            kernel->second.push_arg(rows);
+            kernel->second.push_arg(m);
+            kernel->second.push_arg(A);
+            kernel->second.push_arg(x);
+            kernel->second.push_arg(y);
+            kernel->second.push_arg(alpha);
+            kernel->second.push_arg(static_cast<int>(append));
+            kernel->second.set_smem([](size_t wgs){ return wgs * sizeof(T); });
+
+            kernel->second(q);
+        }
+
+        // Column-major product: a thread per row. Columns are processed in
+        // chunks, with the corresponding chunk of x cached in local memory.
+        void gemv_cm(const backend::command_queue &q, size_t rows,
+                const backend::device_vector<T> &A,
+                const backend::device_vector<T> &x,
+                const backend::device_vector<T> &y,
+                T alpha, bool append) const
+        {
+            using namespace detail;
+
+            static kernel_cache cache;
+
+            auto key    = backend::cache_key(q);
+            auto kernel = cache.find(key);
+
+            backend::select_context(q);
+
+            if (kernel == cache.end()) {
+                backend::source_generator src(q);
+
+                src.kernel("dense_gemv_cm")
+                    .open("(")
+                        .template parameter< size_t              >("n")
+                        .template parameter< size_t              >("m")
+                        .template parameter< global_ptr<const T> >("A")
+                        .template parameter< global_ptr<const T> >("x")
+                        .template parameter< global_ptr<T>       >("y")
+                        .template parameter< T                   >("alpha")
+                        .template parameter< int                 >("append")
+                        .template smem_parameter<T>()
+                    .close(")").open("{");
+
+                src.smem_declaration<T>();
+                src.new_line() << type_name< shared_ptr<T> >() << " xs = smem;";
+                src.new_line() << "size_t tid = " << src.local_id(0) << ";";
+                src.new_line() << "size_t block_size = " << src.local_size(0) << ";";
+                src.new_line() << "size_t stride = " << src.global_size(0) << ";";
+
+                src.new_line() << "for(size_t b = " << src.group_id(0) << " * block_size; b < n; b += stride)";
+                src.open("{");
+                src.new_line() << "size_t i = b + tid;";
+                src.new_line() << type_name<T>() << " s = 0;";
+                src.new_line() << "for(size_t j0 = 0; j0 < m; j0 += block_size)";
+                src.open("{");
+                src.new_line() << "size_t jn = min(block_size, m - j0);";
+                src.new_line().barrier();
+                src.new_line() << "if (tid < jn) xs[tid] = x[j0 + tid];";
+                src.new_line().barrier();
+                src.new_line() << "if (i < n) for(size_t j = 0; j < jn; ++j) s += A[(j0 + j) * n + i] * xs[j];";
+                src.close("}");
+                src.new_line() << "if (i < n) y[i] = append ? y[i] + alpha * s : alpha * s;";
+                src.close("}");
+
+                src.close("}");
+
+                backend::kernel krn(q, src.str(), "dense_gemv_cm", sizeof(T));
+                kernel = cache.insert(std::make_pair(key, krn)).first;
+            }
+
+            kernel->second.push_arg(rows);
+            kernel->second.push_arg(m);
+            kernel->second.push_arg(A);
+            kernel->second.push_arg(x);
+            kernel->second.push_arg(y);
+            kernel->second.push_arg(alpha);
+            kernel->second.push_arg(static_cast<int>(append));
+            kernel->second.set_smem([](size_t wgs){ return wgs * sizeof(T); });
+
+            kernel->second(q);
+        }
+};
+
+/// \cond INTERNAL
+
+template <typename T>
+additive_operator< dense_matrix<T>, vector<T> >
+operator*(const dense_matrix<T> &A, const vector<T> &x)
+{
+    return additive_operator< dense_matrix<T>, vector<T> >(A, x);
+}
+
+/// \endcond
+
+/// Dense matrix-matrix product.
+/**
+ * Computes C = alpha * A * B + beta * C. The matrices may have any storage
+ * order. The row partitioning of C should match that of A. With several
+ * devices, B is gathered on each of them, so it is expected to be
+ * relatively small (e.g. a dense operator applied to a tall matrix).
+ *
+ * The product is computed by tile x tile workgroups, each of which keeps
+ * tiles of A and B in local memory and computes a tile of C.
+ */
+template <typename T>
+void gemm(const dense_matrix<T> &A, const dense_matrix<T> &B, dense_matrix<T> &C,
+        T alpha = 1, T beta = 0)
+{
+    using namespace detail;
+
+    precondition(A.cols() == B.rows(), "Inconsistent matrix sizes in gemm");
+    precondition(C.rows() == A.rows() && C.cols() == B.cols(),
+            "Inconsistent matrix sizes in gemm");
+    precondition(C.row_partition() == A.row_partition(),
+            "Incompatible matrix partitioning in gemm");
+    precondition(std::addressof(C) != std::addressof(A) && std::addressof(C) != std::addressof(B),
+            "Output of gemm should not alias its inputs");
+
+    const std::vector<backend::command_queue> &queue = A.queue_list();
+    const std::vector<size_t> &rpart = A.row_partition();
+
+    const size_t k = A.cols();
+    const size_t p = B.cols();
+
+    bool local_b = queue.size() == 1 && B.queue_list().size() == 1 &&
+        same_device(queue[0], B.queue_list()[0]);
+
+    std::vector< backend::device_vector<T> > brep;
+    std::vector<size_t> brep_size;
+
+    if (!local_b) {
+        std::vector<T> host(k * p);
+        B.read(host.data());
+        replicate(queue, host, brep, brep_size);
+    }
+
+    static kernel_cache cache;
+
+    for(unsigned d = 0; d < queue.size(); d++) {
+        size_t rows = rpart[d + 1] - rpart[d];
+        if (!rows) continue;
+
+        const backend::command_queue &q = queue[d];
+
+        auto key    = backend::cache_key(q);
+        auto kernel = cache.find(key);
+
+        backend::select_context(q);
+
+        if (kernel == cache.end()) {
+            backend::source_generator src(q);
+
+            src.kernel("dense_gemm")
+                .open("(")
+                    .template parameter< size_t              >("n")
+                    .template parameter< size_t              >("k")
+                    .template parameter< size_t              >("p")
+                    .template parameter< size_t              >("tile")
+                    .template parameter< int                 >("a_rm")
+                    .template parameter< int                 >("b_rm")
+                    .template parameter< int                 >("c_rm")
+                    .template parameter< global_ptr<const T> >("A")
+                    .template parameter< global_ptr<const T> >("B")
+                    .template parameter< global_ptr<T>       >("C")
+                    .template parameter< T                   >("alpha")
+                    .template parameter< T                   >("beta")
+                    .template smem_parameter<T>()
+                .close(")").open("{");
+
+            src.smem_declaration<T>();
+            src.new_line() << type_name< shared_ptr<T> >() << " As = smem;";
+            src.new_line() << type_name< shared_ptr<T> >() << " Bs = smem + tile * tile;";
+            src.new_line() << "size_t tid = " << src.local_id(0) << ";";
+            src.new_line() << "size_t lr = tid / tile;";
+            src.new_line() << "size_t lc = tid % tile;";
+            src.new_line() << "size_t ngroups = " << src.global_size(0) << " / " << src.local_size(0) << ";";
+            src.new_line() << "size_t tn = (n + tile - 1) / tile;";
+            src.new_line() << "size_t tp = (p + tile - 1) / tile;";
+
+            src.new_line() << "for(size_t t = " << src.group_id(0) << "; t < tn * tp; t += ngroups)";
+            src.open("{");
+            src.new_line() << "size_t i = (t / tp) * tile + lr;";
+            src.new_line() << "size_t j = (t % tp) * tile + lc;";
+            src.new_line() << type_name<T>() << " s = 0;";
+            src.new_line() << "for(size_t l0 = 0; l0 < k; l0 += tile)";
+            src.open("{");
+            src.new_line() << "size_t la = l0 + lc;";
+            src.new_line() << "size_t lb = l0 + lr;";
+            src.new_line() << "As[tid] = (i < n && la < k) ? A[a_rm ? i * k + la : la * n + i] : 0;";
+            src.new_line() << "Bs[tid] = (lb < k && j < p) ? B[b_rm ? lb * p + j : j * k + lb] : 0;";
+            src.new_line().barrier();
+            src.new_line() << "for(size_t l = 0; l < tile; ++l) s += As[lr * tile + l] * Bs[l * tile + lc];";
+            src.new_line().barrier();
+            src.close("}");
+            src.new_line() << "if (i < n && j < p)";
+            src.open("{");
+            src.new_line() << "size_t c = c_rm ? i * p + j : j * n + i;";
+            src.new_line() << "C[c] = (beta == 0) ? alpha * s : alpha * s + beta * C[c];";
+            src.close("}");
+            src.close("}");
+
+            src.close("}");
+
+            backend::kernel krn(q, src.str(), "dense_gemm");
+            kernel = cache.insert(std::make_pair(key, krn)).first;
+        }
+
+        size_t tile = gemm_tile_size(q, kernel->second, sizeof(T));
+        size_t ntiles = ((rows + tile - 1) / tile) * ((p + tile - 1) / tile);
+
+        kernel->second.config(
+                std::min(ntiles, backend::kernel::num_workgroups(q)), tile * tile);
+
+        kernel->second.push_arg(rows);
+        kernel->second.push_arg(k);
+        kernel->second.push_arg(p);
+        kernel->second.push_arg(tile);
+        kernel->second.push_arg(static_cast<int>(A.order() == matrix_order::row_major));
+        kernel->second.push_arg(static_cast<int>(B.order() == matrix_order::row_major));
+        kernel->second.push_arg(static_cast<int>(C.order() == matrix_order::row_major));
+        kernel->second.push_arg(A(d));
+        kernel->second.push_arg(local_b ? B(0) : brep[d]);
+        kernel->second.push_arg(C(d));
+        kernel->second.push_arg(alpha);
+        kernel->second.push_arg(beta);
+        kernel->second.set_smem([tile](size_t){ return 2 * tile * tile * sizeof(T); });
+
+        kernel->second(q);
+    }
+}
+
+/// \cond INTERNAL
+namespace detail {
+
+// Kernel for the product of a multivector and a small dense matrix S. When
+// local_s is set, S is cached in local memory of each workgroup, otherwise
+// it is read from global memory.
+template <typename T>
+backend::kernel& multivector_gemm_kernel(const backend::command_queue &q, bool local_s) {
+    static kernel_cache cache[2];
+
+    auto key    = backend::cache_key(q);
+    auto kernel = cache[local_s].find(key);
+
+    backend::select_context(q);
+
+    if (kernel == cache[local_s].end()) {
+        backend::source_generator src(q);
+
+        src.kernel("multivector_gemm")
+            .open("(")
+                .template parameter< size_t              >("n")
+                .template parameter< size_t              >("m")
+                .template parameter< size_t              >("p")
+                .template parameter< int                 >("x_aos")
+                .template parameter< int                 >("y_aos")
+                .template parameter< global_ptr<const T> >("X")
+                .template parameter< global_ptr<const T> >("S")
+                .template parameter< global_ptr<T>       >("Y")
+                .template parameter< T                   >("alpha")
+                .template parameter< T                   >("beta");
+
+        if (local_s) src.template smem_parameter<T>();
+
+        src.close(")").open("{");
+
+        if (local_s) {
+            src.smem_declaration<T>();
+            src.new_line() << type_name< shared_ptr<T> >() << " ss = smem;";
+            src.new_line() << "for(size_t e = " << src.local_id(0) << "; e < m * p; e += "
+                << src.local_size(0) << ") ss[e] = S[e];";
+            src.new_line().barrier();
+        } else {
+            src.new_line() << type_name< global_ptr<const T> >() << " ss = S;";
+        }
+
+        src.grid_stride_loop("i").open("{");
+        src.new_line() << "for(size_t b = 0; b < p; ++b)";
+        src.open("{");
+        src.new_line() << type_name<T>() << " s = 0;";
+        src.new_line() << "for(size_t a = 0; a < m; ++a) s += X[x_aos ? i * m + a : a * n + i] * ss[a * p + b];";
+        src.new_line() << "size_t c = y_aos ? i * p + b : b * n + i;";
+        src.new_line() << "Y[c] = (beta == 0) ? alpha * s : alpha * s + beta * Y[c];";
+        src.close("}");
+        src.close("}");
+
+        src.close("}");
+
+        backend::kernel krn(q, src.str(), "multivector_gemm");
+        kernel = cache[local_s].insert(std::make_pair(key, krn)).first;
+    }
+
+    return kernel->second;
+}
+
+} // namespace detail
+/// \endcond
+
+/// Product of a multivector and a small dense matrix.
+/**
+ * Computes Y = alpha * X * S + beta * Y, where X is n x m multivector, Y is
+ * n x p multivector, and S is m x p matrix stored on the host in row-major
+ * order. S is cached in local memory of each workgroup when it fits there
+ * (and is read from global memory otherwise), and each thread computes all
+ * components of a row of Y. X and Y should be distinct objects with the
+ * same row partitioning, but may have different layouts.
+ *
+ * Together with vex::block_dot() this provides block orthogonalization:
+ * \code
+ * // V -= Q * (Q^T V)
+ * vex::gemm(Q, vex::block_dot(Q, V), V, -1.0, 1.0);
+ * \endcode
+ */
+template <typename T>
+void gemm(const dynamic_multivector<T> &X, const std::vector<T> &S,
+        dynamic_multivector<T> &Y, T alpha = 1, T beta = 0)
+{
+    using namespace detail;
+
+    const size_t m = X.components();
+    const size_t p = Y.components();
+
+    precondition(S.size() == m * p, "Inconsistent matrix sizes in gemm");
+    precondition(X.row_partition() == Y.row_partition(),
+            "Incompatible multivectors in gemm");
+    precondition(std::addressof(X) != std::addressof(Y),
+            "Output of gemm should not alias its input");
+
+    const std::vector<backend::command_queue> &queue = X.queue_list();
+    const std::vector<size_t> &rpart = X.row_partition();
+
+    for(unsigned d = 0; d < queue.size(); d++) {
+        size_t rows = rpart[d + 1] - rpart[d];
+        if (!rows) continue;
+
+        const backend::command_queue &q = queue[d];
+
+        // S is kept in local memory when it fits there.
+        backend::kernel *krn = &multivector_gemm_kernel<T>(q, true);
+
+        bool local_s = m * p * sizeof(T) <= krn->max_shared_memory_per_block(q);
+        if (!local_s) krn = &multivector_gemm_kernel<T>(q, false);
+
+        backend::device_vector<T> s(q, m * p, S.data(), backend::MEM_READ_ONLY);
+
+        krn->push_arg(rows);
+        krn->push_arg(m);
+        krn->push_arg(p);
+        krn->push_arg(static_cast<int>(X.storage_layout() == layout::aos));
+        krn->push_arg(static_cast<int>(Y.storage_layout() == layout::aos));
+        krn->push_arg(X(d));
+        krn->push_arg(s);
+        krn->push_arg(Y(d));
+        krn->push_arg(alpha);
+        krn->push_arg(beta);
+
+        if (local_s) krn->set_smem([m, p](size_t){ return m * p * sizeof(T); });
+
+        (*krn)(q);
+    }
+}
+
+/// Block inner product of two multivectors.
+/**
+ * Returns m x p matrix \f$X^T Y\f$ in row-major order, where X is n x m
+ * multivector, and Y is n x p multivector. Each workgroup stages a block of
+ * rows of X and Y in local memory and accumulates its contribution to
+ * every entry of the product, with a thread per entry. Per-workgroup
+ * results are summed on the host.
+ */
+template <typename T>
+std::vector<T> block_dot(const dynamic_multivector<T> &X, const dynamic_multivector<T> &Y)
+{
+    using namespace detail;
+
+    const size_t m = X.components();
+    const size_t p = Y.components();
+
+    precondition(X.row_partition() == Y.row_partition(),
+            "Incompatible multivectors in block_dot");
+
+    const std::vector<backend::command_queue> &queue = X.queue_list();
+    const std::vector<size_t> &rpart = X.row_partition();
+
+    std::vector<T> res(m * p, T());
+
+    // Per-workgroup results of each device, read back once all kernels
+    // are submitted.
+    std::vector< backend::device_vector<T> > partial(queue.size());
+    std::vector< std::vector<T> > host(queue.size());
+
+    static kernel_cache cache;
+
+    for(unsigned d = 0; d < queue.size(); d++) {
+        size_t rows = rpart[d + 1] - rpart[d];
+        if (!rows) continue;
+
+        const backend::command_queue &q = queue[d];
+
+        auto key    = backend::cache_key(q);
+        auto kernel = cache.find(key);
+
+        backend::select_context(q);
+
+        if (kernel == cache.end()) {
+            backend::source_generator src(q);
+
+            src.kernel("block_dot")
+                .open("(")
+                    .template parameter< size_t              >("n")
+                    .template parameter< size_t              >("m")
+                    .template parameter< size_t              >("p")
+                    .template parameter< int                 >("x_aos")
+                    .template parameter< int                 >("y_aos")
+                    .template parameter< global_ptr<const T> >("X")
+                    .template parameter< global_ptr<const T> >("Y")
+                    .template parameter< global_ptr<T>       >("partial")
+                    .template smem_parameter<T>()
+                .close(")").open("{");
+
+            src.smem_declaration<T>();
+            src.new_line() << "size_t tid = " << src.local_id(0) << ";";
+            src.new_line() << "size_t block_size = " << src.local_size(0) << ";";
+            src.new_line() << "size_t ngroups = " << src.global_size(0) << " / block_size;";
+            src.new_line() << "size_t gid = " << src.group_id(0) << ";";
+            src.new_line() << type_name< shared_ptr<T> >() << " xs = smem;";
+            src.new_line() << type_name< shared_ptr<T> >() << " ys = xs + block_size * m;";
+            src.new_line() << type_name< shared_ptr<T> >() << " acc = ys + block_size * p;";
+
+            src.new_line() << "for(size_t e = tid; e < m * p; e += block_size) acc[e] = 0;";
+
+            src.new_line() << "size_t chunk = (n + ngroups - 1) / ngroups;";
+            src.new_line() << "size_t lo = min(n, gid * chunk);";
+            src.new_line() << "size_t hi = min(n, lo + chunk);";
+
+            src.new_line() << "for(size_t r0 = lo; r0 < hi; r0 += block_size)";
+            src.open("{");
+            src.new_line() << "size_t nr = min(block_size, hi - r0);";
+            src.new_line().barrier();
+            src.new_line() << "if (tid < nr)";
+            src.open("{");
+            src.new_line() << "size_t i = r0 + tid;";
+            src.new_line() << "for(size_t a = 0; a < m; ++a) xs[a * block_size + tid] = X[x_aos ? i * m + a : a * n + i];";
+            src.new_line() << "for(size_t b = 0; b < p; ++b) ys[b * block_size + tid] = Y[y_aos ? i * p + b : b * n + i];";
+            src.close("}");
+            src.new_line().barrier();
+            src.new_line() << "for(size_t e = tid; e < m * p; e += block_size)";
+            src.open("{");
+            src.new_line() << type_name< shared_ptr<T> >() << " xa = xs + (e / p) * block_size;";
+            src.new_line() << type_name< shared_ptr<T> >() << " yb = ys + (e % p) * block_size;";
+            src.new_line() << type_name<T>() << " s = acc[e];";
+            src.new_line() << "for(size_t r = 0; r < nr; ++r) s += xa[r] * yb[r];";
+            src.new_line() << "acc[e] = s;";
+            src.close("}");
+            src.close("}");
+
+            src.new_line().barrier();
+            src.new_line() << "for(size_t e = tid; e < m * p; e += block_size) partial[e * ngroups + gid] = acc[e];";
+
+            src.close("}");
+
+            backend::kernel krn(q, src.str(), "block_dot");
+            kernel = cache.insert(std::make_pair(key, krn)).first;
+        }
+
+        // Each thread owns a row of the staged block and a few entries of
+        // the accumulator.
+        auto smem = [m, p](size_t wgs) { return (wgs * (m + p) + m * p) * sizeof(T); };
+
+        kernel->second.config(q, smem);
+
+        size_t ngroups = backend::kernel::num_workgroups(q);
+
+        partial[d] = backend::device_vector<T>(q, m * p * ngroups);
+        host[d].resize(m * p * ngroups);
+
+        kernel->second.push_arg(rows);
+        kernel->second.push_arg(m);
+        kernel->second.push_arg(p);
+        kernel->second.push_arg(static_cast<int>(X.storage_layout() == layout::aos));
+        kernel->second.push_arg(static_cast<int>(Y.storage_layout() == layout::aos));
+        kernel->second.push_arg(X(d));
+        kernel->second.push_arg(Y(d));
+        kernel->second.push_arg(partial[d]);
+        kernel->second.set_smem(smem);
+
+        kernel->second(q);
+
+        partial[d].read(q, 0, host[d].size(), host[d].data());
+    }
+
+    for(unsigned d = 0; d < queue.size(); d++) {
+        if (host[d].empty()) continue;
+
+        queue[d].finish();
+
+        size_t ngroups = host[d].size() / (m * p);
+
+        for(size_t e = 0; e < m * p; ++e)
+            for(size_t g = 0; g < ngroups; ++g)
+                res[e] += host[d][e * ngroups + g];
+    }
+
+    return res;
+}
+
+} // namespace vex
+
+#endif
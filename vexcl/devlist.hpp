@@ -274,11 +274,27 @@ inline const Context& current_context() {
 class Context {
     public:
         /// Initialize context from a device filter.
+        /**
+         * When shared_context is set, devices of the same platform share a
+         * single backend context. This allows vexcl to exchange ghost values
+         * (e.g. in sparse matrix-vector products or stencil convolutions)
+         * directly between devices instead of staging them through host
+         * memory.
+         *
+         * When fission is nonzero, selected CPU devices are split into
+         * sub-devices by the given affinity domain (e.g.
+         * CL_DEVICE_AFFINITY_DOMAIN_NUMA), and each sub-device becomes a
+         * separate partition.
+         */
         template <class DevFilter>
         explicit Context(DevFilter&& filter,
-                backend::command_queue_properties properties = 0)
+                backend::command_queue_properties properties = 0,
+                bool shared_context = false,
+                backend::device_affinity_domain fission = 0)
         {
-            std::tie(c, q) = backend::queue_list(std::forward<DevFilter>(filter), properties);
+            std::tie(c, q) = backend::queue_list(
+                    std::forward<DevFilter>(filter), properties,
+                    shared_context, fission);
 
 #ifdef VEXCL_THROW_ON_EMPTY_CONTEXT
             precondition(!q.empty(), "No compute devices found");
@@ -0,0 +1,445 @@
+#ifndef VEXCL_DYNAMIC_MULTIVECTOR_HPP
+#define VEXCL_DYNAMIC_MULTIVECTOR_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2026 Denis Demidov <ddemidov@ksu.ru>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/dynamic_multivector.hpp
+ * \author Denis Demidov <ddemidov@ksu.ru>
+ * \brief  Multivector with number of components set at runtime.
+ */
+
+#include <vector>
+#include <string>
+
+#include <vexcl/operations.hpp>
+#include <vexcl/vector.hpp>
+
+namespace vex {
+
+/// Memory layout of dynamic_multivector components.
+enum class layout {
+    soa, ///< Structure of arrays: components are stored one after another.
+    aos  ///< Array of structures: components of each element are interleaved.
+};
+
+template <typename T> class dynamic_multivector;
+
+/// \cond INTERNAL
+namespace detail {
+
+// Checks that dynamic multivectors in an expression have the same shape and
+// layout as the one being assigned to. Elements are paired by their position
+// in the flat storage, so mixing layouts would mix up the components.
+template <typename T>
+struct check_multivector_shape {
+    const dynamic_multivector<T> &lhs;
+
+    check_multivector_shape(const dynamic_multivector<T> &lhs) : lhs(lhs) {}
+
+    template <class Term>
+    void operator()(const Term &term) const {
+        check(term);
+    }
+
+    void check(const dynamic_multivector<T> &x) const {
+        precondition(
+                x.size() == lhs.size() &&
+                x.components() == lhs.components() &&
+                x.storage_layout() == lhs.storage_layout(),
+                "Incompatible multivectors"
+                );
+    }
+
+    template <class Term>
+    void check(const Term&) const {}
+};
+
+} // namespace detail
+/// \endcond
+
+/// Multivector with number of components set at runtime.
+/**
+ * All components are stored in a single flat vex::vector, which is
+ * partitioned across the compute devices by rows (each device holds all
+ * components of its rows). Within a partition the components are either
+ * stored one after another (layout::soa), or interleaved (layout::aos). The
+ * interleaved layout is preferable when components are always accessed
+ * together, since all components of a row share a cache line. Sparse
+ * matrix-multivector products read such rows with vector loads (OpenCL
+ * backend).
+ *
+ * Elementwise expressions do not depend on the layout, and the multivector
+ * may be used in vector expressions together with other multivectors of the
+ * same shape and layout:
+ * \code
+ * vex::dynamic_multivector<double> X(ctx, n, m), Y(ctx, n, m);
+ * Y = 2 * X + Y;
+ * \endcode
+ */
+template <typename T>
+class dynamic_multivector : public vector_terminal_expression {
+    public:
+        typedef T value_type;
+
+        /// Empty constructor.
+        dynamic_multivector() : n(0), m(0), lay(layout::soa) {}
+
+        /// Allocates n x m multivector.
+        dynamic_multivector(const std::vector<backend::command_queue> &queue,
+                size_t n, size_t m, vex::layout lay = layout::soa)
+            : n(n), m(m), lay(lay), rpart(vex::partition(n, queue))
+        {
+            allocate(queue);
+        }
+
+        /// Allocates n x m multivector and copies host data to it.
+        /**
+         * Host data is stored by components: k-th component starts at
+         * host + k * n, regardless of the layout.
+         */
+        dynamic_multivector(const std::vector<backend::command_queue> &queue,
+                size_t n, size_t m, const T *host, vex::layout lay = layout::soa)
+            : n(n), m(m), lay(lay), rpart(vex::partition(n, queue))
+        {
+            allocate(queue);
+            if (host) write(host);
+        }
+
+        /// Copy constructor.
+        dynamic_multivector(const dynamic_multivector &x)
+            : data(x.data), n(x.n), m(x.m), lay(x.lay), rpart(x.rpart)
+        {}
+
+        /// Move constructor.
+        dynamic_multivector(dynamic_multivector &&x)
+            : n(0), m(0), lay(layout::soa)
+        {
+            swap(x);
+        }
+
+        /// Copies data of the multivector with the same shape and layout.
+        const dynamic_multivector& operator=(const dynamic_multivector &x) {
+            if (std::addressof(x) != this) assign<assign::SET>(x);
+            return *this;
+        }
+
+        /// Move assignment.
+        const dynamic_multivector& operator=(dynamic_multivector &&x) {
+            swap(x);
+            return *this;
+        }
+
+        /// Swap function.
+        void swap(dynamic_multivector &x) {
+            data.swap(x.data);
+            std::swap(n,     x.n);
+            std::swap(m,     x.m);
+            std::swap(lay,   x.lay);
+            std::swap(rpart, x.rpart);
+        }
+
+        // Vector expression assignments. Multivectors in the expression
+        // should have the same shape and layout.
+#define VEXCL_ASSIGNMENT(cop, op)                                              \
+  template <class Expr>                                                        \
+  typename std::enable_if<                                                     \
+      boost::proto::matches<                                                   \
+          typename boost::proto::result_of::as_expr<Expr>::type,               \
+          vector_expr_grammar>::value,                                         \
+      const dynamic_multivector &>::type operator cop(const Expr & expr) {     \
+    assign<op>(expr);                                                          \
+    return *this;                                                              \
+  }
+
+        VEXCL_ASSIGNMENT(=,   assign::SET)
+        VEXCL_ASSIGNMENT(+=,  assign::ADD)
+        VEXCL_ASSIGNMENT(-=,  assign::SUB)
+        VEXCL_ASSIGNMENT(*=,  assign::MUL)
+        VEXCL_ASSIGNMENT(/=,  assign::DIV)
+
+#undef VEXCL_ASSIGNMENT
+
+        /// Number of rows (size of each component).
+        size_t size() const {
+            return n;
+        }
+
+        /// Number of components.
+        size_t components() const {
+            return m;
+        }
+
+        /// Memory layout of the components.
+        vex::layout storage_layout() const {
+            return lay;
+        }
+
+        /// Row partitioning of the multivector across devices.
+        const std::vector<size_t>& row_partition() const {
+            return rpart;
+        }
+
+        /// Command queues of the multivector.
+        const std::vector<backend::command_queue>& queue_list() const {
+            return data.queue_list();
+        }
+
+        /// Position of i-th row, k-th component in the flat storage of the device.
+        size_t local_index(unsigned d, size_t i, size_t k) const {
+            return lay == layout::aos ?
+                i * m + k : k * (rpart[d + 1] - rpart[d]) + i;
+        }
+
+        /// Returns element in i-th row of k-th component.
+        typename vector<T>::element operator()(size_t i, size_t k) {
+            precondition(i < n && k < m, "Index out of bounds");
+            unsigned d = row_owner(i);
+            return data[data.part_start(d) + local_index(d, i - rpart[d], k)];
+        }
+
+        /// Returns element in i-th row of k-th component.
+        T operator()(size_t i, size_t k) const {
+            precondition(i < n && k < m, "Index out of bounds");
+            unsigned d = row_owner(i);
+            T val;
+            data(d).read(data.queue_list()[d], local_index(d, i - rpart[d], k), 1, &val, true);
+            return val;
+        }
+
+        /// Returns device buffer of d-th partition.
+        const backend::device_vector<T>& operator()(unsigned d = 0) const {
+            return data(d);
+        }
+
+        /// Copies k-th component into v.
+        void get(size_t k, vector<T> &v) const {
+            precondition(v.partition() == rpart, "Incompatible vector");
+            copy_component(k, v, true);
+        }
+
+        /// Copies v into k-th component.
+        void set(size_t k, const vector<T> &v) {
+            precondition(v.partition() == rpart, "Incompatible vector");
+            copy_component(k, v, false);
+        }
+
+        /// Copies multivector data to host.
+        /**
+         * Host data is stored by components: k-th component starts at
+         * host + k * n, regardless of the layout.
+         */
+        void read(T *host) const {
+            std::vector<T> tmp;
+            for(unsigned d = 0; d < data.nparts(); d++) {
+                size_t rows = rpart[d + 1] - rpart[d];
+                if (!rows) continue;
+
+                tmp.resize(rows * m);
+                data(d).read(data.queue_list()[d], 0, tmp.size(), tmp.data(), true);
+
+                for(size_t k = 0; k < m; ++k)
+                    for(size_t i = 0; i < rows; ++i)
+                        host[k * n + rpart[d] + i] = tmp[local_index(d, i, k)];
+            }
+        }
+
+        /// Copies host data to the multivector.
+        /**
+         * Host data is stored by components: k-th component starts at
+         * host + k * n, regardless of the layout.
+         */
+        void write(const T *host) {
+            std::vector<T> tmp;
+            for(unsigned d = 0; d < data.nparts(); d++) {
+                size_t rows = rpart[d + 1] - rpart[d];
+                if (!rows) continue;
+
+                tmp.resize(rows * m);
+                for(size_t k = 0; k < m; ++k)
+                    for(size_t i = 0; i < rows; ++i)
+                        tmp[local_index(d, i, k)] = host[k * n + rpart[d] + i];
+
+                data(d).write(data.queue_list()[d], 0, tmp.size(), tmp.data(), true);
+            }
+        }
+    private:
+        // Flat storage. It is not exposed, since its size and element order
+        // depend on the layout.
+        vector<T> data;
+
+        size_t n, m;
+        vex::layout lay;
+        std::vector<size_t> rpart;
+
+        void allocate(const std::vector<backend::command_queue> &queue) {
+            std::vector<size_t> part = rpart;
+
+            for(auto p = part.begin(); p != part.end(); ++p)
+                *p *= m;
+
+            data = vector<T>(part, queue);
+        }
+
+        template <class OP, class Expr>
+        void assign(const Expr &expr) {
+            detail::extract_terminals()(boost::proto::as_child(expr),
+                    detail::check_multivector_shape<T>(*this));
+
+            detail::assign_expression<OP>(data, expr, data.queue_list(), data.partition());
+        }
+
+        unsigned row_owner(size_t i) const {
+            return static_cast<unsigned>(
+                    std::upper_bound(rpart.begin(), rpart.end(), i) - rpart.begin() - 1);
+        }
+
+        void copy_component(size_t k, const vector<T> &v, bool to_vector) const {
+            precondition(k < m, "Component number out of bounds");
+
+            using namespace detail;
+
+            static kernel_cache cache;
+
+            for(unsigned d = 0; d < data.nparts(); d++) {
+                size_t rows = rpart[d + 1] - rpart[d];
+                if (!rows) continue;
+
+                const backend::command_queue &q = data.queue_list()[d];
+
+                auto key    = backend::cache_key(q);
+                auto kernel = cache.find(key);
+
+                backend::select_context(q);
+
+                if (kernel == cache.end()) {
+                    backend::source_generator src(q);
+
+                    src.kernel("copy_component")
+                        .open("(")
+                            .template parameter< size_t        >("n")
+                            .template parameter< size_t        >("m")
+                            .template parameter< size_t        >("k")
+                            .template parameter< int           >("get")
+                            .template parameter< int           >("aos")
+                            .template parameter< global_ptr<T> >("mv")
+                            .template parameter< global_ptr<T> >("v")
+                        .close(")").open("{");
+
+                    src.grid_stride_loop("i").open("{");
+                    src.new_line() << "size_t j = aos ? i * m + k : k * n + i;";
+                    src.new_line() << "if (get) v[i] = mv[j]; else mv[j] = v[i];";
+                    src.close("}");
+
+                    src.close("}");
+
+                    backend::kernel krn(q, src.str(), "copy_component");
+                    kernel = cache.insert(std::make_pair(key, krn)).first;
+                }
+
+                kernel->second.push_arg(rows);
+                kernel->second.push_arg(m);
+                kernel->second.push_arg(k);
+                kernel->second.push_arg(static_cast<int>(to_vector));
+                kernel->second.push_arg(static_cast<int>(lay == layout::aos));
+                kernel->second.push_arg(data(d));
+                kernel->second.push_arg(v(d));
+
+                kernel->second(q);
+            }
+        }
+
+        friend struct traits::expression_properties< dynamic_multivector<T> >;
+};
+
+/// \cond INTERNAL
+namespace traits {
+
+template <typename T>
+struct kernel_param_declaration< dynamic_multivector<T> > {
+    static void get(backend::source_generator &src,
+            const dynamic_multivector<T>&,
+            const backend::command_queue&, const std::string &prm_name,
+            detail::kernel_generator_state_ptr)
+    {
+        src.parameter< global_ptr<T> >(prm_name);
+    }
+};
+
+template <typename T>
+struct partial_vector_expr< dynamic_multivector<T> > {
+    static void get(backend::source_generator &src,
+            const dynamic_multivector<T>&,
+            const backend::command_queue&, const std::string &prm_name,
+            detail::kernel_generator_state_ptr)
+    {
+        src << prm_name << "[idx]";
+    }
+};
+
+template <typename T>
+struct kernel_arg_setter< dynamic_multivector<T> > {
+    static void set(const dynamic_multivector<T> &term,
+            backend::kernel &kernel, unsigned device, size_t/*index_offset*/,
+            detail::kernel_generator_state_ptr)
+    {
+        kernel.push_arg(term(device));
+    }
+};
+
+template <typename T>
+struct expression_properties< dynamic_multivector<T> > {
+    static void get(const dynamic_multivector<T> &term,
+            std::vector<backend::command_queue> &queue_list,
+            std::vector<size_t> &partition,
+            size_t &size
+            )
+    {
+        queue_list = term.queue_list();
+        partition  = term.data.partition();
+        size       = term.size() * term.components();
+    }
+};
+
+} // namespace traits
+/// \endcond
+
+/// Copy multivector to host vector (stored by components).
+template <typename T>
+void copy(const dynamic_multivector<T> &dv, std::vector<T> &hv) {
+    precondition(hv.size() == dv.size() * dv.components(), "Wrong host vector size");
+    dv.read(hv.data());
+}
+
+/// Copy host vector (stored by components) to multivector.
+template <typename T>
+void copy(const std::vector<T> &hv, dynamic_multivector<T> &dv) {
+    precondition(hv.size() == dv.size() * dv.components(), "Wrong host vector size");
+    dv.write(hv.data());
+}
+
+} // namespace vex
+
+#endif
@@ -44,8 +44,8 @@ namespace viennacl {
         }
 
         /// Matrix-vector product.
-        template <typename T, typename C, typename I>
-        auto prod(const vex::SpMat<T, C, I> &A, const vex::vector<T> &x)
+        template <typename T, typename C, typename I, typename S>
+        auto prod(const vex::SpMat<T, C, I, S> &A, const vex::vector<T> &x)
             -> decltype(A * x)
         {
             return A * x;
@@ -32,12 +32,51 @@ THE SOFTWARE.
  */
 
 #include <vector>
+#include <algorithm>
 
 #include <vexcl/vector.hpp>
 #include <vexcl/vector_view.hpp>
 
 namespace vex {
 
+/// \cond INTERNAL
+namespace detail {
+
+// Clears the flag if the expression has terminals other than scalars, i.e.
+// its value may depend on the element position.
+struct check_scalar_terminals {
+    bool &ok;
+
+    check_scalar_terminals(bool &ok) : ok(ok) {}
+
+    template <class Term>
+    typename std::enable_if<traits::terminal_is_value<Term>::value, void>::type
+    operator()(const Term&) const {
+        ok = false;
+    }
+
+    template <class Term>
+    typename std::enable_if<!traits::terminal_is_value<Term>::value, void>::type
+    operator()(const Term&) const {
+        typedef typename std::decay<
+            typename boost::proto::result_of::value<Term>::type
+            >::type value_type;
+
+        if (!is_cl_native<value_type>::value) ok = false;
+    }
+};
+
+// Part of a multi_array slice residing on a single device.
+template <typename T, size_t NR>
+struct multi_array_slab {
+    unsigned         device;
+    const vector<T> *data;
+    gslice<NR>       slice;
+};
+
+} // namespace detail
+/// \endcond
+
 template <typename T, size_t NR, class Dimensions>
 class multi_array_view
 {
@@ -45,16 +84,129 @@ class multi_array_view
         typedef boost::mpl::size_t<boost::fusion::result_of::size<Dimensions>::type::value> ndim;
         typedef vector_view< vector<T>, gslice<NR> > base_type;
 
-        multi_array_view(vector<T> &data, const gslice<NR> &slice)
-            : data(data), slice(slice)
+        multi_array_view(
+                const std::vector<backend::command_queue> &queue,
+                const gslice<NR> &slice,
+                const std::vector< detail::multi_array_slab<T, NR> > &slabs
+                )
+            : queue(queue), slice(slice), slabs(slabs)
         {}
 
+        /// Returns the slice as a vector expression.
+        /**
+         * Only available when the slice resides on a single device.
+         * Use get() and set() for slices spanning several devices.
+         */
         const vector_view< const vector<T>&, gslice<NR> > vec() const {
-            return slice(data);
+            precondition(slabs.size() == 1,
+                    "The slice spans several devices");
+            return slabs[0].slice(*slabs[0].data);
         }
 
+        /// Returns the slice as a vector expression.
         vector_view< const vector<T>&, gslice<NR> > vec() {
-            return slice(data);
+            precondition(slabs.size() == 1,
+                    "The slice spans several devices");
+            return slabs[0].slice(*slabs[0].data);
+        }
+
+        /// Number of devices the slice resides on.
+        size_t nslabs() const {
+            return slabs.size();
+        }
+
+        /// Part of the slice residing on k-th of its devices.
+        vector_view< const vector<T>&, gslice<NR> > vec(unsigned k) const {
+            return slabs[k].slice(*slabs[k].data);
+        }
+
+        /// Partitioning of the slice elements across devices.
+        std::vector<size_t> partition() const {
+            std::vector<size_t> part(queue.size() + 1, 0);
+
+            for(auto s = slabs.begin(); s != slabs.end(); ++s)
+                part[s->device + 1] = s->slice.size();
+
+            std::partial_sum(part.begin(), part.end(), part.begin());
+            return part;
+        }
+
+        /// Assigns expression to the slice.
+        /**
+         * When the slice spans several devices, the expression is assigned
+         * to each part of the slice separately, so it should not depend on
+         * the element position: only scalar terminals are allowed then
+         * (e.g. constants). Use set() to copy a vector into such a slice.
+         */
+        template <class Expr>
+        typename std::enable_if<
+            boost::proto::matches<
+                typename boost::proto::result_of::as_expr<Expr>::type,
+                vector_expr_grammar
+            >::value,
+            const multi_array_view&
+        >::type
+        operator=(const Expr &expr) {
+            if (slabs.size() > 1) {
+                bool position_independent = true;
+                detail::extract_terminals()(boost::proto::as_child(expr),
+                        detail::check_scalar_terminals(position_independent));
+
+                precondition(position_independent,
+                        "Only scalar expressions may be assigned to a slice spanning several devices");
+            }
+
+            for(auto s = slabs.begin(); s != slabs.end(); ++s)
+                s->slice(*s->data) = expr;
+            return *this;
+        }
+
+        /// Copies the slice into a vector.
+        /**
+         * Each part of the slice is copied on its own device. The vector is
+         * reallocated unless its partitioning matches partition().
+         */
+        void get(vector<T> &y) const {
+            std::vector<size_t> part = partition();
+
+            if (y.nparts() != queue.size() || y.partition() != part) {
+                vector<T> tmp(part, queue);
+                y.swap(tmp);
+            }
+
+            for(auto s = slabs.begin(); s != slabs.end(); ++s) {
+                vector<T> yd(queue[s->device], y(s->device));
+                yd = s->slice(*s->data);
+            }
+        }
+
+        /// Copies a vector into the slice.
+        /**
+         * When partitioning of the vector does not match partition(), the
+         * data is redistributed through host memory.
+         */
+        void set(const vector<T> &y) {
+            std::vector<size_t> part = partition();
+
+            precondition(y.size() == part.back(), "Wrong vector size");
+
+            if (y.nparts() == queue.size() && y.partition() == part) {
+                for(auto s = slabs.begin(); s != slabs.end(); ++s) {
+                    vector<T> yd(queue[s->device], y(s->device));
+                    s->slice(*s->data) = yd;
+                }
+            } else {
+                std::vector<T> host(y.size());
+                vex::copy(y, host);
+
+                for(auto s = slabs.begin(); s != slabs.end(); ++s) {
+                    vector<T> yd(
+                            std::vector<backend::command_queue>(1, queue[s->device]),
+                            part[s->device + 1] - part[s->device],
+                            &host[part[s->device]]);
+                    s->slice(*s->data) = yd;
+                }
+            }
         }
 
         template <size_t d>
@@ -64,10 +216,18 @@ class multi_array_view
             return slice.length[boost::fusion::result_of::value_at_c<Dimensions, d>::type::value];
         }
     private:
-        vector<T>  &data;
+        std::vector<backend::command_queue> queue;
         gslice<NR> slice;
+        std::vector< detail::multi_array_slab<T, NR> > slabs;
 };
 
+/// An analog of boost::multi_array.
+/**
+ * With several devices in the queue list, the array is split into slabs
+ * along its slowest (first) dimension, one slab per device. Elementwise
+ * operations on vec() work across all devices. Slices and reductions are
+ * computed on each slab separately.
+ */
 template <typename T, size_t NR>
 class multi_array
 {
@@ -79,12 +239,22 @@ class multi_array
                 const std::vector<backend::command_queue> &queue,
                 const extent_gen<NR> &ext
                 )
-            : data(queue, ext.size()), slice(ext)
+            : slice(ext), rows(vex::partition(ext.dim[0], queue))
         {
-            precondition(
-                    queue.size() == 1,
-                    "Multi-arrays are restricted to single-device contexts"
-                    );
+            std::vector<size_t> part = rows;
+
+            for(auto p = part.begin(); p != part.end(); ++p)
+                *p *= slice.stride[0];
+
+            data = vector<T>(part, queue);
+
+            init_slabs();
+        }
+
+        multi_array(const multi_array &m)
+            : data(m.data), slice(m.slice), rows(m.rows)
+        {
+            init_slabs();
         }
 
         const vector<T>& vec() const {
@@ -97,12 +267,12 @@ class multi_array
 
         template <class Dim>
         const multi_array_view<T, NR, Dim> operator()(const index_gen<NR, Dim> &idx) const {
-            return multi_array_view<T, NR, Dim>(const_cast<vector<T>&>(data), slice(idx));
+            return view(idx);
         }
 
         template <class Dim>
         multi_array_view<T, NR, Dim> operator()(const index_gen<NR, Dim> &idx) {
-            return multi_array_view<T, NR, Dim>(data, slice(idx));
+            return view(idx);
         }
 
         template<size_t d>
@@ -112,33 +282,182 @@ class multi_array
             return slice.dim[d];
         }
 
+        /// Partitioning of the slowest dimension across devices.
+        const std::vector<size_t>& slab_partition() const {
+            return rows;
+        }
+
+        /// \cond INTERNAL
+        template <class RDC, size_t NRD>
+        void reduce_slabs(const std::array<size_t, NRD> &dims, vector<T> &y) const {
+            typedef reduced_vector_view<const vector<T>&, NR, NRD, RDC> reduced_view;
+
+            const std::vector<backend::command_queue> &queue = data.queue_list();
+
+            // Size of the result per row of the slowest dimension.
+            size_t rsize = 1;
+            for(size_t k = 1; k < NR; ++k)
+                if (std::find(dims.begin(), dims.end(), k) == dims.end())
+                    rsize *= slice.dim[k];
+
+            if (std::find(dims.begin(), dims.end(), static_cast<size_t>(0)) == dims.end()) {
+                // Each slab holds its own part of the result.
+                std::vector<size_t> part(queue.size() + 1, 0);
+                for(unsigned d = 0; d < queue.size(); ++d)
+                    part[d + 1] = part[d] + (rows[d + 1] - rows[d]) * rsize;
+
+                if (y.nparts() != queue.size() || y.partition() != part) {
+                    vector<T> tmp(part, queue);
+                    y.swap(tmp);
+                }
+
+                for(unsigned d = 0; d < queue.size(); ++d) {
+                    if (rows[d + 1] == rows[d]) continue;
+
+                    vector<T> yd(queue[d], y(d));
+                    yd = reduced_view(slab[d], slab_slice[d][_], dims);
+                }
+            } else {
+                // Each slab gets partial result, which are combined on host.
+                std::vector< std::vector<T> > partial;
+
+                for(unsigned d = 0; d < queue.size(); ++d) {
+                    if (rows[d + 1] == rows[d]) continue;
+
+                    vector<T> yd(std::vector<backend::command_queue>(1, queue[d]), rsize);
+                    yd = reduced_view(slab[d], slab_slice[d][_], dims);
+
+                    partial.push_back(std::vector<T>(rsize));
+                    vex::copy(yd, partial.back());
+                }
+
+                std::vector<T> res(rsize), val(partial.size());
+                for(size_t i = 0; i < rsize; ++i) {
+                    for(size_t j = 0; j < partial.size(); ++j)
+                        val[j] = partial[j][i];
+                    res[i] = RDC::reduce(val.begin(), val.end());
+                }
+
+                if (y.size() != rsize) y.resize(queue, rsize);
+                vex::copy(res, y);
+            }
+        }
+        /// \endcond
     private:
         vector<T>  data;
     public:
         slicer<NR> slice;
+    private:
+        std::vector<size_t>     rows;
+        std::vector< vector<T> > slab;
+        std::vector< slicer<NR> > slab_slice;
+
+        void init_slabs() {
+            const std::vector<backend::command_queue> &queue = data.queue_list();
+
+            for(unsigned d = 0; d < queue.size(); ++d) {
+                std::array<size_t, NR> dim = slice.dim;
+                dim[0] = rows[d + 1] - rows[d];
+
+                slab_slice.push_back(slicer<NR>(dim));
+
+                if (dim[0])
+                    slab.push_back(vector<T>(queue[d], data(d), dim[0] * slice.stride[0]));
+                else
+                    slab.push_back(vector<T>());
+            }
+        }
+
+        template <class Dim>
+        multi_array_view<T, NR, Dim> view(const index_gen<NR, Dim> &idx) const {
+            const std::vector<backend::command_queue> &queue = data.queue_list();
+            std::vector< detail::multi_array_slab<T, NR> > parts;
+
+            range r = idx.ranges[0].empty() ? range(0, slice.dim[0]) : idx.ranges[0];
+
+            for(unsigned d = 0; d < queue.size(); ++d) {
+                size_t lo = rows[d], hi = rows[d + 1];
+
+                // First index of the range inside the slab.
+                size_t first = r.start >= lo ? r.start :
+                    r.start + (lo - r.start + r.stride - 1) / r.stride * r.stride;
+                size_t stop = std::min(r.stop, hi);
+
+                if (first >= stop) continue;
+
+                index_gen<NR, Dim> local = idx;
+                local.ranges[0] = range(first - lo, r.stride, stop - lo);
+
+                detail::multi_array_slab<T, NR> s = {d, &slab[d], slab_slice[d](local)};
+                parts.push_back(s);
+            }
+
+            return multi_array_view<T, NR, Dim>(queue, slice(idx), parts);
+        }
 };
 
 /// Reduce vex::multi_array along the specified dimensions.
+/**
+ * Only available for single-device arrays. Use the overload with an output
+ * vector for multi-device arrays.
+ */
 template <class RDC, typename T, size_t NDIM, size_t NR>
 reduced_vector_view<vector<T>, NDIM, NR, RDC> reduce(
         const multi_array<T, NDIM> &m,
         const std::array<size_t, NR> &reduce_dims
         )
 {
+    precondition(m.vec().nparts() == 1,
+            "Use reduce(m, dims, y) with multi-device arrays");
     return reduced_vector_view<vector<T>, NDIM, NR, RDC>(m.vec(), m.slice[_], reduce_dims);
 }
 
 /// Reduce vex::multi_array along the specified dimension.
+/**
+ * Only available for single-device arrays. Use the overload with an output
+ * vector for multi-device arrays.
+ */
 template <class RDC, typename T, size_t NDIM>
 reduced_vector_view<vector<T>, NDIM, 1, RDC> reduce(
         const multi_array<T, NDIM> &m,
         size_t reduce_dim
         )
 {
+    precondition(m.vec().nparts() == 1,
+            "Use reduce(m, dim, y) with multi-device arrays");
     std::array<size_t, 1> dim = {{reduce_dim}};
     return reduced_vector_view<vector<T>, NDIM, 1, RDC>(m.vec(), m.slice[_], dim);
 }
 
+/// Reduce vex::multi_array along the specified dimensions.
+/**
+ * Each slab of the array is reduced on its own device. When the slowest
+ * dimension is reduced, partial results of the slabs are combined on the host
+ * and written to y. Otherwise the result stays distributed (y is reallocated
+ * so that each device holds the part computed from its slab).
+ */
+template <class RDC, typename T, size_t NDIM, size_t NR>
+void reduce(
+        const multi_array<T, NDIM> &m,
+        const std::array<size_t, NR> &reduce_dims,
+        vector<T> &y
+        )
+{
+    m.template reduce_slabs<RDC>(reduce_dims, y);
+}
+
+/// Reduce vex::multi_array along the specified dimension.
+template <class RDC, typename T, size_t NDIM>
+void reduce(
+        const multi_array<T, NDIM> &m,
+        size_t reduce_dim,
+        vector<T> &y
+        )
+{
+    std::array<size_t, 1> dim = {{reduce_dim}};
+    m.template reduce_slabs<RDC>(dim, y);
+}
+
 } // namespace vex
 
 
@@ -0,0 +1,302 @@
+#ifndef VEXCL_SOLVER_HPP
+#define VEXCL_SOLVER_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2026 Denis Demidov <ddemidov@ksu.ru>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/solver.hpp
+ * \author Denis Demidov <ddemidov@ksu.ru>
+ * \brief  Iterative Krylov solvers.
+ */
+
+#include <vector>
+#include <map>
+#include <string>
+#include <sstream>
+#include <tuple>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include <memory>
+
+#include <vexcl/vector.hpp>
+
+namespace vex {
+
+/// Iterative solvers for systems of linear equations.
+/**
+ * The system matrix may be any object usable in additive expressions, i.e.
+ * providing apply(x, y, alpha, append) method (vex::SpMat, vex::stencil,
+ * vex::stencil_nd, user-defined stencil operators). Preconditioners should
+ * provide apply(rhs, x) method that approximately solves the system.
+ */
+namespace solver {
+
+/// Solver parameters.
+struct params {
+    size_t maxiter; ///< Maximum number of iterations.
+    double tol;     ///< Target relative residual norm.
+
+    params(size_t maxiter = 100, double tol = 1e-8)
+        : maxiter(maxiter), tol(tol)
+    {}
+};
+
+/// Identity preconditioner.
+/**
+ * Solvers detect it and skip the preconditioning step altogether.
+ */
+struct identity {
+    template <typename T>
+    void apply(const vector<T> &rhs, vector<T> &x) const {
+        x = rhs;
+    }
+};
+
+/// \cond INTERNAL
+namespace detail {
+
+// Applies the preconditioner to rhs. Returns reference to the result, which
+// is rhs itself for the identity preconditioner.
+template <class Precond, typename T>
+const vector<T>& apply_precond(const Precond &P, const vector<T> &rhs, vector<T> &x) {
+    P.apply(rhs, x);
+    return x;
+}
+
+template <typename T>
+const vector<T>& apply_precond(const identity&, const vector<T> &rhs, vector<T>&) {
+    return rhs;
+}
+
+// Vector update fused with reductions of the updated values.
+//
+// The kernel loads the i-th elements of the output and input vectors into
+// registers named v0, v1, ... (outputs first), executes the body, writes
+// the outputs back, and accumulates the dot expressions. Scalar arguments
+// are available as a0, a1, ... Per-workgroup partial sums are read to the
+// host without blocking, so that other work may be submitted before
+// result() is called.
+template <typename T>
+class fused_update {
+    public:
+        fused_update(const std::vector<backend::command_queue> &queue,
+                unsigned nout, unsigned nin, unsigned nscal,
+                const std::string &body,
+                const std::vector<std::string> &dots = std::vector<std::string>()
+                )
+            : queue(queue), nout(nout), nin(nin), nscal(nscal),
+              ndots(static_cast<unsigned>(dots.size())), res(ndots),
+              active(queue.size(), false), ready(queue.size())
+        {
+            static std::map<std::string, vex::detail::kernel_cache> cache;
+
+            idx.push_back(0);
+
+            for(unsigned d = 0; d < queue.size(); d++) {
+                backend::source_generator src(queue[d]);
+
+                src.kernel("fused_update").open("(")
+                    .template parameter<size_t>("n");
+
+                for(unsigned i = 0; i < nout; ++i)
+                    src.template parameter< global_ptr<T> >(name("p", i));
+                for(unsigned i = nout; i < nout + nin; ++i)
+                    src.template parameter< global_ptr<const T> >(name("p", i));
+                for(unsigned i = 0; i < nscal; ++i)
+                    src.template parameter<T>(name("a", i));
+
+                if (ndots) {
+                    src.template parameter< global_ptr<T> >("partial");
+                    src.template smem_parameter<T>();
+                }
+
+                src.close(")").open("{");
+
+                for(unsigned k = 0; k < ndots; ++k)
+                    src.new_line() << type_name<T>() << " s" << k << " = 0;";
+
+                src.grid_stride_loop().open("{");
+                for(unsigned i = 0; i < nout + nin; ++i)
+                    src.new_line() << type_name<T>() << " v" << i << " = p" << i << "[idx];";
+                src.new_line() << body;
+                for(unsigned i = 0; i < nout; ++i)
+                    src.new_line() << "p" << i << "[idx] = v" << i << ";";
+                for(unsigned k = 0; k < ndots; ++k)
+                    src.new_line() << "s" << k << " += " << dots[k] << ";";
+                src.close("}");
+
+                if (ndots) {
+                    src.smem_declaration<T>();
+                    src.new_line() << type_name< shared_ptr<T> >() << " sdata = smem;";
+                    src.new_line() << "size_t tid = " << src.local_id(0) << ";";
+                    src.new_line() << "size_t block_size = " << src.local_size(0) << ";";
+                    src.new_line() << "size_t ngroups = " << src.global_size(0) << " / block_size;";
+                    src.new_line() << "size_t gid = " << src.group_id(0) << ";";
+
+                    for(unsigned k = 0; k < ndots; ++k) {
+                        src.new_line() << "sdata[tid] = s" << k << ";";
+                        src.new_line().barrier();
+                        src.new_line() << "for(size_t w = block_size / 2; w > 0; w /= 2)";
+                        src.open("{");
+                        src.new_line() << "if (tid < w) sdata[tid] += sdata[tid + w];";
+                        src.new_line().barrier();
+                        src.close("}");
+                        src.new_line() << "if (tid == 0) partial[" << k << " * ngroups + gid] = sdata[0];";
+                        src.new_line().barrier();
+                    }
+                }
+
+                src.close("}");
+
+                vex::detail::kernel_cache &c = cache[src.str()];
+
+                auto key    = backend::cache_key(queue[d]);
+                auto kernel = c.find(key);
+
+                backend::select_context(queue[d]);
+
+                if (kernel == c.end()) {
+                    if (ndots) {
+                        backend::kernel k(queue[d], src.str(), "fused_update", sizeof(T));
+                        kernel = c.insert(std::make_pair(key, k)).first;
+                    } else {
+                        backend::kernel k(queue[d], src.str(), "fused_update");
+                        kernel = c.insert(std::make_pair(key, k)).first;
+                    }
+                }
+
+                krn.push_back(kernel->second);
+
+                size_t ng = ndots ? backend::kernel::num_workgroups(queue[d]) : 0;
+                idx.push_back(idx.back() + ndots * ng);
+
+                if (ndots)
+                    dbuf.push_back(backend::device_vector<T>(queue[d], ndots * ng));
+                else
+                    dbuf.push_back(backend::device_vector<T>());
+            }
+
+            hbuf.resize(idx.back());
+        }
+
+        // Launches the kernel.
+        void operator()(
+                const std::vector< std::reference_wrapper< vector<T> > > &out,
+                const std::vector< std::reference_wrapper< const vector<T> > > &in,
+                const std::vector<T> &scal = std::vector<T>()
+                )
+        {
+            precondition(
+                    out.size() == nout && in.size() == nin && scal.size() == nscal
+                    && nout + nin > 0,
+                    "Wrong number of arguments in fused update"
+                    );
+
+            const vector<T> &v = nout ? out[0].get() : in[0].get();
+
+            for(unsigned d = 0; d < queue.size(); d++) {
+                active[d] = v.part_size(d) > 0;
+                if (!active[d]) continue;
+
+                backend::select_context(queue[d]);
+
+                krn[d].push_arg(v.part_size(d));
+
+                for(unsigned i = 0; i < nout; ++i) krn[d].push_arg(out[i].get()(d));
+                for(unsigned i = 0; i < nin;  ++i) krn[d].push_arg(in[i].get()(d));
+                for(unsigned i = 0; i < nscal; ++i) krn[d].push_arg(scal[i]);
+
+                if (ndots) {
+                    krn[d].push_arg(dbuf[d]);
+                    krn[d].set_smem([](size_t wgs){ return wgs * sizeof(T); });
+                }
+
+                krn[d](queue[d]);
+            }
+
+            if (!ndots) return;
+
+            std::fill(hbuf.begin(), hbuf.end(), T());
+
+            for(unsigned d = 0; d < queue.size(); d++) {
+                if (!active[d]) continue;
+
+                dbuf[d].read(queue[d], 0, idx[d + 1] - idx[d], &hbuf[idx[d]]);
+                ready[d] = backend::enqueue_marker(queue[d]);
+            }
+        }
+
+        // Waits for the partial sums and returns the reduced dot products.
+        const std::vector<T>& result() {
+            if (!ndots) return res;
+
+            for(unsigned d = 0; d < queue.size(); d++)
+                if (active[d]) ready[d].wait();
+
+            std::fill(res.begin(), res.end(), T());
+
+            for(unsigned d = 0; d < queue.size(); d++) {
+                size_t ng = (idx[d + 1] - idx[d]) / ndots;
+                for(unsigned k = 0; k < ndots; ++k)
+                    for(size_t g = 0; g < ng; ++g)
+                        res[k] += hbuf[idx[d] + k * ng + g];
+            }
+
+            return res;
+        }
+    private:
+        std::vector<backend::command_queue> queue;
+
+        unsigned nout, nin, nscal, ndots;
+
+        std::vector<backend::kernel> krn;
+        std::vector< backend::device_vector<T> > dbuf;
+        std::vector<size_t> idx;
+        std::vector<T> hbuf;
+        std::vector<T> res;
+
+        std::vector<bool> active;
+        std::vector<backend::event> ready;
+
+        static std::string name(const char *prefix, unsigned i) {
+            std::ostringstream s;
+            s << prefix << i;
+            return s.str();
+        }
+};
+
+} // namespace detail
+/// \endcond
+
+} // namespace solver
+} // namespace vex
+
+#include <vexcl/solver/cg.hpp>
+#include <vexcl/solver/pipelined_cg.hpp>
+#include <vexcl/solver/bicgstab.hpp>
+#include <vexcl/solver/gmres.hpp>
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef VEXCL_SOLVER_BICGSTAB_HPP
+#define VEXCL_SOLVER_BICGSTAB_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2026 Denis Demidov <ddemidov@ksu.ru>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/solver/bicgstab.hpp
+ * \author Denis Demidov <ddemidov@ksu.ru>
+ * \brief  BiConjugate Gradient Stabilized method.
+ */
+
+
+namespace vex {
+namespace solver {
+
+/// BiConjugate Gradient Stabilized method.
+/**
+ * Solves general nonsymmetric systems. Right preconditioning is used, so
+ * the residual norm is not affected by the preconditioner. Vector updates
+ * are fused with the dot products that follow them, and the norm of the
+ * intermediate residual is read while the second matrix-vector product of
+ * the iteration is being computed.
+ */
+template <typename T>
+class bicgstab {
+    public:
+        typedef T value_type;
+
+        /// Constructor.
+        /**
+         * \param queue vector of queues.
+         * \param n     size of the system.
+         * \param prm   solver parameters.
+         */
+        bicgstab(const std::vector<backend::command_queue> &queue, size_t n,
+                const params &prm = params())
+            : prm(prm),
+              r(queue, n), rh(queue, n), p(queue, n), v(queue, n),
+              s(queue, n), t(queue, n), ph(queue, n), sh(queue, n),
+              norm (queue, 0, 1, 0, "", {"v0 * v0"}),
+              start(queue, 2, 1, 0, "v0 = v2; v1 = v2;", {"v2 * v2"}),
+              rv   (queue, 0, 2, 0, "", {"v0 * v1"}),
+              // s = r - alpha * v
+              upd_s(queue, 1, 2, 1, "v0 = v1 - a0 * v2;", {"v0 * v0"}),
+              ts   (queue, 0, 2, 0, "", {"v0 * v1", "v0 * v0"}),
+              // x += alpha * ph + omega * sh; r = s - omega * t
+              upd_x(queue, 2, 5, 2, "v0 += a0 * v4 + a1 * v5; v1 = v2 - a1 * v3;",
+                      {"v1 * v1", "v6 * v1"})
+        {}
+
+        /// Solves the system Ax = rhs.
+        /**
+         * x holds the initial approximation on input.
+         * \returns number of iterations made and the relative residual norm.
+         */
+        template <class Matrix, class Precond>
+        std::tuple<size_t, T> operator()(const Matrix &A, const Precond &P,
+                const vector<T> &rhs, vector<T> &x) const
+        {
+            norm({}, {rhs});
+            T norm_b = std::sqrt(norm.result()[0]);
+
+            if (norm_b == 0) {
+                x = 0;
+                return std::make_tuple(0, 0);
+            }
+
+            r = rhs;
+            A.apply(x, r, -1, true);
+
+            start({rh, p}, {r});
+            T rho = start.result()[0];
+            T res = std::sqrt(rho) / norm_b;
+
+            size_t iter = 0;
+            while(res > prm.tol && iter < prm.maxiter) {
+                const vector<T> &php = detail::apply_precond(P, p, ph);
+                A.apply(php, v, 1, false);
+
+                rv({}, {rh, v});
+                T r_v = rv.result()[0];
+                if (r_v == 0) break;
+
+                T alpha = rho / r_v;
+
+                upd_s({s}, {r, v}, {alpha});
+
+                const vector<T> &shs = detail::apply_precond(P, s, sh);
+                A.apply(shs, t, 1, false);
+
+                ++iter;
+
+                T res_s = std::sqrt(upd_s.result()[0]) / norm_b;
+                if (res_s <= prm.tol) {
+                    x += alpha * php;
+                    res = res_s;
+                    break;
+                }
+
+                ts({}, {t, s});
+                T t_s = ts.result()[0];
+                T t_t = ts.result()[1];
+                if (t_t == 0) break;
+
+                T omega = t_s / t_t;
+
+                upd_x({x, r}, {s, t, php, shs, rh}, {alpha, omega});
+                res = std::sqrt(upd_x.result()[0]) / norm_b;
+
+                T rho_new = upd_x.result()[1];
+
+                if (res <= prm.tol || iter == prm.maxiter) break;
+                if (rho == 0 || omega == 0) break;
+
+                T beta = (rho_new / rho) * (alpha / omega);
+                rho = rho_new;
+
+                p = r + beta * (p - omega * v);
+            }
+
+            return std::make_tuple(iter, res);
+        }
+
+        /// Solves the system Ax = rhs without preconditioning.
+        template <class Matrix>
+        std::tuple<size_t, T> operator()(const Matrix &A,
+                const vector<T> &rhs, vector<T> &x) const
+        {
+            return (*this)(A, identity(), rhs, x);
+        }
+    private:
+        params prm;
+
+        mutable vector<T> r, rh, p, v, s, t, ph, sh;
+
+        mutable detail::fused_update<T> norm, start, rv, upd_s, ts, upd_x;
+};
+
+} // namespace solver
+} // namespace vex
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef VEXCL_SOLVER_CG_HPP
+#define VEXCL_SOLVER_CG_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2026 Denis Demidov <ddemidov@ksu.ru>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/solver/cg.hpp
+ * \author Denis Demidov <ddemidov@ksu.ru>
+ * \brief  Conjugate Gradient method.
+ */
+
+
+namespace vex {
+namespace solver {
+
+/// Conjugate Gradient method.
+/**
+ * Solves systems with symmetric positive definite matrices. Vector updates
+ * are fused with the dot products that follow them, so that an iteration
+ * takes a matrix-vector product, a preconditioner application, and four
+ * kernels (three with the identity preconditioner).
+ */
+template <typename T>
+class cg {
+    public:
+        typedef T value_type;
+
+        /// Constructor.
+        /**
+         * \param queue vector of queues.
+         * \param n     size of the system.
+         * \param prm   solver parameters.
+         */
+        cg(const std::vector<backend::command_queue> &queue, size_t n,
+                const params &prm = params())
+            : prm(prm),
+              r(queue, n), p(queue, n), q(queue, n), z(queue, n),
+              norm  (queue, 0, 1, 0, "", {"v0 * v0"}),
+              start (queue, 1, 2, 0, "v0 = v2;", {"v1 * v2", "v1 * v1"}),
+              pq    (queue, 0, 2, 0, "", {"v0 * v1"}),
+              update(queue, 2, 2, 1, "v0 += a0 * v2; v1 -= a0 * v3;", {"v1 * v1"}),
+              rz    (queue, 0, 2, 0, "", {"v0 * v1"})
+        {}
+
+        /// Solves the system Ax = rhs.
+        /**
+         * x holds the initial approximation on input.
+         * \returns number of iterations made and the relative residual norm.
+         */
+        template <class Matrix, class Precond>
+        std::tuple<size_t, T> operator()(const Matrix &A, const Precond &P,
+                const vector<T> &rhs, vector<T> &x) const
+        {
+            norm({}, {rhs});
+            T norm_b = std::sqrt(norm.result()[0]);
+
+            if (norm_b == 0) {
+                x = 0;
+                return std::make_tuple(0, 0);
+            }
+
+            r = rhs;
+            A.apply(x, r, -1, true);
+
+            const vector<T> &z0 = detail::apply_precond(P, r, z);
+
+            start({p}, {r, z0});
+            T rho = start.result()[0];
+            T res = std::sqrt(start.result()[1]) / norm_b;
+
+            size_t iter = 0;
+            while(res > prm.tol && iter < prm.maxiter) {
+                A.apply(p, q, 1, false);
+
+                pq({}, {p, q});
+                T alpha = rho / pq.result()[0];
+
+                update({x, r}, {p, q}, {alpha});
+                T rr = update.result()[0];
+
+                res = std::sqrt(rr) / norm_b;
+                if (++iter == prm.maxiter || res <= prm.tol) break;
+
+                const vector<T> &zr = detail::apply_precond(P, r, z);
+
+                T rho_new = rr;
+                if (std::addressof(zr) != std::addressof(r)) {
+                    rz({}, {r, zr});
+                    rho_new = rz.result()[0];
+                }
+
+                p = zr + (rho_new / rho) * p;
+                rho = rho_new;
+            }
+
+            return std::make_tuple(iter, res);
+        }
+
+        /// Solves the system Ax = rhs without preconditioning.
+        template <class Matrix>
+        std::tuple<size_t, T> operator()(const Matrix &A,
+                const vector<T> &rhs, vector<T> &x) const
+        {
+            return (*this)(A, identity(), rhs, x);
+        }
+    private:
+        params prm;
+
+        mutable vector<T> r, p, q, z;
+
+        mutable detail::fused_update<T> norm, start, pq, update, rz;
+};
+
+} // namespace solver
+} // namespace vex
+
+#endif
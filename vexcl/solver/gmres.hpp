@@ -0,0 +1,272 @@
+#ifndef VEXCL_SOLVER_GMRES_HPP
+#define VEXCL_SOLVER_GMRES_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2026 Denis Demidov <ddemidov@ksu.ru>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/solver/gmres.hpp
+ * \author Denis Demidov <ddemidov@ksu.ru>
+ * \brief  Restarted Generalized Minimal Residual method.
+ */
+
+
+namespace vex {
+namespace solver {
+
+/// Restarted Generalized Minimal Residual method.
+/**
+ * Solves general nonsymmetric systems. Right preconditioning is used. The
+ * Krylov basis is orthogonalized with classical Gram-Schmidt process with
+ * reorthogonalization: the dot products with all basis vectors are
+ * computed in a single kernel, and each orthogonalization pass is fused
+ * with the dot products of the next one. Kernels for each basis size are
+ * compiled on first use.
+ */
+template <typename T>
+class gmres {
+    public:
+        typedef T value_type;
+
+        /// Constructor.
+        /**
+         * \param queue vector of queues.
+         * \param n     size of the system.
+         * \param prm   solver parameters.
+         * \param M     number of iterations before restart.
+         */
+        gmres(const std::vector<backend::command_queue> &queue, size_t n,
+                const params &prm = params(), unsigned M = 30)
+            : queue(queue), prm(prm), M(M),
+              z(queue, n), t(queue, n),
+              H((M + 1) * M), g(M + 1), cs(M), sn(M), y(M),
+              norm(queue, 0, 1, 0, "", {"v0 * v0"}),
+              dots(M), orth(M), orth2(M), combine(M)
+        {
+            precondition(M > 0, "GMRES restart should be positive");
+
+            V.reserve(M + 1);
+            for(unsigned i = 0; i <= M; ++i)
+                V.push_back(vector<T>(queue, n));
+        }
+
+        /// Solves the system Ax = rhs.
+        /**
+         * x holds the initial approximation on input.
+         * \returns number of iterations made and the relative residual norm.
+         */
+        template <class Matrix, class Precond>
+        std::tuple<size_t, T> operator()(const Matrix &A, const Precond &P,
+                const vector<T> &rhs, vector<T> &x) const
+        {
+            norm({}, {rhs});
+            T norm_b = std::sqrt(norm.result()[0]);
+
+            if (norm_b == 0) {
+                x = 0;
+                return std::make_tuple(0, 0);
+            }
+
+            size_t iter = 0;
+            T res;
+
+            for(;;) {
+                V[0] = rhs;
+                A.apply(x, V[0], -1, true);
+
+                norm({}, {V[0]});
+                T beta = std::sqrt(norm.result()[0]);
+
+                res = beta / norm_b;
+                if (res <= prm.tol || iter >= prm.maxiter) break;
+
+                V[0] /= beta;
+
+                std::fill(g.begin(), g.end(), T());
+                g[0] = beta;
+
+                unsigned k = 0;
+                while(k < M && iter < prm.maxiter) {
+                    const unsigned j = k;
+
+                    const vector<T> &zj = detail::apply_precond(P, V[j], z);
+                    A.apply(zj, V[j + 1], 1, false);
+
+                    std::vector< std::reference_wrapper<const vector<T> > >
+                        basis(V.begin(), V.begin() + j + 1);
+
+                    std::vector< std::reference_wrapper<const vector<T> > > w_basis;
+                    w_basis.push_back(V[j + 1]);
+                    w_basis.insert(w_basis.end(), basis.begin(), basis.end());
+
+                    // Two passes of classical Gram-Schmidt.
+                    get_dots(j)({}, w_basis);
+                    std::vector<T> h = get_dots(j).result();
+
+                    get_orth(j)({V[j + 1]}, basis, h);
+                    std::vector<T> h2 = get_orth(j).result();
+                    h2.pop_back();
+
+                    get_orth2(j)({V[j + 1]}, basis, h2);
+                    T ww = get_orth2(j).result()[0];
+
+                    T hn = std::sqrt(ww);
+                    if (hn != 0) V[j + 1] /= hn;
+
+                    T *Hj = &H[j * (M + 1)];
+                    for(unsigned i = 0; i <= j; ++i) Hj[i] = h[i] + h2[i];
+                    Hj[j + 1] = hn;
+
+                    // Apply previous Givens rotations to the new column of H,
+                    // and compute the one eliminating its subdiagonal element.
+                    for(unsigned i = 0; i < j; ++i) {
+                        T tmp     =  cs[i] * Hj[i] + sn[i] * Hj[i + 1];
+                        Hj[i + 1] = -sn[i] * Hj[i] + cs[i] * Hj[i + 1];
+                        Hj[i]     = tmp;
+                    }
+
+                    T d = std::sqrt(Hj[j] * Hj[j] + hn * hn);
+                    if (d == 0) {
+                        cs[j] = 1;
+                        sn[j] = 0;
+                    } else {
+                        cs[j] = Hj[j] / d;
+                        sn[j] = hn / d;
+                    }
+
+                    Hj[j]     = d;
+                    Hj[j + 1] = 0;
+
+                    g[j + 1] = -sn[j] * g[j];
+                    g[j]     =  cs[j] * g[j];
+
+                    ++k;
+                    ++iter;
+
+                    if (std::abs(g[k]) / norm_b <= prm.tol) break;
+                }
+
+                // Solve the upper triangular system Hy = g.
+                for(unsigned i = k; i-- > 0; ) {
+                    T sum = g[i];
+                    for(unsigned l = i + 1; l < k; ++l)
+                        sum -= H[l * (M + 1) + i] * y[l];
+                    y[i] = sum / H[i * (M + 1) + i];
+                }
+
+                // Update the solution: x += P (V y).
+                std::vector< std::reference_wrapper<const vector<T> > >
+                    basis(V.begin(), V.begin() + k);
+
+                get_combine(k - 1)({t}, basis, std::vector<T>(y.begin(), y.begin() + k));
+
+                x += detail::apply_precond(P, t, z);
+            }
+
+            return std::make_tuple(iter, res);
+        }
+
+        /// Solves the system Ax = rhs without preconditioning.
+        template <class Matrix>
+        std::tuple<size_t, T> operator()(const Matrix &A,
+                const vector<T> &rhs, vector<T> &x) const
+        {
+            return (*this)(A, identity(), rhs, x);
+        }
+    private:
+        typedef detail::fused_update<T> kernel_type;
+
+        std::vector<backend::command_queue> queue;
+
+        params   prm;
+        unsigned M;
+
+        mutable std::vector< vector<T> > V;
+        mutable vector<T> z, t;
+
+        mutable std::vector<T> H, g, cs, sn, y;
+
+        mutable kernel_type norm;
+
+        mutable std::vector< std::unique_ptr<kernel_type> > dots, orth, orth2, combine;
+
+        // Dot products of w (v0) with the first j + 1 basis vectors.
+        kernel_type& get_dots(unsigned j) const {
+            if (!dots[j]) {
+                std::vector<std::string> d;
+                for(unsigned i = 1; i <= j + 1; ++i)
+                    d.push_back("v0 * v" + std::to_string(i));
+                dots[j].reset(new kernel_type(queue, 0, j + 2, 0, "", d));
+            }
+            return *dots[j];
+        }
+
+        // Orthogonalizes w (v0) against the first j + 1 basis vectors, and
+        // computes dot products for the next pass together with the norm.
+        kernel_type& get_orth(unsigned j) const {
+            if (!orth[j]) {
+                std::vector<std::string> d;
+                for(unsigned i = 1; i <= j + 1; ++i)
+                    d.push_back("v0 * v" + std::to_string(i));
+                d.push_back("v0 * v0");
+                orth[j].reset(new kernel_type(queue, 1, j + 1, j + 1, subtract(j), d));
+            }
+            return *orth[j];
+        }
+
+        // Second orthogonalization pass, computes the norm of the result.
+        kernel_type& get_orth2(unsigned j) const {
+            if (!orth2[j])
+                orth2[j].reset(new kernel_type(queue, 1, j + 1, j + 1, subtract(j),
+                            std::vector<std::string>(1, "v0 * v0")));
+            return *orth2[j];
+        }
+
+        // Linear combination of the first j + 1 basis vectors.
+        kernel_type& get_combine(unsigned j) const {
+            if (!combine[j]) {
+                std::ostringstream body;
+                body << "v0 = a0 * v1";
+                for(unsigned i = 1; i <= j; ++i)
+                    body << " + a" << i << " * v" << i + 1;
+                body << ";";
+                combine[j].reset(new kernel_type(queue, 1, j + 1, j + 1, body.str()));
+            }
+            return *combine[j];
+        }
+
+        static std::string subtract(unsigned j) {
+            std::ostringstream body;
+            body << "v0 -= a0 * v1";
+            for(unsigned i = 1; i <= j; ++i)
+                body << " + a" << i << " * v" << i + 1;
+            body << ";";
+            return body.str();
+        }
+};
+
+} // namespace solver
+} // namespace vex
+
+#endif
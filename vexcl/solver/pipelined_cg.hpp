@@ -0,0 +1,161 @@
+#ifndef VEXCL_SOLVER_PIPELINED_CG_HPP
+#define VEXCL_SOLVER_PIPELINED_CG_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2026 Denis Demidov <ddemidov@ksu.ru>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/solver/pipelined_cg.hpp
+ * \author Denis Demidov <ddemidov@ksu.ru>
+ * \brief  Pipelined Conjugate Gradient method.
+ */
+
+
+namespace vex {
+namespace solver {
+
+/// Pipelined Conjugate Gradient method.
+/**
+ * Ghysels and Vanroose reformulation of the preconditioned CG method. All
+ * vector updates of an iteration are done in a single kernel that also
+ * computes the dot products for the next iteration. Partial sums are read
+ * from the compute devices while the preconditioner and the matrix-vector
+ * product are being applied, so an iteration has a single synchronization
+ * point. The method needs more memory than cg and may converge to a less
+ * accurate solution.
+ */
+template <typename T>
+class pipelined_cg {
+    public:
+        typedef T value_type;
+
+        /// Constructor.
+        /**
+         * \param queue vector of queues.
+         * \param size  size of the system.
+         * \param prm   solver parameters.
+         */
+        pipelined_cg(const std::vector<backend::command_queue> &queue, size_t size,
+                const params &prm = params())
+            : prm(prm),
+              r(queue, size), u(queue, size), w(queue, size), m(queue, size),
+              n(queue, size), z(queue, size), q(queue, size), s(queue, size),
+              p(queue, size),
+              norm(queue, 0, 1, 0, "", {"v0 * v0"}),
+              dots(queue, 0, 3, 0, "", {"v0 * v1", "v2 * v1", "v0 * v0"}),
+              // z = n + beta * z;  q = m + beta * q;
+              // s = w + beta * s;  p = u + beta * p;
+              // x += alpha * p;    r -= alpha * s;
+              // u -= alpha * q;    w -= alpha * z;
+              update(queue, 8, 2, 2,
+                      "v0 = v8 + a1 * v0; v1 = v9 + a1 * v1; "
+                      "v2 = v7 + a1 * v2; v3 = v6 + a1 * v3; "
+                      "v4 += a0 * v3; v5 -= a0 * v2; "
+                      "v6 -= a0 * v1; v7 -= a0 * v0;",
+                      {"v5 * v6", "v7 * v6", "v5 * v5"})
+        {}
+
+        /// Solves the system Ax = rhs.
+        /**
+         * x holds the initial approximation on input.
+         * \returns number of iterations made and the relative residual norm.
+         */
+        template <class Matrix, class Precond>
+        std::tuple<size_t, T> operator()(const Matrix &A, const Precond &P,
+                const vector<T> &rhs, vector<T> &x) const
+        {
+            norm({}, {rhs});
+            T norm_b = std::sqrt(norm.result()[0]);
+
+            if (norm_b == 0) {
+                x = 0;
+                return std::make_tuple(0, 0);
+            }
+
+            r = rhs;
+            A.apply(x, r, -1, true);
+
+            P.apply(r, u);
+            A.apply(u, w, 1, false);
+
+            dots({}, {r, u, w});
+
+            const vector<T> &mw = detail::apply_precond(P, w, m);
+            A.apply(mw, n, 1, false);
+
+            T gamma = dots.result()[0];
+            T delta = dots.result()[1];
+            T res   = std::sqrt(dots.result()[2]) / norm_b;
+
+            z = 0;
+            q = 0;
+            s = 0;
+            p = 0;
+
+            T alpha = 0, gamma_old = 0;
+
+            size_t iter = 0;
+            while(res > prm.tol && iter < prm.maxiter) {
+                T beta = iter ? gamma / gamma_old : 0;
+
+                alpha = iter ? gamma / (delta - beta * gamma / alpha) : gamma / delta;
+
+                update({z, q, s, p, x, r, u, w}, {n, mw}, {alpha, beta});
+
+                gamma_old = gamma;
+
+                // The reduction is overlapped with the preconditioner and
+                // the matrix-vector product for the next iteration.
+                if (++iter < prm.maxiter) {
+                    detail::apply_precond(P, w, m);
+                    A.apply(mw, n, 1, false);
+                }
+
+                gamma = update.result()[0];
+                delta = update.result()[1];
+                res   = std::sqrt(update.result()[2]) / norm_b;
+            }
+
+            return std::make_tuple(iter, res);
+        }
+
+        /// Solves the system Ax = rhs without preconditioning.
+        template <class Matrix>
+        std::tuple<size_t, T> operator()(const Matrix &A,
+                const vector<T> &rhs, vector<T> &x) const
+        {
+            return (*this)(A, identity(), rhs, x);
+        }
+    private:
+        params prm;
+
+        mutable vector<T> r, u, w, m, n, z, q, s, p;
+
+        mutable detail::fused_update<T> norm, dots, update;
+};
+
+} // namespace solver
+} // namespace vex
+
+#endif
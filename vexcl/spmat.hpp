@@ -36,12 +36,22 @@ THE SOFTWARE.
 #include <unordered_map>
 #include <string>
 #include <memory>
+#include <numeric>
 #include <algorithm>
 #include <iostream>
 #include <type_traits>
+#include <limits>
 
 #include <vexcl/vector.hpp>
 #include <vexcl/vector_view.hpp>
+#include <vexcl/dynamic_multivector.hpp>
+#include <vexcl/reductor.hpp>
+#include <vexcl/cast.hpp>
+#include <vexcl/sort.hpp>
+#include <vexcl/scan.hpp>
+#include <vexcl/reduce_by_key.hpp>
+#include <vexcl/spmat/rcm.hpp>
+#include <vexcl/spmat/format.hpp>
 
 #if defined(VEXCL_BACKEND_CUDA)
 #  include <vexcl/backend/cuda/cusparse.hpp>
@@ -49,15 +59,135 @@ THE SOFTWARE.
 
 namespace vex {
 
+template <typename T, size_t N> class multivector;
+
+/// \cond INTERNAL
+namespace detail {
+
+// Sorts COO triplets by (row, col), sums duplicate entries and converts the
+// result to CSR format on a single device. Returns the number of unique
+// nonzeros; their values are returned in v.
+template <typename col_t, typename val_t, typename I, typename C>
+size_t coo_to_csr(
+        const std::vector<backend::command_queue> &queue, size_t n, size_t m,
+        const vex::vector<col_t> &row,
+        const vex::vector<col_t> &col,
+        const vex::vector<val_t> &val,
+        backend::device_vector<I> &ptr,
+        backend::device_vector<C> &c,
+        vex::vector<val_t> &v
+        )
+{
+    const backend::command_queue &q = queue[0];
+
+    ptr = backend::device_vector<I>(q, n + 1);
+
+    if (row.size() == 0) {
+        vex::vector<I>(q, ptr) = 0;
+        return 0;
+    }
+
+    vex::vector<cl_ulong> key(queue, row.size());
+    vex::vector<val_t>    tmp(queue, val.size());
+
+    key = vex::cast<cl_ulong>(row) * m + col;
+    tmp = val;
+
+    vex::sort_by_key(key, tmp);
+
+    vex::vector<cl_ulong> ukey;
+    size_t nnz = reduce_by_key(key, tmp, ukey, v);
+
+    c = backend::device_vector<C>(q, nnz);
+
+    // Split the keys into row pointers and column numbers.
+    static kernel_cache cache;
+
+    auto ckey   = backend::cache_key(q);
+    auto kernel = cache.find(ckey);
+
+    backend::select_context(q);
+
+    if (kernel == cache.end()) {
+        backend::source_generator src(q);
+
+        src.kernel("coo_to_csr")
+            .open("(")
+                .template parameter< size_t >("nnz")
+                .template parameter< size_t >("n")
+                .template parameter< cl_ulong >("m")
+                .template parameter< global_ptr<const cl_ulong> >("key")
+                .template parameter< global_ptr<I> >("ptr")
+                .template parameter< global_ptr<C> >("col")
+            .close(")").open("{");
+
+        src.grid_stride_loop("j").open("{");
+        src.new_line() << "size_t r = key[j] / m;";
+        src.new_line() << "col[j] = key[j] % m;";
+        src.new_line() << "for(size_t i = j ? key[j - 1] / m + 1 : 0; i <= r; ++i)";
+        src.new_line() << "    ptr[i] = j;";
+        src.new_line() << "if (j + 1 == nnz)";
+        src.open("{");
+        src.new_line() << "for(size_t i = r + 1; i <= n; ++i) ptr[i] = nnz;";
+        src.close("}");
+        src.close("}");
+
+        src.close("}");
+
+        backend::kernel krn(q, src.str(), "coo_to_csr");
+        kernel = cache.insert(std::make_pair(ckey, krn)).first;
+    }
+
+    kernel->second.push_arg(nnz);
+    kernel->second.push_arg(n);
+    kernel->second.push_arg(static_cast<cl_ulong>(m));
+    kernel->second.push_arg(ukey(0));
+    kernel->second.push_arg(ptr);
+    kernel->second.push_arg(c);
+
+    kernel->second(q);
+
+    return nnz;
+}
+
+} // namespace detail
+/// \endcond
+
 /// Sparse matrix in hybrid ELL-CSR format.
-template <typename val_t, typename col_t = size_t, typename idx_t = size_t>
+/**
+ * \tparam val_t   value type of the vectors the matrix is applied to.
+ * \tparam col_t   type of column numbers in the host arrays.
+ * \tparam idx_t   type of row pointers in the host arrays.
+ * \tparam store_t type of matrix values stored on compute devices. Values
+ *                 are converted to val_t in registers, so a matrix stored in
+ *                 single precision may be applied to double precision
+ *                 vectors with half the memory traffic.
+ *
+ * Column numbers and row pointers are stored on compute devices relative to
+ * the device partition of the matrix, so 64-bit indices are compressed to 32
+ * bits where the partition allows. Partitions too large for 32-bit indices
+ * keep the host index types; such matrices may not be used in inlined
+ * products.
+ */
+template <typename val_t, typename col_t = size_t, typename idx_t = size_t,
+          typename store_t = val_t>
 class SpMat {
     public:
         typedef val_t value_type;
         typedef typename cl_scalar_of<val_t>::type scalar_type;
 
+        /// Type of column numbers stored on compute devices.
+        typedef typename std::conditional<
+            (sizeof(col_t) > sizeof(cl_uint)), cl_uint, col_t
+            >::type dev_col_t;
+
+        /// Type of row pointers stored on compute devices.
+        typedef typename std::conditional<
+            (sizeof(idx_t) > sizeof(cl_uint)), cl_uint, idx_t
+            >::type dev_idx_t;
+
         /// Empty constructor.
-        SpMat() : nrows(0), ncols(0), nnz(0) {}
+        SpMat() : direct_exchange(false), nrows(0), ncols(0), nnz(0) {}
 
         /// Constructor.
         /**
@@ -65,7 +195,10 @@ class SpMat {
          * format. GPU matrix utilizes ELL format and is split equally across
          * all compute devices. When there are more than one device, secondary
          * queue can be used to perform transfer of ghost values across GPU
-         * boundaries in parallel with computation kernel.
+         * boundaries in parallel with computation kernel. When all devices
+         * share the same context (see vex::Context constructor), ghost values
+         * are copied directly between devices without staging them through
+         * host memory.
          * \param queue vector of queues. Each queue represents one
          *            compute device.
          * \param n   number of rows in the matrix.
@@ -73,44 +206,116 @@ class SpMat {
          * \param row row index into col and val vectors.
          * \param col column numbers of nonzero elements of the matrix.
          * \param val values of nonzero elements of the matrix.
+         * \param ord ordering of the matrix rows and columns. When set to
+         *            ordering::rcm, the matrix is stored in Reverse
+         *            Cuthill-McKee order, which reduces its bandwidth. This
+         *            improves locality of x reads and decreases the number
+         *            of ghost values exchanged between devices. Input and
+         *            output vectors should then be permuted with permute()
+         *            and unpermute().
          */
         SpMat(const std::vector<backend::command_queue> &queue,
-              size_t n, size_t m, const idx_t *row, const col_t *col, const val_t *val
+              size_t n, size_t m, const idx_t *row, const col_t *col, const val_t *val,
+              ordering ord = ordering::natural
               )
             : queue(queue), part(partition(n, queue)),
-              mtx(queue.size()), exc(queue.size()),
+              mtx(queue.size()), exc(queue.size()), fmt(queue.size()), wide(queue.size()),
+              direct_exchange(false),
               nrows(n), ncols(m), nnz(row[n])
         {
-            auto col_part = partition(m, queue);
+            if (ord == ordering::natural) {
+                init(row, col, val);
+                return;
+            }
 
-            // Create secondary queues.
-            for(auto q = queue.begin(); q != queue.end(); q++)
-                squeue.push_back(backend::duplicate_queue(*q));
+            precondition(n == m, "Only square matrices may be reordered");
 
-            std::vector<std::set<col_t>> ghost_cols = setup_exchange(col_part, row, col);
+            perm = detail::rcm(n, row, col);
 
-            // Each device get it's own strip of the matrix.
-#ifdef _OPENMP
-#  pragma omp parallel for schedule(static,1)
-#endif
-            for(int d = 0; d < static_cast<int>(queue.size()); d++) {
-                if (part[d + 1] > part[d]) {
-                    if ( backend::is_cpu(queue[d]) )
-                        mtx[d].reset(
-                                new SpMatCSR(queue[d],
-                                    row + part[d], row + part[d+1], col, val,
-                                    col_part[d], col_part[d+1], ghost_cols[d])
-                                );
-                    else
-                        mtx[d].reset(
-                                new SpMatHELL(queue[d],
-                                    row + part[d], row + part[d + 1], col, val,
-                                    col_part[d], col_part[d+1], ghost_cols[d])
-                                );
+            std::vector<size_t> iperm(n);
+            for(size_t i = 0; i < n; ++i) iperm[perm[i]] = i;
+
+            std::vector<idx_t> r(n + 1);
+            std::vector<col_t> c(nnz);
+            std::vector<val_t> v(nnz);
+
+            vperm.resize(nnz);
+
+            r[0] = 0;
+            for(size_t i = 0; i < n; ++i) {
+                size_t k = r[i];
+                for(size_t j = row[perm[i]]; j < static_cast<size_t>(row[perm[i] + 1]); ++j, ++k) {
+                    c[k] = static_cast<col_t>(iperm[col[j]]);
+                    v[k] = val[j];
+                    vperm[k] = j;
                 }
+                r[i + 1] = static_cast<idx_t>(k);
+            }
+
+            init(r.data(), c.data(), v.data());
+
+            if (queue.size() == 1 && fits<dev_col_t>(n)) {
+                std::vector<dev_col_t> p(perm.begin(), perm.end());
+                fwd = vex::vector<dev_col_t>(queue, p);
+
+                for(size_t i = 0; i < n; ++i) p[perm[i]] = static_cast<dev_col_t>(i);
+                bwd = vex::vector<dev_col_t>(queue, p);
             }
         }
 
+#if defined(VEXCL_BACKEND_OPENCL) || !defined(VEXCL_USE_CUSPARSE)
+        /// Constructor.
+        /**
+         * Assembles the matrix on the compute device from nonzero entries
+         * given in COO format. The entries may be unordered, duplicate
+         * entries are summed. The triplets are sorted and reduced by key,
+         * and the row pointers and the ELL width are computed on the device,
+         * so that the matrix never passes through host memory. Only
+         * single-device contexts are supported.
+         * \param queue vector of queues (should contain single queue).
+         * \param n   number of rows in the matrix.
+         * \param m   number of cols in the matrix.
+         * \param row row numbers of nonzero elements of the matrix.
+         * \param col column numbers of nonzero elements of the matrix.
+         * \param val values of nonzero elements of the matrix.
+         */
+        SpMat(const std::vector<backend::command_queue> &queue,
+              size_t n, size_t m,
+              const vex::vector<col_t> &row,
+              const vex::vector<col_t> &col,
+              const vex::vector<val_t> &val
+              )
+            : queue(queue), part(partition(n, queue)),
+              mtx(queue.size()), exc(queue.size()), fmt(queue.size()), wide(queue.size()),
+              direct_exchange(false),
+              nrows(n), ncols(m), nnz(0)
+        {
+            precondition(queue.size() == 1,
+                    "COO assembly is only supported for single device contexts");
+
+            precondition(row.size() == col.size() && row.size() == val.size(),
+                    "COO arrays should have same size");
+
+            // Matrices too large for the compact device index types keep
+            // the host ones.
+            wide[0] = !(fits<dev_col_t>(m) && fits<dev_idx_t>(row.size()));
+
+            precondition(!wide[0] || (fits<col_t>(m) && fits<idx_t>(row.size())),
+                    "Matrix is too large for the index types");
+
+            squeue.push_back(backend::duplicate_queue(queue[0]));
+
+            col_part = partition(m, queue);
+            ghost.resize(1);
+
+            if (!n) return;
+
+            if (wide[0])
+                assemble<col_t, idx_t>(row, col, val);
+            else
+                assemble<dev_col_t, dev_idx_t>(row, col, val);
+        }
+#endif
 
         /// Matrix-vector multiplication.
         /**
@@ -126,25 +331,7 @@ class SpMat {
         void apply(const vex::vector<val_t> &x, vex::vector<val_t> &y,
                  scalar_type alpha = 1, bool append = false) const
         {
-            using namespace detail;
-
-            static kernel_cache cache;
-
-            if (rx.size()) {
-                // Gather values to send to neighbors.
-                for(unsigned d = 0; d < queue.size(); d++) {
-                    if (cidx[d + 1] > cidx[d]) {
-                        vex::vector<col_t> cols(queue[d], exc[d].cols_to_send);
-                        vex::vector<val_t> vals(queue[d], exc[d].vals_to_send);
-                        vex::vector<val_t> xloc(queue[d], x(d));
-
-                        vals = permutation(cols)(xloc);
-                    }
-                }
-
-                for(unsigned d = 0; d < queue.size(); d++)
-                    if (cidx[d + 1] > cidx[d]) queue[d].finish();
-            }
+            gather_ghosts(x);
 
             // Start computing contribution from local part of the matrix.
             for(unsigned d = 0; d < queue.size(); d++)
@@ -153,43 +340,243 @@ class SpMat {
                     mtx[d]->mul_local(x(d), y(d), alpha, append);
                 }
 
+            // Meanwhile, transfer ghost values, ...
+            exchange_ghosts();
 
-            if (rx.size()) {
-                // Meanwhile, get gathered values to host, ...
-                for(unsigned d = 0; d < queue.size(); d++) {
-                    if (cidx[d + 1] > cidx[d]) {
-                        backend::select_context(squeue[d]);
-                        vex::vector<val_t> vals(squeue[d], exc[d].vals_to_send);
-                        vex::copy(vals.begin(), vals.end(), &rx[cidx[d]], /*blocking=*/false);
-                    }
+            // ... and compute contribution from remote part of the matrix.
+            for(unsigned d = 0; d < queue.size(); d++) {
+                if (exc[d].nrecv) {
+                    backend::select_context(queue[d]);
+                    mtx[d]->mul_remote(exc[d].rx, y(d), alpha);
                 }
+            }
+        }
 
-                for(unsigned d = 0; d < queue.size(); d++)
-                    if (cidx[d + 1] > cidx[d]) squeue[d].finish();
-
-                // ... send ghost points from our neighbors to device, ...
-                for(unsigned d = 0; d < queue.size(); d++) {
-                    if (exc[d].cols_to_recv.size()) {
-                        for(size_t i = 0; i < exc[d].cols_to_recv.size(); i++)
-                            exc[d].vals_to_recv[i] = rx[exc[d].cols_to_recv[i]];
+#if defined(VEXCL_BACKEND_OPENCL) || !defined(VEXCL_USE_CUSPARSE)
+        /// Sparse matrix-multivector product.
+        /**
+         * All components of the multivector are multiplied by a single
+         * kernel, so that the matrix is read once for each max_block_width
+         * components instead of once per component. Ghost values of all
+         * components are transfered across device boundaries together.
+         */
+        template <size_t N>
+        void apply(const multivector<val_t, N> &x, multivector<val_t, N> &y,
+                 scalar_type alpha = 1, bool append = false) const
+        {
+            std::vector<block> xb(queue.size()), yb(queue.size());
 
-                        exc[d].rx.write(squeue[d], 0, exc[d].vals_to_recv.size(),
-                                exc[d].vals_to_recv.data()
-                                );
-                    }
+            for(unsigned d = 0; d < queue.size(); d++) {
+                for(size_t k = 0; k < N; k++) {
+                    xb[d].push_back(&x(k)(d), 0);
+                    yb[d].push_back(&y(k)(d), 0);
                 }
+            }
 
-                for(unsigned d = 0; d < queue.size(); d++)
-                    if (exc[d].cols_to_recv.size()) squeue[d].finish();
+            apply_block(xb, yb, N, alpha, append);
+        }
 
-                // Compute contribution from remote part of the matrix.
-                for(unsigned d = 0; d < queue.size(); d++) {
-                    if (exc[d].cols_to_recv.size()) {
-                        backend::select_context(queue[d]);
-                        mtx[d]->mul_remote(exc[d].rx, y(d), alpha);
-                    }
+        /// Sparse matrix-multivector product.
+        /**
+         * Same as above for a multivector with the number of components
+         * set at runtime. The multivectors may have different layouts.
+         */
+        void apply(const dynamic_multivector<val_t> &x, dynamic_multivector<val_t> &y,
+                 scalar_type alpha = 1, bool append = false) const
+        {
+            precondition(
+                    x.components() == y.components() &&
+                    x.row_partition() == part && y.row_partition() == part,
+                    "Incompatible multivectors"
+                    );
+
+            const size_t m = x.components();
+
+            std::vector<block> xb(queue.size()), yb(queue.size());
+
+            for(unsigned d = 0; d < queue.size(); d++) {
+                xb[d].stride = x.storage_layout() == layout::aos ? m : 1;
+                yb[d].stride = y.storage_layout() == layout::aos ? m : 1;
+
+                for(size_t k = 0; k < m; k++) {
+                    xb[d].push_back(&x(d), x.local_index(d, 0, k));
+                    yb[d].push_back(&y(d), y.local_index(d, 0, k));
                 }
             }
+
+            apply_block(xb, yb, m, alpha, append);
+        }
+#endif
+
+#if defined(VEXCL_BACKEND_OPENCL) || !defined(VEXCL_USE_CUSPARSE)
+        /// Replaces values of the nonzero entries.
+        /**
+         * The sparsity pattern of the matrix stays the same. The values are
+         * given in the order of the CSR arrays the matrix was constructed
+         * from, and are scattered into the device layout with the help of a
+         * map computed at construction. This avoids repeating the analysis
+         * of the matrix structure in time-stepping or Newton iterations. The
+         * map is kept in host memory until the first call, so that matrices
+         * whose values are never updated do not spend device memory on it.
+         */
+        void update_values(const val_t *val) {
+            precondition(!vpart.empty(),
+                    "The matrix was not constructed from CSR arrays");
+
+            At.reset();
+
+            std::vector<val_t> v;
+            if (!vperm.empty()) {
+                v.resize(vperm.size());
+                for(size_t k = 0; k < vperm.size(); ++k) v[k] = val[vperm[k]];
+                val = v.data();
+            }
+
+            for(unsigned d = 0; d < queue.size(); d++) {
+                if (!mtx[d] || vpart[d + 1] == vpart[d]) continue;
+
+                backend::device_vector<val_t> v(queue[d], vpart[d + 1] - vpart[d],
+                        val + vpart[d], backend::MEM_READ_ONLY);
+
+                mtx[d]->update_values(v);
+            }
+        }
+
+        /// Replaces values of the nonzero entries.
+        /**
+         * Same as above, with the values residing on the compute devices.
+         * Unless the vector is partitioned as nonzero_partition() (which is
+         * always the case for single-device contexts), or the matrix was
+         * reordered, the values are redistributed through host memory.
+         */
+        void update_values(const vex::vector<val_t> &val) {
+            precondition(!vpart.empty(),
+                    "The matrix was not constructed from CSR arrays");
+
+            precondition(val.size() == vpart.back(), "Wrong number of values");
+
+            if (!vperm.empty() || val.nparts() != queue.size() || val.partition() != vpart) {
+                std::vector<val_t> v(val.size());
+                vex::copy(val, v);
+                update_values(v.data());
+                return;
+            }
+
+            At.reset();
+
+            for(unsigned d = 0; d < queue.size(); d++)
+                if (mtx[d] && vpart[d + 1] > vpart[d]) mtx[d]->update_values(val(d));
+        }
+
+        /// Partitioning of the nonzero entries across devices.
+        /**
+         * Device d holds values with indices in [p[d], p[d+1]) of the CSR
+         * value array.
+         */
+        const std::vector<size_t>& nonzero_partition() const {
+            return vpart;
+        }
+
+        /// Transposed matrix-vector multiplication.
+        /**
+         * Computes \f$y = \alpha A^Tx\f$ or \f$y += \alpha A^Tx\f$. The
+         * vectors are partitioned as for the product with the transposed
+         * matrix, i.e. x has rows() and y has cols() elements.
+         */
+        void apply_transposed(const vex::vector<val_t> &x, vex::vector<val_t> &y,
+                 scalar_type alpha = 1, bool append = false) const
+        {
+            transposed().apply(x, y, alpha, append);
+        }
+
+        /// Transposed matrix.
+        /**
+         * The transposed matrix is assembled on the first call from the
+         * device representation of the matrix, and is kept until the
+         * values of the matrix are updated. So the memory is only spent for
+         * matrices that are actually used in transposed products, and the
+         * user does not need to keep the host copy of the matrix around.
+         * The returned matrix may be used in expressions as
+         * \code
+         * y = x - A.transposed() * z;
+         * \endcode
+         */
+        const SpMat& transposed() const {
+            if (At) return *At;
+
+            coo_entries e;
+
+            for(unsigned d = 0; d < queue.size(); d++) {
+                if (!mtx[d]) continue;
+
+                size_t first = e.row.size();
+
+                mtx[d]->get_entries(static_cast<col_t>(col_part[d]), ghost[d], e);
+
+                for(size_t k = first; k < e.row.size(); ++k) e.row[k] += part[d];
+            }
+
+            // Sort the entries by column with counting sort.
+            std::vector<idx_t> ptr(ncols + 1, 0);
+            for(size_t k = 0; k < e.col.size(); ++k) ++ptr[e.col[k] + 1];
+
+            std::partial_sum(ptr.begin(), ptr.end(), ptr.begin());
+
+            std::vector<idx_t> pos(ptr.begin(), ptr.end() - 1);
+            std::vector<col_t> col(e.col.size());
+            std::vector<val_t> val(e.col.size());
+
+            for(size_t k = 0; k < e.col.size(); ++k) {
+                size_t j = pos[e.col[k]]++;
+
+                col[j] = static_cast<col_t>(e.row[k]);
+                val[j] = e.val[k];
+            }
+
+            At.reset(new SpMat(queue, ncols, nrows, ptr.data(), col.data(), val.data()));
+
+            return *At;
+        }
+#endif
+
+        /// Permutation applied to the matrix.
+        /**
+         * Row i of the stored matrix is row p[i] of the original one. Empty
+         * unless the matrix was constructed with ordering::rcm.
+         */
+        const std::vector<size_t>& reordering() const {
+            return perm;
+        }
+
+        /// Permutes vector into the ordering of the matrix.
+        /**
+         * Sets y[i] = x[p[i]], where p is the matrix reordering(). On a
+         * single device this is done with a single gather kernel; multi-device
+         * vectors are permuted through host memory.
+         */
+        template <typename T>
+        void permute(const vex::vector<T> &x, vex::vector<T> &y) const {
+            gather(fwd, x, y, false);
+        }
+
+        /// Permutes vector from the ordering of the matrix back to the original one.
+        /**
+         * Sets y[p[i]] = x[i], where p is the matrix reordering(). This is the
+         * inverse of permute().
+         */
+        template <typename T>
+        void unpermute(const vex::vector<T> &x, vex::vector<T> &y) const {
+            gather(bwd, x, y, true);
+        }
+
+        /// Storage format selected for the matrix partition on the given device.
+        /**
+         * The format is chosen from statistics of row widths in the
+         * partition. The returned structure contains the statistics and the
+         * reason for the decision, so that it may be logged.
+         */
+        const spmat_format_choice& format(unsigned d) const {
+            return fmt[d];
         }
 
         /// Number of rows.
@@ -199,42 +586,107 @@ class SpMat {
         /// Number of non-zero entries.
         size_t nonzeros() const { return nnz;   }
 
+        // Ghost values of a vector, one buffer per device.
+        typedef std::vector< backend::device_vector<val_t> > ghost_buffers;
+
 #if defined(VEXCL_BACKEND_OPENCL) || !defined(VEXCL_USE_CUSPARSE)
+        // Formats on different devices (and of different matrices) may
+        // differ, while inlined kernels are generated once per device. So
+        // the generated code handles both storage layouts and selects the
+        // one to use at runtime. In the same way, the contribution of the
+        // remote part is always added to the product, with ghost values of
+        // the vector passed as a separate argument. Single-partition
+        // matrices pass an empty remote part and a null ghost buffer.
         static void inline_preamble(backend::source_generator &src,
-                const backend::command_queue &queue, const std::string &prm_name,
+                const backend::command_queue&, const std::string &prm_name,
                 detail::kernel_generator_state_ptr)
         {
-            if (backend::is_cpu(queue))
-                SpMatCSR::inline_preamble(src, prm_name);
-            else
-                SpMatHELL::inline_preamble(src, prm_name);
+            SpMatHELL::inline_preamble(src, prm_name);
+            SpMatCSR::inline_preamble(src, prm_name);
         }
 
         static void inline_expression(backend::source_generator &src,
-                const backend::command_queue &queue, const std::string &prm_name,
+                const backend::command_queue&, const std::string &prm_name,
                 detail::kernel_generator_state_ptr)
         {
-            if (backend::is_cpu(queue))
-                SpMatCSR::inline_expression(src, prm_name);
-            else
-                SpMatHELL::inline_expression(src, prm_name);
+            src << "((" << prm_name << "_hell ? ";
+            SpMatHELL::inline_expression(src, prm_name);
+            src << " : ";
+            SpMatCSR::inline_expression(src, prm_name);
+            src << ") + (" << prm_name << "_hell ? ";
+            SpMatHELL::inline_expression(src, prm_name, "_rem");
+            src << " : ";
+            SpMatCSR::inline_expression(src, prm_name, "_rem");
+            src << "))";
         }
 
         static void inline_parameters(backend::source_generator &src,
-                const backend::command_queue &queue, const std::string &prm_name,
+                const backend::command_queue&, const std::string &prm_name,
                 detail::kernel_generator_state_ptr)
         {
-            if (backend::is_cpu(queue))
-                SpMatCSR::inline_parameters(src, prm_name);
-            else
-                SpMatHELL::inline_parameters(src, prm_name);
+            src.template parameter<int>(prm_name) << "_hell";
+            SpMatHELL::inline_parameters(src, prm_name);
+            SpMatCSR::inline_parameters(src, prm_name);
+            SpMatHELL::inline_parameters(src, prm_name + "_rem");
+            SpMatCSR::inline_parameters(src, prm_name + "_rem");
+            src.template parameter< global_ptr<const val_t> >(prm_name) << "_vec";
+            src.template parameter< global_ptr<const val_t> >(prm_name) << "_rem_vec";
         }
 
         static void inline_arguments(backend::kernel &kernel, unsigned part,
                 size_t /*index_offset*/, const SpMat &A, const vector<val_t> &x,
-                detail::kernel_generator_state_ptr)
+                const ghost_buffers *rx, detail::kernel_generator_state_ptr)
         {
-            A.mtx[part]->setArgs(kernel, part, x);
+            precondition(!A.wide[part],
+                    "Inlined products need partitions with compact device indices");
+
+            // Ghost values are exchanged right before the first device gets
+            // its arguments, so that they are up to date with x.
+            if (A.queue.size() > 1 && part == A.first_part()) {
+                precondition(rx != 0, "Ghost buffers are missing for the inlined product");
+                A.gather_ghosts(x);
+                A.exchange_ghosts(rx);
+            }
+
+            if (A.fmt[part].format == spmat_format::hell) {
+                kernel.push_arg(1);
+                A.mtx[part]->setArgs(kernel);
+                SpMatCSR::null_args(kernel);
+                A.mtx[part]->setRemoteArgs(kernel);
+                SpMatCSR::null_args(kernel);
+            } else {
+                kernel.push_arg(0);
+                SpMatHELL::null_args(kernel);
+                A.mtx[part]->setArgs(kernel);
+                SpMatHELL::null_args(kernel);
+                A.mtx[part]->setRemoteArgs(kernel);
+            }
+
+            kernel.push_arg(x(part));
+
+            if (A.exc[part].nrecv)
+                kernel.push_arg((*rx)[part]);
+            else
+                kernel.push_arg(static_cast<void*>(0));
+        }
+
+        // Returns ghost buffers for an inlined product of a multi-partition
+        // matrix (null otherwise). Every inlined product holds a set of its
+        // own, so that several of them may share a kernel. Sets that are no
+        // longer referenced by any product are reused.
+        std::shared_ptr<ghost_buffers> inline_ghosts() const {
+            if (queue.size() < 2) return std::shared_ptr<ghost_buffers>();
+
+            for(auto g = ghost_pool.begin(); g != ghost_pool.end(); ++g)
+                if (g->use_count() == 1) return *g;
+
+            std::shared_ptr<ghost_buffers> g = std::make_shared<ghost_buffers>();
+
+            for(unsigned d = 0; d < queue.size(); d++)
+                g->push_back(backend::device_vector<val_t>(queue[d], exc[d].nrecv));
+
+            ghost_pool.push_back(g);
+            return g;
         }
 #endif
     private:
@@ -243,6 +695,302 @@ class SpMat {
             return v.size() * sizeof(T);
         }
 
+        template <typename T>
+        void gather(const vex::vector<dev_col_t> &idx,
+                const vex::vector<T> &x, vex::vector<T> &y, bool inverse) const
+        {
+            precondition(!perm.empty(), "The matrix was not reordered");
+            precondition(x.size() == nrows && y.size() == nrows, "Wrong vector size");
+            precondition(std::addressof(x) != std::addressof(y),
+                    "Vectors can not be permuted in place");
+
+            if (idx.size() && x.nparts() == 1 && y.nparts() == 1) {
+                y = vex::permutation(idx)(x);
+                return;
+            }
+
+            std::vector<T> src(nrows), dst(nrows);
+            vex::copy(x, src);
+
+            if (inverse)
+                for(size_t i = 0; i < nrows; ++i) dst[perm[i]] = src[i];
+            else
+                for(size_t i = 0; i < nrows; ++i) dst[i] = src[perm[i]];
+
+            vex::copy(dst, y);
+        }
+
+        // First device with a nonempty partition of the matrix.
+        unsigned first_part() const {
+            unsigned d = 0;
+            while(d + 1 < queue.size() && part[d + 1] == part[d]) ++d;
+            return d;
+        }
+
+        // Gathers values of x needed by neighbors into send buffers.
+        void gather_ghosts(const vex::vector<val_t> &x) const {
+            if (cidx.empty()) return;
+
+            for(unsigned d = 0; d < queue.size(); d++) {
+                if (cidx[d + 1] > cidx[d]) {
+                    vex::vector<col_t> cols(queue[d], exc[d].cols_to_send);
+                    vex::vector<val_t> vals(queue[d], exc[d].vals_to_send);
+                    vex::vector<val_t> xloc(queue[d], x(d));
+
+                    vals = permutation(cols)(xloc);
+                }
+            }
+
+            for(unsigned d = 0; d < queue.size(); d++)
+                if (cidx[d + 1] > cidx[d]) queue[d].finish();
+        }
+
+        // Transfers gathered values into ghost buffers of the devices
+        // (exc[d].rx, unless a set of an inlined product is given). Uses
+        // secondary queues, so that the transfer may overlap with the work
+        // submitted to the primary ones.
+        void exchange_ghosts(const ghost_buffers *dst = 0) const {
+            if (direct_exchange) {
+                // Copy ghost values directly from their owners.
+                for(unsigned d = 0; d < queue.size(); d++) {
+                    if (exc[d].recv.empty()) continue;
+
+                    backend::select_context(squeue[d]);
+                    for(auto c = exc[d].recv.begin(); c != exc[d].recv.end(); ++c)
+                        (dst ? (*dst)[d] : exc[d].rx).copy_from(
+                                squeue[d], exc[c->src].vals_to_send,
+                                c->src_offset, c->dst_offset, c->size);
+                }
+
+                for(unsigned d = 0; d < queue.size(); d++)
+                    if (!exc[d].recv.empty()) squeue[d].finish();
+            } else if (rx.size()) {
+                // Get gathered values to host, ...
+                for(unsigned d = 0; d < queue.size(); d++) {
+                    if (cidx[d + 1] > cidx[d]) {
+                        backend::select_context(squeue[d]);
+                        vex::vector<val_t> vals(squeue[d], exc[d].vals_to_send);
+                        vex::copy(vals.begin(), vals.end(), &rx[cidx[d]], /*blocking=*/false);
+                    }
+                }
+
+                for(unsigned d = 0; d < queue.size(); d++)
+                    if (cidx[d + 1] > cidx[d]) squeue[d].finish();
+
+                // ... and send ghost points from our neighbors to device.
+                for(unsigned d = 0; d < queue.size(); d++) {
+                    if (exc[d].cols_to_recv.size()) {
+                        for(size_t i = 0; i < exc[d].cols_to_recv.size(); i++)
+                            exc[d].vals_to_recv[i] = rx[exc[d].cols_to_recv[i]];
+
+                        (dst ? (*dst)[d] : exc[d].rx).write(
+                                squeue[d], 0, exc[d].vals_to_recv.size(),
+                                exc[d].vals_to_recv.data()
+                                );
+                    }
+                }
+
+                for(unsigned d = 0; d < queue.size(); d++)
+                    if (exc[d].cols_to_recv.size()) squeue[d].finish();
+            }
+        }
+
+        void init(const idx_t *row, const col_t *col, const val_t *val) {
+            col_part = partition(ncols, queue);
+
+            // Create secondary queues.
+            for(auto q = queue.begin(); q != queue.end(); q++)
+                squeue.push_back(backend::duplicate_queue(*q));
+
+            std::vector<std::set<col_t>> ghost_cols = setup_exchange(col_part, row, col);
+
+            for(unsigned d = 0; d < queue.size(); d++)
+                ghost.push_back(std::vector<col_t>(ghost_cols[d].begin(), ghost_cols[d].end()));
+
+            for(unsigned d = 0; d <= queue.size(); d++)
+                vpart.push_back(row[part[d]]);
+
+            // Local indices are stored in the compact device index types
+            // where the partition allows (the maximum value is reserved as a
+            // padding marker). Larger partitions keep the host index types.
+            for(unsigned d = 0; d < queue.size(); d++) {
+                wide[d] = !(
+                        fits<dev_col_t>(col_part[d + 1] - col_part[d]) &&
+                        fits<dev_col_t>(ghost_cols[d].size()) &&
+                        fits<dev_idx_t>(vpart[d + 1] - vpart[d])
+                        );
+
+                precondition(!wide[d] || (
+                            fits<col_t>(col_part[d + 1] - col_part[d]) &&
+                            fits<col_t>(ghost_cols[d].size()) &&
+                            fits<idx_t>(vpart[d + 1] - vpart[d])
+                            ),
+                        "Matrix partition is too large for the index types"
+                        );
+            }
+
+            // Select storage format for each partition.
+            for(unsigned d = 0; d < queue.size(); d++)
+                if (part[d + 1] > part[d])
+                    fmt[d] = detail::select_spmat_format(queue[d],
+                            row_statistics(row + part[d], row + part[d + 1]));
+
+            // Each device get it's own strip of the matrix.
+#ifdef _OPENMP
+#  pragma omp parallel for schedule(static,1)
+#endif
+            for(int d = 0; d < static_cast<int>(queue.size()); d++) {
+                if (part[d + 1] > part[d]) {
+                    if (fmt[d].format == spmat_format::hell)
+                        mtx[d].reset(wide[d] ?
+                                create_part<WideHELL >(d, row, col, val, ghost_cols[d]) :
+                                create_part<SpMatHELL>(d, row, col, val, ghost_cols[d])
+                                );
+                    else
+                        mtx[d].reset(wide[d] ?
+                                create_part<WideCSR >(d, row, col, val, ghost_cols[d]) :
+                                create_part<SpMatCSR>(d, row, col, val, ghost_cols[d])
+                                );
+                }
+            }
+        }
+
+        template <typename T>
+        static bool fits(size_t n) {
+            return n < static_cast<size_t>(std::numeric_limits<T>::max());
+        }
+
+        // Maximum number of multivector components processed by a single
+        // sparse matrix-multivector kernel.
+        enum { max_block_width = 16 };
+
+        // Components of a multivector residing on a single device. Element
+        // in i-th row of k-th component is col[k][off[k] + i * stride].
+        struct block {
+            std::vector<const backend::device_vector<val_t>*> col;
+            std::vector<size_t> off;
+            size_t stride;
+
+            block() : stride(1) {}
+
+            size_t width() const {
+                return col.size();
+            }
+
+            void push_back(const backend::device_vector<val_t> *c, size_t o) {
+                col.push_back(c);
+                off.push_back(o);
+            }
+
+            block columns(size_t begin, size_t end) const {
+                block b;
+                b.col.assign(col.begin() + begin, col.begin() + end);
+                b.off.assign(off.begin() + begin, off.begin() + end);
+                b.stride = stride;
+                return b;
+            }
+
+            // Components of a row are stored next to each other (as in an
+            // interleaved multivector).
+            bool interleaved() const {
+                for(size_t k = 1; k < col.size(); ++k)
+                    if (col[k] != col[0] || off[k] != off[0] + k) return false;
+
+                return stride >= col.size();
+            }
+        };
+
+        // Checks if rows of the input block may be read by the
+        // sparse matrix-multivector kernels with vector loads.
+        static bool vector_loads(const block &in) {
+#if defined(VEXCL_BACKEND_OPENCL)
+            return std::is_arithmetic<val_t>::value
+                && in.width() > 1 && in.interleaved();
+#else
+            (void)in;
+            return false;
+#endif
+        }
+
+        // Adds the contribution of a nonzero value v in column p / stride to
+        // the sums of the sparse matrix-multivector kernels. With vector loads,
+        // the row is read by the widest loads that fit (vload16 down to
+        // vload2), and the rest of it element by element.
+        static void block_update(backend::source_generator &src,
+                size_t w, bool vload)
+        {
+            size_t k = 0;
+
+            if (vload) {
+                static const char digit[] = "0123456789abcdef";
+
+                for(size_t n = max_block_width; n > 1; n /= 2) {
+                    for(; k + n <= w; k += n) {
+                        src.open("{");
+                        src.new_line() << type_name<val_t>() << n << " t = vload" << n
+                            << "(0, in0 + in_off0 + p + " << k << ");";
+                        for(size_t j = 0; j < n; ++j)
+                            src.new_line() << "sum" << k + j << " += v * t.s" << digit[j] << ";";
+                        src.close("}");
+                    }
+                }
+
+                for(; k < w; ++k)
+                    src.new_line() << "sum" << k << " += v * in0[in_off0 + p + " << k << "];";
+            } else {
+                for(; k < w; ++k)
+                    src.new_line() << "sum" << k << " += v * in" << k << "[in_off" << k << " + p];";
+            }
+        }
+
+        // Positions of the nonzero entries of a part of the matrix in the
+        // CSR arrays the matrix was constructed from. The map is only needed
+        // by update_values(), so it is kept on the host and moved to the
+        // device on the first call.
+        template <typename I>
+        struct value_index {
+            mutable std::vector<I> host;
+            mutable backend::device_vector<I> dev;
+
+            const backend::device_vector<I>&
+            device(const backend::command_queue &q) const {
+                if (!host.empty()) {
+                    dev = backend::device_vector<I>(q, host.size(),
+                            host.data(), backend::MEM_READ_ONLY);
+                    std::vector<I>().swap(host);
+                }
+                return dev;
+            }
+        };
+
+        // Destination of values in a part of the matrix: val[i] = src[map[i]],
+        // or zero when map[i] is -1.
+        template <typename I>
+        struct value_map {
+            size_t size;
+            const backend::device_vector<I>       &map;
+            const backend::device_vector<store_t> &val;
+
+            value_map(size_t size,
+                    const backend::device_vector<I>       &map,
+                    const backend::device_vector<store_t> &val
+                    ) : size(size), map(map), val(val)
+            {}
+        };
+
+        // Nonzero entries of a matrix partition with global column numbers.
+        struct coo_entries {
+            std::vector<size_t> row;
+            std::vector<col_t>  col;
+            std::vector<val_t>  val;
+
+            void push_back(size_t i, col_t c, const store_t &v) {
+                row.push_back(i);
+                col.push_back(c);
+                val.push_back(static_cast<val_t>(v));
+            }
+        };
+
         struct sparse_matrix {
             virtual void mul_local(
                     const backend::device_vector<val_t> &x,
@@ -257,7 +1005,26 @@ class SpMat {
                     ) const = 0;
 
 #if defined(VEXCL_BACKEND_OPENCL) || !defined(VEXCL_USE_CUSPARSE)
-            virtual void setArgs(backend::kernel &kernel, unsigned part, const vector<val_t> &x) const = 0;
+            virtual void mul_local(
+                    const block &x, const block &y,
+                    scalar_type alpha, bool append
+                    ) const = 0;
+
+            virtual void mul_remote(
+                    const block &x, const block &y,
+                    scalar_type alpha
+                    ) const = 0;
+
+            virtual void update_values(const backend::device_vector<val_t> &val) const = 0;
+
+            virtual void setArgs(backend::kernel &kernel) const = 0;
+            virtual void setRemoteArgs(backend::kernel &kernel) const = 0;
+
+            // Reads nonzero entries of the partition back from the device.
+            // Local columns are offset by col_begin, ghost columns are
+            // looked up in ghost.
+            virtual void get_entries(col_t col_begin, const std::vector<col_t> &ghost,
+                    coo_entries &e) const = 0;
 #endif
 
             virtual ~sparse_matrix() {}
@@ -267,18 +1034,66 @@ class SpMat {
 #if defined(VEXCL_BACKEND_OPENCL) || !defined(VEXCL_USE_CUSPARSE)
 #  include <vexcl/spmat/hybrid_ell.inl>
 #  include <vexcl/spmat/csr.inl>
+
+        // Partitions that fit the compact device index types use them.
+        // Larger partitions keep the host index types.
+        typedef hell_matrix<dev_col_t, dev_idx_t> SpMatHELL;
+        typedef csr_matrix <dev_col_t, dev_idx_t> SpMatCSR;
+
+        typedef hell_matrix<col_t, idx_t> WideHELL;
+        typedef csr_matrix <col_t, idx_t> WideCSR;
 #else
+        static_assert(std::is_same<val_t, store_t>::value,
+                "Mixed precision matrices are not supported with CUSPARSE");
+
 #  include <vexcl/backend/cuda/hybrid_ell.inl>
 #  include <vexcl/backend/cuda/csr.inl>
+
+        typedef SpMatHELL WideHELL;
+        typedef SpMatCSR  WideCSR;
 #endif
 
+        template <class Matrix>
+        sparse_matrix* create_part(unsigned d,
+                const idx_t *row, const col_t *col, const val_t *val,
+                const std::set<col_t> &ghost_cols) const
+        {
+            return new Matrix(queue[d],
+                    row + part[d], row + part[d + 1], col, val,
+                    col_part[d], col_part[d + 1], ghost_cols, fmt[d]);
+        }
+
+        // Contiguous range of ghost values to be copied from its owner.
+        struct ghost_range {
+            unsigned src;
+            size_t   src_offset;
+            size_t   dst_offset;
+            size_t   size;
+        };
+
         struct exdata {
             std::vector<col_t> cols_to_recv;
             mutable std::vector<val_t> vals_to_recv;
 
+            // Used instead of the host buffers when devices share a context.
+            std::vector<ghost_range> recv;
+
             backend::device_vector<col_t> cols_to_send;
             backend::device_vector<val_t> vals_to_send;
             backend::device_vector<val_t> rx;
+
+            // Number of ghost values received by the device.
+            size_t nrecv;
+
+            // Exchange buffers for sparse matrix-multivector products,
+            // allocated on first use. Components are stored one after
+            // another.
+            mutable size_t blk_width;
+            mutable std::vector<val_t> blk_recv;
+            mutable backend::device_vector<val_t> blk_send;
+            mutable backend::device_vector<val_t> blk_rx;
+
+            exdata() : nrecv(0), blk_width(0) {}
         };
 
         const std::vector<backend::command_queue> queue;
@@ -288,8 +1103,26 @@ class SpMat {
         std::vector< std::unique_ptr<sparse_matrix> > mtx;
 
         std::vector<exdata> exc;
+        std::vector<spmat_format_choice> fmt;
+        std::vector<bool> wide;
         std::vector<size_t> cidx;
         mutable std::vector<val_t> rx;
+        mutable std::vector<val_t> rxb;
+        mutable std::vector< std::shared_ptr<ghost_buffers> > ghost_pool;
+        std::vector<size_t> vpart;
+        bool direct_exchange;
+
+        // Column partitioning and ghost columns of each device, kept for
+        // assembly of the transposed matrix.
+        std::vector<size_t> col_part;
+        std::vector< std::vector<col_t> > ghost;
+
+        mutable std::unique_ptr<SpMat> At;
+
+        std::vector<size_t> perm;
+        std::vector<size_t> vperm;
+        vex::vector<dev_col_t> fwd;
+        vex::vector<dev_col_t> bwd;
 
         size_t nrows;
         size_t ncols;
@@ -308,6 +1141,11 @@ class SpMat {
 
             if (queue.size() <= 1) return ghost_cols;
 
+            direct_exchange = true;
+            for(unsigned d = 1; d < queue.size(); d++)
+                if (!backend::is_same_context(queue[0], queue[d]))
+                    direct_exchange = false;
+
             // Build sets of ghost points.
 #ifdef _OPENMP
 #  pragma omp parallel for schedule(static,1)
@@ -339,6 +1177,7 @@ class SpMat {
 #endif
                 for(int d = 0; d < static_cast<int>(queue.size()); d++) {
                     if (size_t rcols = ghost_cols[d].size()) {
+                        exc[d].nrecv = rcols;
                         exc[d].cols_to_recv.resize(rcols);
                         exc[d].vals_to_recv.resize(rcols);
 
@@ -351,7 +1190,6 @@ class SpMat {
                     }
                 }
 
-                rx.resize(cols_to_send.size());
                 cidx.resize(queue.size() + 1);
 
                 {
@@ -377,32 +1215,399 @@ class SpMat {
                     }
                 }
 
+                if (direct_exchange) {
+                    // Ghost values coming from the same owner in
+                    // consecutive positions are copied in a single call.
+                    for(unsigned d = 0; d < queue.size(); d++) {
+                        const std::vector<col_t> &c = exc[d].cols_to_recv;
+
+                        for(size_t i = 0, j; i < c.size(); i = j) {
+                            unsigned s = static_cast<unsigned>(
+                                    std::upper_bound(cidx.begin(), cidx.end(),
+                                        static_cast<size_t>(c[i])) - cidx.begin() - 1);
+
+                            for(j = i + 1; j < c.size() && c[j] == c[j-1] + 1
+                                    && static_cast<size_t>(c[j]) < cidx[s + 1]; ++j);
+
+                            ghost_range r = {s, c[i] - cidx[s], i, j - i};
+                            exc[d].recv.push_back(r);
+                        }
+
+                        exc[d].cols_to_recv.clear();
+                        exc[d].vals_to_recv.clear();
+                    }
+                } else {
+                    rx.resize(cols_to_send.size());
+                }
+
                 for(unsigned d = 0; d < queue.size(); d++)
                     if (cidx[d + 1] > cidx[d]) queue[d].finish();
             }
 
             return ghost_cols;
         }
+
+#if defined(VEXCL_BACKEND_OPENCL) || !defined(VEXCL_USE_CUSPARSE)
+        template <typename T>
+        static void convert(const backend::command_queue&, size_t,
+                const backend::device_vector<T> &src, backend::device_vector<T> &dst)
+        {
+            dst = src;
+        }
+
+        template <typename S, typename T>
+        static void convert(const backend::command_queue &q, size_t n,
+                const backend::device_vector<S> &src, backend::device_vector<T> &dst)
+        {
+            dst = backend::device_vector<T>(q, n);
+            vex::vector<T>(q, dst) = vex::cast<T>(vex::vector<S>(q, src));
+        }
+
+        // Converts COO triplets to a single-device matrix with column
+        // numbers of type C and row pointers of type I.
+        template <typename C, typename I>
+        void assemble(
+                const vex::vector<col_t> &row,
+                const vex::vector<col_t> &col,
+                const vex::vector<val_t> &val
+                )
+        {
+            backend::device_vector<I>       ptr;
+            backend::device_vector<C>       c;
+            backend::device_vector<store_t> v;
+
+            vex::vector<val_t> uval;
+            nnz = detail::coo_to_csr(queue, nrows, ncols, row, col, val, ptr, c, uval);
+
+            if (nnz) convert(queue[0], nnz, uval(0), v);
+
+            fmt[0] = detail::select_spmat_format(queue[0], row_statistics(queue[0], nrows, ptr));
+
+            if (fmt[0].format == spmat_format::hell)
+                mtx[0].reset(new hell_matrix<C, I>(queue[0], nrows, nnz, ptr, c, v, fmt[0]));
+            else
+                mtx[0].reset(new csr_matrix<C, I>(queue[0], nrows, nnz, ptr, c, v, fmt[0]));
+        }
+
+        // Scatters new values of the nonzero entries into (at most four)
+        // parts of the matrix on a single device with a single kernel.
+        template <typename I>
+        static void scatter_values(const backend::command_queue &q,
+                const backend::device_vector<val_t> &src,
+                const std::vector< value_map<I> > &parts)
+        {
+            using namespace detail;
+
+            static const size_t max_parts = 4;
+
+            precondition(parts.size() <= max_parts, "Too many matrix parts");
+
+            if (parts.empty()) return;
+
+            static kernel_cache cache;
+
+            auto key    = backend::cache_key(q);
+            auto kernel = cache.find(key);
+
+            backend::select_context(q);
+
+            if (kernel == cache.end()) {
+                backend::source_generator source(q);
+
+                source.kernel("spmat_update_values")
+                    .open("(")
+                        .template parameter< size_t >("n")
+                        .template parameter< global_ptr<const val_t> >("src");
+
+                for(size_t k = 0; k < max_parts; ++k) {
+                    source.template parameter< size_t >("n") << k;
+                    source.template parameter< global_ptr<const I> >("map") << k;
+                    source.template parameter< global_ptr<store_t> >("val") << k;
+                }
+
+                source.close(")").open("{");
+                source.grid_stride_loop("i").open("{");
+                source.new_line() << "size_t j = i;";
+                for(size_t k = 0; k < max_parts; ++k) {
+                    source.new_line() << "if (j < n" << k << ")";
+                    source.open("{");
+                    source.new_line() << type_name<I>() << " p = map" << k << "[j];";
+                    source.new_line() << "val" << k << "[j] = p == (" << type_name<I>()
+                        << ")(-1) ? 0 : src[p];";
+                    source.new_line() << "continue;";
+                    source.close("}");
+                    source.new_line() << "j -= n" << k << ";";
+                }
+                source.close("}");
+                source.close("}");
+
+                backend::kernel krn(q, source.str(), "spmat_update_values");
+                kernel = cache.insert(std::make_pair(key, krn)).first;
+            }
+
+            size_t n = 0;
+            for(auto p = parts.begin(); p != parts.end(); ++p) n += p->size;
+
+            kernel->second.push_arg(n);
+            kernel->second.push_arg(src);
+
+            for(size_t k = 0; k < max_parts; ++k) {
+                if (k < parts.size()) {
+                    kernel->second.push_arg(parts[k].size);
+                    kernel->second.push_arg(parts[k].map);
+                    kernel->second.push_arg(parts[k].val);
+                } else {
+                    kernel->second.push_arg(static_cast<size_t>(0));
+                    kernel->second.push_arg(static_cast<void*>(0));
+                    kernel->second.push_arg(static_cast<void*>(0));
+                }
+            }
+
+            kernel->second(q);
+        }
+
+        void apply_block(
+                const std::vector<block> &x, const std::vector<block> &y,
+                size_t width, scalar_type alpha, bool append
+                ) const
+        {
+            std::vector<block> xc(queue.size()), yc(queue.size());
+
+            for(size_t k = 0; k < width; k += max_block_width) {
+                size_t w = std::min<size_t>(width - k, max_block_width);
+
+                for(unsigned d = 0; d < queue.size(); d++) {
+                    xc[d] = x[d].columns(k, k + w);
+                    yc[d] = y[d].columns(k, k + w);
+                }
+
+                apply_chunk(xc, yc, w, alpha, append);
+            }
+        }
+
+        void apply_chunk(
+                const std::vector<block> &x, const std::vector<block> &y,
+                size_t w, scalar_type alpha, bool append
+                ) const
+        {
+            // Ghost buffers of the receiving devices may still be read by the
+            // remote product of the previous chunk, so the exchange waits for
+            // the work submitted to their primary queues so far.
+            std::vector< std::vector<backend::event> > busy(queue.size());
+
+            if (!cidx.empty()) {
+                reserve_blocks(w);
+
+                // Gather values to send to neighbors.
+                for(unsigned d = 0; d < queue.size(); d++)
+                    if (cidx[d + 1] > cidx[d]) gather_block(d, x[d]);
+
+                for(unsigned d = 0; d < queue.size(); d++)
+                    if (cidx[d + 1] > cidx[d]) queue[d].finish();
+
+                for(unsigned d = 0; d < queue.size(); d++)
+                    if (exc[d].nrecv)
+                        busy[d].push_back(backend::enqueue_marker(queue[d]));
+            }
+
+            // Start computing contribution from local part of the matrix.
+            for(unsigned d = 0; d < queue.size(); d++)
+                if (mtx[d]) {
+                    backend::select_context(queue[d]);
+                    mtx[d]->mul_local(x[d], y[d], alpha, append);
+                }
+
+            if (cidx.empty()) return;
+
+            for(unsigned d = 0; d < queue.size(); d++)
+                if (exc[d].nrecv) backend::enqueue_wait(squeue[d], busy[d]);
+
+            if (direct_exchange) {
+                // Meanwhile, copy ghost values directly from their owners.
+                for(unsigned d = 0; d < queue.size(); d++) {
+                    if (exc[d].recv.empty()) continue;
+
+                    backend::select_context(squeue[d]);
+                    for(auto c = exc[d].recv.begin(); c != exc[d].recv.end(); ++c) {
+                        size_t ns = cidx[c->src + 1] - cidx[c->src];
+
+                        for(size_t k = 0; k < w; k++)
+                            exc[d].blk_rx.copy_from(squeue[d], exc[c->src].blk_send,
+                                    k * ns + c->src_offset,
+                                    k * exc[d].nrecv + c->dst_offset, c->size);
+                    }
+                }
+            } else {
+                // Meanwhile, get gathered values to host, ...
+                rxb.resize(w * cidx.back());
+
+                for(unsigned d = 0; d < queue.size(); d++) {
+                    if (size_t ns = cidx[d + 1] - cidx[d]) {
+                        backend::select_context(squeue[d]);
+                        exc[d].blk_send.read(squeue[d], 0, w * ns, &rxb[w * cidx[d]]);
+                    }
+                }
+
+                for(unsigned d = 0; d < queue.size(); d++)
+                    if (cidx[d + 1] > cidx[d]) squeue[d].finish();
+
+                // ... and send ghost points from our neighbors to device.
+                for(unsigned d = 0; d < queue.size(); d++) {
+                    const std::vector<col_t> &c = exc[d].cols_to_recv;
+                    if (c.empty()) continue;
+
+                    size_t nr = c.size();
+                    exc[d].blk_recv.resize(w * nr);
+
+                    for(size_t i = 0; i < nr; i++) {
+                        size_t s = std::upper_bound(cidx.begin(), cidx.end(),
+                                static_cast<size_t>(c[i])) - cidx.begin() - 1;
+                        size_t ns  = cidx[s + 1] - cidx[s];
+                        size_t src = w * cidx[s] + c[i] - cidx[s];
+
+                        for(size_t k = 0; k < w; k++)
+                            exc[d].blk_recv[k * nr + i] = rxb[src + k * ns];
+                    }
+
+                    exc[d].blk_rx.write(squeue[d], 0, w * nr, exc[d].blk_recv.data());
+                }
+            }
+
+            for(unsigned d = 0; d < queue.size(); d++)
+                if (exc[d].nrecv) squeue[d].finish();
+
+            // Compute contribution from remote part of the matrix.
+            for(unsigned d = 0; d < queue.size(); d++) {
+                if (!exc[d].nrecv) continue;
+
+                block rx;
+                for(size_t k = 0; k < w; k++)
+                    rx.push_back(&exc[d].blk_rx, k * exc[d].nrecv);
+
+                backend::select_context(queue[d]);
+                mtx[d]->mul_remote(rx, y[d], alpha);
+            }
+        }
+
+        void reserve_blocks(size_t w) const {
+            for(unsigned d = 0; d < queue.size(); d++) {
+                if (exc[d].blk_width >= w) continue;
+
+                if (size_t ns = cidx[d + 1] - cidx[d])
+                    exc[d].blk_send = backend::device_vector<val_t>(queue[d], w * ns);
+
+                if (exc[d].nrecv)
+                    exc[d].blk_rx = backend::device_vector<val_t>(queue[d],
+                            w * exc[d].nrecv, static_cast<const val_t*>(0),
+                            backend::MEM_READ_ONLY);
+
+                exc[d].blk_width = w;
+            }
+        }
+
+        void gather_block(unsigned d, const block &x) const {
+            using namespace detail;
+
+            static kernel_cache cache[max_block_width];
+
+            const size_t w = x.width();
+            const backend::command_queue &q = queue[d];
+
+            auto key    = backend::cache_key(q);
+            auto kernel = cache[w - 1].find(key);
+
+            backend::select_context(q);
+
+            if (kernel == cache[w - 1].end()) {
+                backend::source_generator src(q);
+
+                src.kernel("spmm_gather")
+                    .open("(")
+                        .template parameter< size_t >("n")
+                        .template parameter< size_t >("stride")
+                        .template parameter< global_ptr<const col_t> >("cols")
+                        .template parameter< global_ptr<val_t> >("vals");
+
+                for(size_t k = 0; k < w; k++) {
+                    src.template parameter< global_ptr<const val_t> >("x") << k;
+                    src.template parameter< size_t >("x_off") << k;
+                }
+
+                src.close(")").open("{");
+                src.grid_stride_loop("i").open("{");
+                src.new_line() << "size_t p = cols[i] * stride;";
+                for(size_t k = 0; k < w; k++)
+                    src.new_line() << "vals[" << k << " * n + i] = x" << k
+                        << "[x_off" << k << " + p];";
+                src.close("}");
+                src.close("}");
+
+                backend::kernel krn(q, src.str(), "spmm_gather");
+                kernel = cache[w - 1].insert(std::make_pair(key, krn)).first;
+            }
+
+            kernel->second.push_arg(cidx[d + 1] - cidx[d]);
+            kernel->second.push_arg(x.stride);
+            kernel->second.push_arg(exc[d].cols_to_send);
+            kernel->second.push_arg(exc[d].blk_send);
+            for(size_t k = 0; k < w; k++) {
+                kernel->second.push_arg(*x.col[k]);
+                kernel->second.push_arg(x.off[k]);
+            }
+
+            kernel->second(q);
+        }
+#endif
 };
 
 /// \cond INTERNAL
 
-template <typename val_t, typename col_t, typename idx_t>
-additive_operator< SpMat<val_t, col_t, idx_t >, vector<val_t> >
-operator*(const SpMat<val_t, col_t, idx_t> &A, const vector<val_t> &x)
+template <typename val_t, typename col_t, typename idx_t, typename store_t>
+additive_operator< SpMat<val_t, col_t, idx_t, store_t>, vector<val_t> >
+operator*(const SpMat<val_t, col_t, idx_t, store_t> &A, const vector<val_t> &x)
 {
-    return additive_operator< SpMat<val_t, col_t, idx_t >, vector<val_t> >(A, x);
+    return additive_operator< SpMat<val_t, col_t, idx_t, store_t>, vector<val_t> >(A, x);
 }
 
+// Use SpMat::apply() with dynamic multivectors.
+template <typename val_t, typename col_t, typename idx_t, typename store_t>
+void operator*(const SpMat<val_t, col_t, idx_t, store_t>&, const dynamic_multivector<val_t>&) = delete;
+
 #ifdef VEXCL_MULTIVECTOR_HPP
-template <typename val_t, typename col_t, typename idx_t, class V>
+#if defined(VEXCL_BACKEND_OPENCL) || !defined(VEXCL_USE_CUSPARSE)
+// Multivector products are computed by a single sparse matrix-multivector
+// kernel instead of component by component.
+template <typename val_t, typename col_t, typename idx_t, typename store_t, class V>
+struct multiadditive_operator< SpMat<val_t, col_t, idx_t, store_t>, V >
+    : multivector_expression<
+        boost::proto::terminal< additive_multivector_transform >::type
+        >
+{
+    typedef typename V::sub_value_type value_type;
+
+    const SpMat<val_t, col_t, idx_t, store_t> &A;
+    const V &x;
+
+    typename cl_scalar_of<value_type>::type scale;
+
+    multiadditive_operator(const SpMat<val_t, col_t, idx_t, store_t> &A, const V &x)
+        : A(A), x(x), scale(1) {}
+
+    template <bool negate, bool append>
+    void apply(V &y) const {
+        A.apply(x, y, negate ? -scale : scale, append);
+    }
+};
+#endif
+
+template <typename val_t, typename col_t, typename idx_t, typename store_t, class V>
 typename std::enable_if<
     std::is_base_of<multivector_terminal_expression, V>::value &&
     std::is_same<val_t, typename V::sub_value_type>::value,
-    multiadditive_operator< SpMat<val_t, col_t, idx_t>, V >
+    multiadditive_operator< SpMat<val_t, col_t, idx_t, store_t>, V >
 >::type
-operator*(const SpMat<val_t, col_t, idx_t> &A, const V &x) {
-    return multiadditive_operator< SpMat<val_t, col_t, idx_t>, V >(A, x);
+operator*(const SpMat<val_t, col_t, idx_t, store_t> &A, const V &x) {
+    return multiadditive_operator< SpMat<val_t, col_t, idx_t, store_t>, V >(A, x);
 }
 #endif
 
@@ -497,6 +1702,10 @@ inline double device_spmv_perf(const backend::command_queue &q) {
 } // namespace vex
 
 #include <vexcl/spmat/ccsr.hpp>
+#include <vexcl/spmat/bsr.hpp>
+#include <vexcl/spmat/spgemm.hpp>
+#include <vexcl/spmat/triangular.hpp>
 #include <vexcl/spmat/inline_spmv.hpp>
+#include <vexcl/spmat/polynomial.hpp>
 
 #endif
@@ -0,0 +1,334 @@
+#ifndef VEXCL_SPMAT_BSR_HPP
+#define VEXCL_SPMAT_BSR_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2026 Denis Demidov <ddemidov@ksu.ru>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/spmat/bsr.hpp
+ * \author Denis Demidov <ddemidov@ksu.ru>
+ * \brief  Sparse matrix in block CSR format.
+ */
+
+#include <array>
+
+namespace vex {
+
+/// Sparse matrix in block CSR (BSR) format.
+/**
+ * The matrix consists of dense B x B blocks. ptr and col arrays describe
+ * the block sparsity pattern in CSR format, so that a single column number
+ * is stored per block. val array contains B * B values of each block in
+ * row-major order. Matrix-vector multiplication is done as follows:
+ * \code
+ * for(size_t i = 0; i < nb; ++i)
+ *     for(size_t j = ptr[i]; j < ptr[i + 1]; ++j)
+ *         for(size_t r = 0; r < B; ++r)
+ *             for(size_t k = 0; k < B; ++k)
+ *                 y[i * B + r] += val[j * B * B + r * B + k] * x[col[j] * B + k];
+ * \endcode
+ * The block size is known at compile time, and the product kernel keeps the
+ * B components of a block row in registers.
+ *
+ * The vectors may be either interleaved (a vex::vector with B components of
+ * each block row stored together) or a vex::multivector<val_t, B>. This
+ * format does not support multi-device computation, so it accepts single
+ * queue at initialization. Vectors should also be single-queued and reside
+ * on the same device with matrix.
+ */
+template <typename val_t, size_t B, typename col_t = size_t, typename idx_t = size_t>
+class SpMatBSR {
+    static_assert(B > 0, "Block size should be positive");
+
+    public:
+        typedef val_t value_type;
+        typedef typename cl_scalar_of<val_t>::type scalar_type;
+
+        /// Block size.
+        static const size_t block_size = B;
+
+        /// Empty constructor.
+        SpMatBSR() : nb(0), mb(0), nnzb(0) {}
+
+        /// Constructor for BSR format.
+        /**
+         * \param queue single queue.
+         * \param nb    number of block rows in the matrix.
+         * \param mb    number of block columns in the matrix.
+         * \param ptr   block row index into col and val vectors.
+         * \param col   block column numbers of nonzero blocks.
+         * \param val   values of nonzero blocks (B * B per block, row-major).
+         */
+        SpMatBSR(const backend::command_queue &queue, size_t nb, size_t mb,
+                const idx_t *ptr, const col_t *col, const val_t *val
+                )
+            : queue(queue), nb(nb), mb(mb), nnzb(ptr[nb])
+        {
+            if (!nb) return;
+
+            this->ptr = backend::device_vector<idx_t>(queue, nb + 1, ptr,
+                    backend::MEM_READ_ONLY);
+
+            if (nnzb) {
+                this->col = backend::device_vector<col_t>(queue, nnzb, col,
+                        backend::MEM_READ_ONLY);
+                this->val = backend::device_vector<val_t>(queue, nnzb * B * B, val,
+                        backend::MEM_READ_ONLY);
+            }
+        }
+
+        /// Matrix-vector multiplication with interleaved vectors.
+        /**
+         * Computes \f$y = \alpha Ax\f$ or \f$y += \alpha Ax\f$. Component
+         * k of i-th block row is stored at position i * B + k.
+         */
+        void apply(const vex::vector<val_t> &x, vex::vector<val_t> &y,
+                scalar_type alpha = 1, bool append = false) const
+        {
+            precondition(x.nparts() == 1 && y.nparts() == 1,
+                    "BSR format does not support multi-device computation");
+
+            precondition(x.size() == mb * B && y.size() == nb * B,
+                    "Incompatible vector sizes");
+
+            std::array<const backend::device_vector<val_t>*, B> xp, yp;
+            std::array<size_t, B> xo, yo;
+
+            for(size_t k = 0; k < B; ++k) {
+                xp[k] = &x(0); xo[k] = k;
+                yp[k] = &y(0); yo[k] = k;
+            }
+
+            spmv(xp, xo, B, yp, yo, B, alpha, append);
+        }
+
+        /// Matrix-vector multiplication with B-component multivectors.
+        /**
+         * Component k of i-th block row is stored as i-th element of k-th
+         * component of the multivector.
+         */
+        void apply(const multivector<val_t, B> &x, multivector<val_t, B> &y,
+                scalar_type alpha = 1, bool append = false) const
+        {
+            std::array<const backend::device_vector<val_t>*, B> xp, yp;
+            std::array<size_t, B> xo, yo;
+
+            for(size_t k = 0; k < B; ++k) {
+                precondition(x(k).nparts() == 1 && y(k).nparts() == 1,
+                        "BSR format does not support multi-device computation");
+
+                precondition(x(k).size() == mb && y(k).size() == nb,
+                        "Incompatible vector sizes");
+
+                xp[k] = &x(k)(0); xo[k] = 0;
+                yp[k] = &y(k)(0); yo[k] = 0;
+            }
+
+            spmv(xp, xo, 1, yp, yo, 1, alpha, append);
+        }
+
+        /// Number of rows.
+        size_t rows() const { return nb * B; }
+        /// Number of columns.
+        size_t cols() const { return mb * B; }
+        /// Number of non-zero entries.
+        size_t nonzeros() const { return nnzb * B * B; }
+        /// Number of non-zero blocks.
+        size_t nonzero_blocks() const { return nnzb; }
+    private:
+        backend::command_queue queue;
+
+        size_t nb, mb, nnzb;
+
+        backend::device_vector<idx_t> ptr;
+        backend::device_vector<col_t> col;
+        backend::device_vector<val_t> val;
+
+        void spmv(
+                const std::array<const backend::device_vector<val_t>*, B> &x,
+                const std::array<size_t, B> &x_off, size_t x_stride,
+                const std::array<const backend::device_vector<val_t>*, B> &y,
+                const std::array<size_t, B> &y_off, size_t y_stride,
+                scalar_type alpha, bool append
+                ) const
+        {
+            if (!nb) return;
+
+            if (append)
+                mul<assign::ADD>(x, x_off, x_stride, y, y_off, y_stride, alpha);
+            else
+                mul<assign::SET>(x, x_off, x_stride, y, y_off, y_stride, alpha);
+        }
+
+        template <class OP>
+        void mul(
+                const std::array<const backend::device_vector<val_t>*, B> &x,
+                const std::array<size_t, B> &x_off, size_t x_stride,
+                const std::array<const backend::device_vector<val_t>*, B> &y,
+                const std::array<size_t, B> &y_off, size_t y_stride,
+                scalar_type alpha
+                ) const
+        {
+            using namespace detail;
+
+            static kernel_cache cache;
+
+            auto key    = backend::cache_key(queue);
+            auto kernel = cache.find(key);
+
+            backend::select_context(queue);
+
+            if (kernel == cache.end()) {
+                backend::source_generator source(queue);
+
+                source.kernel("bsr_spmv")
+                    .open("(")
+                        .template parameter<size_t>("n")
+                        .template parameter<scalar_type>("scale")
+                        .template parameter< global_ptr<const idx_t> >("ptr")
+                        .template parameter< global_ptr<const col_t> >("col")
+                        .template parameter< global_ptr<const val_t> >("val")
+                        .template parameter<size_t>("in_stride")
+                        .template parameter<size_t>("out_stride");
+
+                for(size_t k = 0; k < B; ++k) {
+                    source.template parameter< global_ptr<const val_t> >("in") << k;
+                    source.template parameter<size_t>("in_off") << k;
+                }
+
+                for(size_t k = 0; k < B; ++k) {
+                    source.template parameter< global_ptr<val_t> >("out") << k;
+                    source.template parameter<size_t>("out_off") << k;
+                }
+
+                source.close(")").open("{").grid_stride_loop("i").open("{");
+
+                for(size_t r = 0; r < B; ++r)
+                    source.new_line() << type_name<val_t>() << " sum" << r << " = 0;";
+
+                source.new_line() << "for(size_t j = ptr[i], e = ptr[i + 1]; j < e; ++j)";
+                source.open("{");
+                source.new_line() << "size_t c = col[j] * in_stride;";
+                source.new_line() << "size_t v = j * " << B * B << ";";
+
+                for(size_t k = 0; k < B; ++k)
+                    source.new_line() << type_name<val_t>() << " x" << k
+                        << " = in" << k << "[in_off" << k << " + c];";
+
+                for(size_t r = 0; r < B; ++r) {
+                    source.new_line() << "sum" << r << " +=";
+                    for(size_t k = 0; k < B; ++k)
+                        source << (k ? " + " : " ")
+                            << "val[v + " << r * B + k << "] * x" << k;
+                    source << ";";
+                }
+
+                source.close("}");
+
+                for(size_t r = 0; r < B; ++r)
+                    source.new_line() << "out" << r << "[out_off" << r << " + i * out_stride] "
+                        << OP::string() << " scale * sum" << r << ";";
+
+                source.close("}").close("}");
+
+                backend::kernel krn(queue, source.str(), "bsr_spmv");
+                kernel = cache.insert(std::make_pair(key, krn)).first;
+            }
+
+            kernel->second.push_arg(nb);
+            kernel->second.push_arg(alpha);
+            kernel->second.push_arg(ptr);
+
+            if (nnzb) {
+                kernel->second.push_arg(col);
+                kernel->second.push_arg(val);
+            } else {
+                kernel->second.push_arg(static_cast<void*>(0));
+                kernel->second.push_arg(static_cast<void*>(0));
+            }
+
+            kernel->second.push_arg(x_stride);
+            kernel->second.push_arg(y_stride);
+
+            for(size_t k = 0; k < B; ++k) {
+                kernel->second.push_arg(*x[k]);
+                kernel->second.push_arg(x_off[k]);
+            }
+
+            for(size_t k = 0; k < B; ++k) {
+                kernel->second.push_arg(*y[k]);
+                kernel->second.push_arg(y_off[k]);
+            }
+
+            kernel->second(queue);
+        }
+};
+
+/// \cond INTERNAL
+
+template <typename val_t, size_t B, typename col_t, typename idx_t>
+additive_operator< SpMatBSR<val_t, B, col_t, idx_t>, vector<val_t> >
+operator*(const SpMatBSR<val_t, B, col_t, idx_t> &A, const vector<val_t> &x)
+{
+    return additive_operator< SpMatBSR<val_t, B, col_t, idx_t>, vector<val_t> >(A, x);
+}
+
+#ifdef VEXCL_MULTIVECTOR_HPP
+// All B components are multiplied by a single kernel.
+template <typename val_t, size_t B, typename col_t, typename idx_t>
+struct multiadditive_operator< SpMatBSR<val_t, B, col_t, idx_t>, multivector<val_t, B> >
+    : multivector_expression<
+        boost::proto::terminal< additive_multivector_transform >::type
+        >
+{
+    typedef val_t value_type;
+
+    const SpMatBSR<val_t, B, col_t, idx_t> &A;
+    const multivector<val_t, B> &x;
+
+    typename cl_scalar_of<value_type>::type scale;
+
+    multiadditive_operator(const SpMatBSR<val_t, B, col_t, idx_t> &A,
+            const multivector<val_t, B> &x) : A(A), x(x), scale(1) {}
+
+    template <bool negate, bool append>
+    void apply(multivector<val_t, B> &y) const {
+        A.apply(x, y, negate ? -scale : scale, append);
+    }
+};
+
+template <typename val_t, size_t B, typename col_t, typename idx_t>
+multiadditive_operator< SpMatBSR<val_t, B, col_t, idx_t>, multivector<val_t, B> >
+operator*(const SpMatBSR<val_t, B, col_t, idx_t> &A, const multivector<val_t, B> &x)
+{
+    return multiadditive_operator<
+        SpMatBSR<val_t, B, col_t, idx_t>, multivector<val_t, B> >(A, x);
+}
+#endif
+
+/// \endcond
+
+} // namespace vex
+
+#endif
@@ -31,6 +31,11 @@ THE SOFTWARE.
  * \brief  Sparse matrix in Compressed CSR format.
  */
 
+#include <map>
+#include <string>
+#include <typeinfo>
+#include <boost/any.hpp>
+
 namespace vex {
 
 /// Sparse matrix in CCSR format.
@@ -47,9 +52,13 @@ namespace vex {
  *     y[i] = sum;
  * }
  * \endcode
- * This format does not support multi-device computation, so it accepts single
- * queue at initialization. Vectors x and y should also be single-queued and
- * reside on the same device with matrix.
+ * When several queues are given at initialization, rows of the matrix are
+ * partitioned across devices in the same way as vex::vector elements are.
+ * Unique rows are replicated on each device, and the halo width of each
+ * partition is found from the extreme column offsets of its rows. Halo
+ * values of x are exchanged between devices when a product term A * x is
+ * formed, so that vectors x and y should be partitioned across the same
+ * queues as the matrix.
  */
 template <typename val_t, typename col_t = ptrdiff_t, typename idx_t = size_t>
 struct SpMatCCSR {
@@ -70,19 +79,238 @@ struct SpMatCCSR {
     SpMatCCSR(const backend::command_queue &queue, size_t n, size_t m,
             const idx_t *idx, const idx_t *row, const col_t *col, const val_t *val
             )
-        : queue(queue), n(n),
-          idx(queue, n,      idx, backend::MEM_READ_ONLY),
-          row(queue, (m+1),  row, backend::MEM_READ_ONLY),
-          col(queue, row[m], col, backend::MEM_READ_ONLY),
-          val(queue, row[m], val, backend::MEM_READ_ONLY)
-    { }
-
-    backend::command_queue queue;
+        : queue(1, queue), part(2), n(n)
+    {
+        part[1] = n;
+        init(m, idx, row, col, val);
+    }
+
+    /// Constructor for multi-device CCSR format.
+    /**
+     * Constructs GPU representation of the CCSR matrix partitioned across
+     * the given queues.
+     * \param queue vector of queues. Each queue represents one device.
+     * \param n     number of rows in the matrix.
+     * \param m     number of unique rows in the matrix.
+     * \param idx   index into row vector.
+     * \param row   row index into col and val vectors.
+     * \param col   column positions of nonzero elements wrt to diagonal.
+     * \param val   values of nonzero elements of the matrix.
+     */
+    SpMatCCSR(const std::vector<backend::command_queue> &queue,
+            size_t n, size_t m,
+            const idx_t *idx, const idx_t *row, const col_t *col, const val_t *val
+            )
+        : queue(queue), part(vex::partition(n, queue)), n(n)
+    {
+        init(m, idx, row, col, val);
+    }
+
+    /// Returns halo buffers for a product of the matrix.
+    /**
+     * The buffer for device d holds lhalo[d] elements preceding its partition
+     * of x followed by rhalo[d] elements following the partition. Returns
+     * empty pointer for single-device matrices. The buffers are owned by the
+     * matrix and are reused once the returned pointer is released.
+     */
+    template <typename T>
+    std::shared_ptr< std::vector< backend::device_vector<T> > >
+    reserve_halos() const {
+        if (queue.size() <= 1)
+            return std::shared_ptr< std::vector< backend::device_vector<T> > >();
+
+        return free_halo<T>();
+    }
+
+    /// Exchanges halo values of x between devices.
+    /**
+     * The values are copied into the buffers returned by reserve_halos().
+     */
+    template <typename T>
+    void exchange_halos(const vex::vector<T> &x,
+            const std::vector< backend::device_vector<T> > &halo) const
+    {
+        precondition(x.partition() == part,
+                "Vector partitioning is incompatible with CCSR matrix");
+
+        std::vector<size_t> offset(queue.size() + 1, 0);
+        for(unsigned d = 0; d < queue.size(); d++)
+            offset[d + 1] = offset[d] + lhalo[d] + rhalo[d];
+
+        if (!offset.back()) return;
+
+        if (direct) {
+            // Make sure halo values of x are ready on their owners.
+            std::vector<bool> owner(queue.size(), false);
+            for(unsigned d = 0; d < queue.size(); d++) {
+                if (lhalo[d]) mark_owners(owner, part[d] - lhalo[d], part[d]);
+                if (rhalo[d]) mark_owners(owner, part[d + 1], part[d + 1] + rhalo[d]);
+            }
+
+            for(unsigned p = 0; p < queue.size(); p++)
+                if (owner[p]) x.queue_list()[p].finish();
+
+            for(unsigned d = 0; d < queue.size(); d++) {
+                if (lhalo[d])
+                    copy_halo(x, halo[d], d, part[d] - lhalo[d], part[d], 0);
+
+                if (rhalo[d])
+                    copy_halo(x, halo[d], d, part[d + 1], part[d + 1] + rhalo[d], lhalo[d]);
+            }
+
+            return;
+        }
+
+        // Get halos from neighbours through the host.
+        std::vector<T> hbuf(offset.back());
+
+        for(unsigned d = 0; d < queue.size(); d++) {
+            if (lhalo[d])
+                x.read_data(part[d] - lhalo[d], lhalo[d], &hbuf[offset[d]], false);
+
+            if (rhalo[d])
+                x.read_data(part[d + 1], rhalo[d], &hbuf[offset[d] + lhalo[d]], false);
+        }
+
+        for(unsigned d = 0; d < queue.size(); d++) x.queue_list()[d].finish();
+
+        for(unsigned d = 0; d < queue.size(); d++)
+            if (size_t width = offset[d + 1] - offset[d])
+                halo[d].write(queue[d], 0, width, &hbuf[offset[d]]);
+
+        // hbuf goes out of scope, so wait for the end of transfer.
+        for(unsigned d = 0; d < queue.size(); d++)
+            if (offset[d + 1] > offset[d]) queue[d].finish();
+    }
+
+    // First device with a nonempty partition of the matrix.
+    unsigned first_part() const {
+        unsigned d = 0;
+        while(d + 1 < queue.size() && part[d + 1] == part[d]) ++d;
+        return d;
+    }
+
+    std::vector<backend::command_queue> queue;
+    std::vector<size_t> part;
     size_t n;
-    backend::device_vector<idx_t> idx;
-    backend::device_vector<idx_t> row;
-    backend::device_vector<col_t> col;
-    backend::device_vector<val_t> val;
+
+    // Number of x elements preceding/following each partition that are
+    // referenced by its rows.
+    std::vector<size_t> lhalo;
+    std::vector<size_t> rhalo;
+
+    // Halos are copied directly between devices sharing a context.
+    bool direct;
+
+    std::vector< backend::device_vector<idx_t> > idx;
+    std::vector< backend::device_vector<idx_t> > row;
+    std::vector< backend::device_vector<col_t> > col;
+    std::vector< backend::device_vector<val_t> > val;
+
+    private:
+        // Halo buffers for each value type of x, allocated on first use.
+        // A set of buffers is free when no product holds it.
+        mutable std::map<std::string, boost::any> halo_pool;
+
+        template <typename T>
+        std::shared_ptr< std::vector< backend::device_vector<T> > >
+        free_halo() const {
+            typedef std::vector< backend::device_vector<T> > halo_buffers;
+            typedef std::vector< std::shared_ptr<halo_buffers> > pool_type;
+
+            boost::any &p = halo_pool[typeid(T).name()];
+            if (p.empty()) p = pool_type();
+
+            pool_type &pool = boost::any_cast<pool_type&>(p);
+
+            for(auto h = pool.begin(); h != pool.end(); ++h)
+                if (h->use_count() == 1) return *h;
+
+            auto halo = std::make_shared<halo_buffers>(queue.size());
+
+            for(unsigned d = 0; d < queue.size(); d++)
+                if (size_t width = lhalo[d] + rhalo[d])
+                    (*halo)[d] = backend::device_vector<T>(queue[d], width);
+
+            pool.push_back(halo);
+            return halo;
+        }
+
+        // Marks devices owning elements of x in [begin, end).
+        void mark_owners(std::vector<bool> &owner, size_t begin, size_t end) const {
+            for(unsigned p = 0; p < queue.size(); p++)
+                if (begin < part[p + 1] && part[p] < end) owner[p] = true;
+        }
+
+        void init(size_t m,
+                const idx_t *idx, const idx_t *row, const col_t *col, const val_t *val)
+        {
+            const unsigned ndev = static_cast<unsigned>(queue.size());
+
+            lhalo.resize(ndev, 0);
+            rhalo.resize(ndev, 0);
+
+            this->idx.resize(ndev);
+            this->row.resize(ndev);
+            this->col.resize(ndev);
+            this->val.resize(ndev);
+
+            direct = ndev > 1;
+            for(unsigned d = 1; d < ndev; d++)
+                if (!backend::is_same_context(queue[0], queue[d])) direct = false;
+
+            // Extreme column offsets of unique rows.
+            std::vector<ptrdiff_t> cmin(m, 0), cmax(m, 0);
+            for(size_t u = 0; u < m; u++) {
+                for(size_t j = row[u]; j < static_cast<size_t>(row[u + 1]); j++) {
+                    cmin[u] = std::min<ptrdiff_t>(cmin[u], col[j]);
+                    cmax[u] = std::max<ptrdiff_t>(cmax[u], col[j]);
+                }
+            }
+
+            for(unsigned d = 0; d < ndev; d++) {
+                size_t beg = part[d];
+                size_t end = part[d + 1];
+
+                if (beg == end) continue;
+
+                ptrdiff_t lo = beg, hi = end - 1;
+                for(size_t i = beg; i < end; i++) {
+                    lo = std::min<ptrdiff_t>(lo, i + cmin[idx[i]]);
+                    hi = std::max<ptrdiff_t>(hi, i + cmax[idx[i]]);
+                }
+
+                lhalo[d] = beg - std::max<ptrdiff_t>(lo, 0);
+                rhalo[d] = std::min<ptrdiff_t>(hi + 1, n) - end;
+
+                this->idx[d] = backend::device_vector<idx_t>(
+                        queue[d], end - beg, idx + beg, backend::MEM_READ_ONLY);
+                this->row[d] = backend::device_vector<idx_t>(
+                        queue[d], m + 1, row, backend::MEM_READ_ONLY);
+
+                if (row[m]) {
+                    this->col[d] = backend::device_vector<col_t>(
+                            queue[d], row[m], col, backend::MEM_READ_ONLY);
+                    this->val[d] = backend::device_vector<val_t>(
+                            queue[d], row[m], val, backend::MEM_READ_ONLY);
+                }
+            }
+        }
+
+        // Copies x[begin, end) into halo buffer of device d starting at pos.
+        template <typename T>
+        void copy_halo(const vex::vector<T> &x, const backend::device_vector<T> &halo,
+                unsigned d, size_t begin, size_t end, size_t pos) const
+        {
+            // The range may span several devices.
+            for(unsigned p = 0; p < queue.size() && begin < end; p++) {
+                size_t b = std::max(begin, part[p]);
+                size_t e = std::min(end,   part[p + 1]);
+
+                if (b < e)
+                    halo.copy_from(queue[d], x(p), b - part[p], pos + b - begin, e - b);
+            }
+        }
 };
 
 /// \cond INTERNAL
@@ -101,7 +329,12 @@ struct ccsr_product : public ccsr_product_terminal_expression
     const matrix    &A;
     const vector<T> &x;
 
-    ccsr_product(const matrix &A, const vector<T> &x) : A(A), x(x) {}
+    // Halo buffers of x on each device (multi-device matrices only). The
+    // values are exchanged each time the product is evaluated.
+    std::shared_ptr< std::vector< backend::device_vector<T> > > halo;
+
+    ccsr_product(const matrix &A, const vector<T> &x)
+        : A(A), x(x), halo(A.template reserve_halos<T>()) {}
 };
 
 template <typename val_t, typename col_t, typename idx_t, typename T>
@@ -124,11 +357,22 @@ template <typename val_t, typename col_t, typename idx_t, class MV>
 struct mv_ccsr_product : public mv_ccsr_product_terminal_expression
 {
     typedef SpMatCCSR<val_t, col_t, idx_t> matrix;
+    typedef ccsr_product<val_t, col_t, idx_t, typename MV::sub_value_type> component;
 
     const matrix &A;
     const MV     &x;
 
-    mv_ccsr_product(const matrix &A, const MV &x) : A(A), x(x) {}
+    // Products of the matrix with each component of x. These are formed
+    // here, so that each component keeps its halo buffers for the lifetime
+    // of the expression.
+    std::vector<component> comp;
+
+    mv_ccsr_product(const matrix &A, const MV &x) : A(A), x(x) {
+        const size_t N = traits::number_of_components<MV>::value;
+
+        comp.reserve(N);
+        for(size_t i = 0; i < N; i++) comp.push_back(component(A, x(i)));
+    }
 };
 
 template <typename val_t, typename col_t, typename idx_t, class MV>
@@ -189,13 +433,18 @@ struct terminal_preamble< ccsr_product<val_t, col_t, idx_t, T> > {
                 .template parameter< global_ptr<const col_t> >("col")
                 .template parameter< global_ptr<const val_t> >("val")
                 .template parameter< global_ptr<const T>     >("vec")
+                .template parameter< global_ptr<const T>     >("halo")
+                .template parameter< ptrdiff_t >("n")
+                .template parameter< ptrdiff_t >("lhalo")
                 .template parameter< size_t >("i")
             .close(")").open("{");
 
         src.new_line() << type_name<res_t>() << " sum = 0;";
         src.new_line() << "for(size_t pos = idx[i], j = row[pos], end = row[pos+1]; j < end; ++j)";
         src.open("{");
-        src.new_line() << "sum += val[j] * vec[i + col[j]];";
+        src.new_line() << type_name<ptrdiff_t>() << " c = i + col[j];";
+        src.new_line() << "sum += val[j] * (c < 0 ? halo[lhalo + c] : "
+                          "(c < n ? vec[c] : halo[lhalo + c - n]));";
         src.close("}");
         src.new_line() << "return sum;";
         src.close("}");
@@ -214,6 +463,9 @@ struct kernel_param_declaration< ccsr_product<val_t, col_t, idx_t, T> > {
         src.template parameter< global_ptr<const col_t> >(prm_name) << "_col";
         src.template parameter< global_ptr<const val_t> >(prm_name) << "_val";
         src.template parameter< global_ptr<const T    > >(prm_name) << "_vec";
+        src.template parameter< global_ptr<const T    > >(prm_name) << "_halo";
+        src.template parameter< ptrdiff_t >(prm_name) << "_n";
+        src.template parameter< ptrdiff_t >(prm_name) << "_lhalo";
     }
 };
 
@@ -229,7 +481,10 @@ struct partial_vector_expr< ccsr_product<val_t, col_t, idx_t, T> > {
             << prm_name << "_row, "
             << prm_name << "_col, "
             << prm_name << "_val, "
-            << prm_name << "_vec, idx)";
+            << prm_name << "_vec, "
+            << prm_name << "_halo, "
+            << prm_name << "_n, "
+            << prm_name << "_lhalo, idx)";
     }
 };
 
@@ -239,13 +494,27 @@ struct kernel_arg_setter< ccsr_product<val_t, col_t, idx_t, T> > {
             backend::kernel &kernel, unsigned part, size_t/*index_offset*/,
             detail::kernel_generator_state_ptr)
     {
-        assert(part == 0);
+        const auto &A = term.A;
+
+        // Halos are exchanged right before the first device gets its
+        // arguments, so that they are up to date with x.
+        if (term.halo && part == A.first_part())
+            A.exchange_halos(term.x, *term.halo);
 
-        kernel.push_arg(term.A.idx);
-        kernel.push_arg(term.A.row);
-        kernel.push_arg(term.A.col);
-        kernel.push_arg(term.A.val);
+        kernel.push_arg(A.idx[part]);
+        kernel.push_arg(A.row[part]);
+        kernel.push_arg(A.col[part]);
+        kernel.push_arg(A.val[part]);
         kernel.push_arg(term.x(part));
+
+        // x itself is passed in place of missing halo.
+        if (A.lhalo[part] + A.rhalo[part])
+            kernel.push_arg((*term.halo)[part]);
+        else
+            kernel.push_arg(term.x(part));
+
+        kernel.push_arg(static_cast<ptrdiff_t>(A.part[part + 1] - A.part[part]));
+        kernel.push_arg(static_cast<ptrdiff_t>(A.lhalo[part]));
     }
 };
 
@@ -257,12 +526,9 @@ struct expression_properties< ccsr_product<val_t, col_t, idx_t, T> > {
             size_t &size
             )
     {
-        queue_list = term.x.queue_list();
-        partition  = term.x.partition();
-        size       = term.x.size();
-
-        assert(partition.size() == 2);
-        partition.back() = size;
+        queue_list = term.A.queue;
+        partition  = term.A.part;
+        size       = term.A.n;
     }
 };
 
@@ -272,7 +538,7 @@ struct expression_properties< ccsr_product<val_t, col_t, idx_t, T> > {
 template <size_t I, typename val_t, typename col_t, typename idx_t, typename MV>
 ccsr_product<val_t, col_t, idx_t, typename MV::sub_value_type>
 get(const mv_ccsr_product<val_t, col_t, idx_t, MV> &t) {
-    return t.A * t.x(I);
+    return t.comp[I];
 }
 #endif
 
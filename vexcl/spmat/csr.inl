@@ -31,84 +31,110 @@ THE SOFTWARE.
  * \brief  OpenCL sparse matrix in CSR format.
  */
 
-struct SpMatCSR : public sparse_matrix {
+template <typename dev_col_t, typename dev_idx_t>
+struct csr_matrix : public sparse_matrix {
     const backend::command_queue &queue;
     size_t n;
 
+    // Process each row with a group of threads.
+    bool vectorized;
+
     struct matrix_part {
         size_t nnz;
-        backend::device_vector<idx_t> row;
-        backend::device_vector<col_t> col;
-        backend::device_vector<val_t> val;
+        backend::device_vector<dev_idx_t> row;
+        backend::device_vector<dev_col_t> col;
+        backend::device_vector<store_t> val;
+        value_index<dev_idx_t> map;
     } loc, rem;
 
-    SpMatCSR(
+    csr_matrix(
             const backend::command_queue &queue,
             const idx_t *row_begin, const idx_t *row_end,
             const col_t *col, const val_t *val,
             col_t col_begin, col_t col_end,
-            std::set<col_t> ghost_cols
+            std::set<col_t> ghost_cols,
+            const spmat_format_choice &fmt
             )
-        : queue(queue), n(row_end - row_begin)
+        : queue(queue), n(row_end - row_begin),
+          vectorized(fmt.format == spmat_format::csr_vector)
     {
         auto is_local = [col_begin, col_end](col_t c) {
             return c >= col_begin && c < col_end;
         };
 
         if (ghost_cols.empty()) {
+            // Without ghost columns the values are stored in the original
+            // order, and update_values() needs no map.
             loc.nnz = *row_end - *row_begin;
             rem.nnz = 0;
 
             if (loc.nnz) {
-                loc.row = backend::device_vector<idx_t>(queue, (n + 1), row_begin,        backend::MEM_READ_ONLY);
-                loc.col = backend::device_vector<col_t>(queue, loc.nnz, col + *row_begin, backend::MEM_READ_ONLY);
-                loc.val = backend::device_vector<val_t>(queue, loc.nnz, val + *row_begin, backend::MEM_READ_ONLY);
+                std::vector<dev_idx_t> lrow(n + 1);
+                std::vector<dev_col_t> lcol(loc.nnz);
+                std::vector<store_t>   lval(loc.nnz);
+
+                for(size_t i = 0; i <= n; ++i)
+                    lrow[i] = static_cast<dev_idx_t>(row_begin[i] - *row_begin);
 
-                if (*row_begin > 0) vector<idx_t>(queue, loc.row) -= *row_begin;
+                for(size_t j = 0; j < loc.nnz; ++j) {
+                    lcol[j] = static_cast<dev_col_t>(col[*row_begin + j] - col_begin);
+                    lval[j] = static_cast<store_t>(val[*row_begin + j]);
+                }
+
+                loc.row = backend::device_vector<dev_idx_t>(queue, lrow.size(), lrow.data(), backend::MEM_READ_ONLY);
+                loc.col = backend::device_vector<dev_col_t>(queue, lcol.size(), lcol.data(), backend::MEM_READ_ONLY);
+                loc.val = backend::device_vector<store_t>  (queue, lval.size(), lval.data(), backend::MEM_READ_ONLY);
             }
         } else {
-            std::vector<idx_t> lrow;
-            std::vector<col_t> lcol;
-            std::vector<val_t> lval;
+            loc.nnz = 0;
+            rem.nnz = 0;
 
-            std::vector<idx_t> rrow;
-            std::vector<col_t> rcol;
-            std::vector<val_t> rval;
+            std::vector<dev_idx_t> lrow;
+            std::vector<dev_col_t> lcol;
+            std::vector<store_t> lval;
+            std::vector<dev_idx_t> lmap;
+
+            std::vector<dev_idx_t> rrow;
+            std::vector<dev_col_t> rcol;
+            std::vector<store_t> rval;
+            std::vector<dev_idx_t> rmap;
 
             lrow.reserve(n + 1);
             lrow.push_back(0);
 
             lcol.reserve(*row_end - *row_begin);
             lval.reserve(*row_end - *row_begin);
+            lmap.reserve(*row_end - *row_begin);
 
-            if (!ghost_cols.empty()) {
-                rrow.reserve(n + 1);
-                rrow.push_back(0);
+            rrow.reserve(n + 1);
+            rrow.push_back(0);
 
-                rcol.reserve(*row_end - *row_begin);
-                rval.reserve(*row_end - *row_begin);
-            }
+            rcol.reserve(*row_end - *row_begin);
+            rval.reserve(*row_end - *row_begin);
+            rmap.reserve(*row_end - *row_begin);
 
             // Renumber columns.
-            std::unordered_map<col_t, col_t> r2l(2 * ghost_cols.size());
+            std::unordered_map<col_t, dev_col_t> r2l(2 * ghost_cols.size());
             size_t nghost = 0;
             for(auto c = ghost_cols.begin(); c != ghost_cols.end(); ++c)
-                r2l[*c] = static_cast<col_t>(nghost++);
+                r2l[*c] = static_cast<dev_col_t>(nghost++);
 
             for(auto row = row_begin; row != row_end; ++row) {
                 for(idx_t j = row[0]; j < row[1]; j++) {
                     if (is_local(col[j])) {
-                        lcol.push_back(static_cast<col_t>(col[j] - col_begin));
-                        lval.push_back(val[j]);
+                        lcol.push_back(static_cast<dev_col_t>(col[j] - col_begin));
+                        lval.push_back(static_cast<store_t>(val[j]));
+                        lmap.push_back(static_cast<dev_idx_t>(j - *row_begin));
                     } else {
                         assert(r2l.count(col[j]));
                         rcol.push_back(r2l[col[j]]);
-                        rval.push_back(val[j]);
+                        rval.push_back(static_cast<store_t>(val[j]));
+                        rmap.push_back(static_cast<dev_idx_t>(j - *row_begin));
                     }
                 }
 
-                lrow.push_back(static_cast<idx_t>(lcol.size()));
-                rrow.push_back(static_cast<idx_t>(rcol.size()));
+                lrow.push_back(static_cast<dev_idx_t>(lcol.size()));
+                rrow.push_back(static_cast<dev_idx_t>(rcol.size()));
             }
 
 
@@ -116,19 +142,39 @@ struct SpMatCSR : public sparse_matrix {
             if (lrow.back()) {
                 loc.nnz = lrow.back();
 
-                loc.row = backend::device_vector<idx_t>(queue, lrow.size(), lrow.data(), backend::MEM_READ_ONLY);
-                loc.col = backend::device_vector<col_t>(queue, lcol.size(), lcol.data(), backend::MEM_READ_ONLY);
-                loc.val = backend::device_vector<val_t>(queue, lval.size(), lval.data(), backend::MEM_READ_ONLY);
+                loc.row = backend::device_vector<dev_idx_t>(queue, lrow.size(), lrow.data(), backend::MEM_READ_ONLY);
+                loc.col = backend::device_vector<dev_col_t>(queue, lcol.size(), lcol.data(), backend::MEM_READ_ONLY);
+                loc.val = backend::device_vector<store_t>(queue, lval.size(), lval.data(), backend::MEM_READ_ONLY);
+                loc.map.host.swap(lmap);
             }
 
             // Copy remote part to the device.
-            if (!ghost_cols.empty()) {
-                rem.nnz = rrow.back();
+            rem.nnz = rrow.back();
 
-                rem.row = backend::device_vector<idx_t>(queue, rrow.size(), rrow.data(), backend::MEM_READ_ONLY);
-                rem.col = backend::device_vector<col_t>(queue, rcol.size(), rcol.data(), backend::MEM_READ_ONLY);
-                rem.val = backend::device_vector<val_t>(queue, rval.size(), rval.data(), backend::MEM_READ_ONLY);
-            }
+            rem.row = backend::device_vector<dev_idx_t>(queue, rrow.size(), rrow.data(), backend::MEM_READ_ONLY);
+            rem.col = backend::device_vector<dev_col_t>(queue, rcol.size(), rcol.data(), backend::MEM_READ_ONLY);
+            rem.val = backend::device_vector<store_t>(queue, rval.size(), rval.data(), backend::MEM_READ_ONLY);
+            rem.map.host.swap(rmap);
+        }
+    }
+
+    // Uses local CSR matrix residing on the device.
+    csr_matrix(
+            const backend::command_queue &queue, size_t n, size_t nnz,
+            const backend::device_vector<dev_idx_t> &row,
+            const backend::device_vector<dev_col_t> &col,
+            const backend::device_vector<store_t> &val,
+            const spmat_format_choice &fmt
+            )
+        : queue(queue), n(n), vectorized(fmt.format == spmat_format::csr_vector)
+    {
+        loc.nnz = nnz;
+        rem.nnz = 0;
+
+        if (nnz) {
+            loc.row = row;
+            loc.col = col;
+            loc.val = val;
         }
     }
 
@@ -141,6 +187,11 @@ struct SpMatCSR : public sparse_matrix {
     {
         using namespace detail;
 
+        if (vectorized) {
+            mul_vector<OP>(part, in, out, scale);
+            return;
+        }
+
         static kernel_cache cache;
 
         auto key    = backend::cache_key(queue);
@@ -155,9 +206,9 @@ struct SpMatCSR : public sparse_matrix {
                 .open("(")
                     .template parameter<size_t>("n")
                     .template parameter<scalar_type>("scale")
-                    .template parameter< global_ptr< const idx_t > >("row")
-                    .template parameter< global_ptr< const col_t > >("col")
-                    .template parameter< global_ptr< const val_t > >("val")
+                    .template parameter< global_ptr< const dev_idx_t > >("row")
+                    .template parameter< global_ptr< const dev_col_t > >("col")
+                    .template parameter< global_ptr< const store_t > >("val")
                     .template parameter< global_ptr< const val_t > >("in")
                     .template parameter< global_ptr< val_t > >("out")
                 .close(")")
@@ -186,6 +237,97 @@ struct SpMatCSR : public sparse_matrix {
         kernel->second(queue);
     }
 
+    // Each row is processed by a subgroup of threads. Partial sums of the
+    // subgroup are reduced in local memory.
+    template <class OP>
+    void mul_vector(const matrix_part &part,
+            const backend::device_vector<val_t> &in,
+            backend::device_vector<val_t> &out,
+            scalar_type scale
+            ) const
+    {
+        using namespace detail;
+
+        static kernel_cache cache;
+
+        auto key    = backend::cache_key(queue);
+        auto kernel = cache.find(key);
+
+        backend::select_context(queue);
+
+        if (kernel == cache.end()) {
+            backend::source_generator source(queue);
+
+            source.kernel("csr_vector_spmv")
+                .open("(")
+                    .template parameter<size_t>("n")
+                    .template parameter<scalar_type>("scale")
+                    .template parameter< global_ptr< const dev_idx_t > >("row")
+                    .template parameter< global_ptr< const dev_col_t > >("col")
+                    .template parameter< global_ptr< const store_t > >("val")
+                    .template parameter< global_ptr< const val_t > >("in")
+                    .template parameter< global_ptr< val_t > >("out")
+                    .template parameter<size_t>("w")
+                    .template smem_parameter<val_t>()
+                .close(")")
+                .open("{");
+
+            source.smem_declaration<val_t>();
+            source.new_line() << type_name< shared_ptr<val_t> >() << " sdata = smem;";
+            source.new_line() << "size_t tid  = " << source.local_id(0) << ";";
+            source.new_line() << "size_t lane = tid % w;";
+            source.new_line() << "size_t rows = " << source.local_size(0) << " / w;";
+            source.new_line() << "size_t step = " << source.global_size(0) << " / w;";
+
+            // The loop bounds are the same for all threads in a work group,
+            // so that barriers are reached by every thread.
+            source.new_line() << "for(size_t base = " << source.group_id(0)
+                << " * rows; base < n; base += step)";
+            source.open("{");
+            source.new_line() << "size_t i = base + tid / w;";
+            source.new_line() << type_name<val_t>() << " sum = 0;";
+            source.new_line() << "if (i < n)";
+            source.open("{");
+            source.new_line() << "for(size_t j = row[i] + lane, e = row[i + 1]; j < e; j += w)";
+            source.new_line() << "    sum += val[j] * in[col[j]];";
+            source.close("}");
+            source.new_line() << "sdata[tid] = sum;";
+            source.new_line().barrier();
+            source.new_line() << "for(size_t s = w / 2; s > 0; s /= 2)";
+            source.open("{");
+            source.new_line() << "if (lane < s) sdata[tid] += sdata[tid + s];";
+            source.new_line().barrier();
+            source.close("}");
+            source.new_line() << "if (i < n && lane == 0) out[i] "
+                << OP::string() << " scale * sdata[tid];";
+            source.new_line().barrier();
+            source.close("}");
+            source.close("}");
+
+            backend::kernel krn(queue, source.str(), "csr_vector_spmv", sizeof(val_t));
+            kernel = cache.insert(std::make_pair(key, krn)).first;
+        }
+
+        // Number of threads per row. The reduction needs a power of two
+        // that divides the work group size.
+        const size_t wgs = kernel->second.workgroup_size();
+
+        size_t w = 1;
+        while(w < 32 && wgs % (2 * w) == 0) w *= 2;
+
+        kernel->second.push_arg(n);
+        kernel->second.push_arg(scale);
+        kernel->second.push_arg(part.row);
+        kernel->second.push_arg(part.col);
+        kernel->second.push_arg(part.val);
+        kernel->second.push_arg(in);
+        kernel->second.push_arg(out);
+        kernel->second.push_arg(w);
+        kernel->second.set_smem([](size_t wgs){ return wgs * sizeof(val_t); });
+
+        kernel->second(queue);
+    }
+
     void mul_local(
             const backend::device_vector<val_t> &in,
             backend::device_vector<val_t> &out,
@@ -209,50 +351,217 @@ struct SpMatCSR : public sparse_matrix {
         if (rem.nnz) mul<assign::ADD>(rem, in, out, scale);
     }
 
+    template <class OP>
+    void mul(const matrix_part &part,
+            const block &in, const block &out,
+            scalar_type scale
+            ) const
+    {
+        using namespace detail;
+
+        static kernel_cache cache[2][max_block_width];
+
+        const size_t w = in.width();
+        const bool   vload = vector_loads(in);
+
+        auto key    = backend::cache_key(queue);
+        auto kernel = cache[vload][w - 1].find(key);
+
+        backend::select_context(queue);
+
+        if (kernel == cache[vload][w - 1].end()) {
+            backend::source_generator source(queue);
+
+            source.kernel("csr_spmm")
+                .open("(")
+                    .template parameter<size_t>("n")
+                    .template parameter<scalar_type>("scale")
+                    .template parameter< global_ptr< const dev_idx_t > >("row")
+                    .template parameter< global_ptr< const dev_col_t > >("col")
+                    .template parameter< global_ptr< const store_t > >("val")
+                    .template parameter<size_t>("in_stride")
+                    .template parameter<size_t>("out_stride");
+
+            for(size_t k = 0; k < w; ++k) {
+                source.template parameter< global_ptr<const val_t> >("in") << k;
+                source.template parameter<size_t>("in_off") << k;
+            }
+
+            for(size_t k = 0; k < w; ++k) {
+                source.template parameter< global_ptr<val_t> >("out") << k;
+                source.template parameter<size_t>("out_off") << k;
+            }
+
+            source.close(")").open("{").grid_stride_loop("i").open("{");
+
+            for(size_t k = 0; k < w; ++k)
+                source.new_line() << type_name<val_t>() << " sum" << k << " = 0;";
+
+            source.new_line() << "if (row)";
+            source.open("{");
+            source.new_line() << "for(size_t j = row[i], e = row[i + 1]; j < e; ++j)";
+            source.open("{");
+            source.new_line() << type_name<val_t>() << " v = val[j];";
+            source.new_line() << "size_t p = col[j] * in_stride;";
+            block_update(source, w, vload);
+            source.close("}").close("}");
+            for(size_t k = 0; k < w; ++k)
+                source.new_line() << "out" << k << "[out_off" << k << " + i * out_stride] "
+                    << OP::string() << " scale * sum" << k << ";";
+            source.close("}").close("}");
+
+            backend::kernel krn(queue, source.str(), "csr_spmm");
+            kernel = cache[vload][w - 1].insert(std::make_pair(key, krn)).first;
+        }
+
+        kernel->second.push_arg(n);
+        kernel->second.push_arg(scale);
+
+        if (part.nnz) {
+            kernel->second.push_arg(part.row);
+            kernel->second.push_arg(part.col);
+            kernel->second.push_arg(part.val);
+        } else {
+            kernel->second.push_arg(static_cast<void*>(0));
+            kernel->second.push_arg(static_cast<void*>(0));
+            kernel->second.push_arg(static_cast<void*>(0));
+        }
+
+        kernel->second.push_arg(in.stride);
+        kernel->second.push_arg(out.stride);
+
+        for(size_t k = 0; k < w; ++k) {
+            kernel->second.push_arg(*in.col[k]);
+            kernel->second.push_arg(in.off[k]);
+        }
+
+        for(size_t k = 0; k < w; ++k) {
+            kernel->second.push_arg(*out.col[k]);
+            kernel->second.push_arg(out.off[k]);
+        }
+
+        kernel->second(queue);
+    }
+
+    void mul_local(const block &in, const block &out,
+            scalar_type scale, bool append) const
+    {
+        if (append) {
+            if (loc.nnz) mul<assign::ADD>(loc, in, out, scale);
+        } else {
+            // Empty local part still has to reset the output.
+            mul<assign::SET>(loc, in, out, scale);
+        }
+    }
+
+    void mul_remote(const block &in, const block &out,
+            scalar_type scale) const
+    {
+        if (rem.nnz) mul<assign::ADD>(rem, in, out, scale);
+    }
+
+    void update_values(const backend::device_vector<val_t> &val) const {
+        if (!rem.nnz) {
+            // Values of the matrix without ghost columns are stored in the
+            // original order.
+            vector<store_t>(queue, loc.val) = vector<val_t>(queue, val);
+            return;
+        }
+
+        std::vector< value_map<dev_idx_t> > parts;
+
+        if (loc.nnz) parts.push_back(value_map<dev_idx_t>(loc.nnz, loc.map.device(queue), loc.val));
+        if (rem.nnz) parts.push_back(value_map<dev_idx_t>(rem.nnz, rem.map.device(queue), rem.val));
+
+        scatter_values(queue, val, parts);
+    }
+
+    void get_entries(col_t col_begin, const std::vector<col_t> &ghost,
+            coo_entries &e) const
+    {
+        get_entries(loc, e, [col_begin](dev_col_t c) { return col_begin + c; });
+        get_entries(rem, e, [&ghost](dev_col_t c) { return ghost[c]; });
+    }
+
+    template <class ColumnMap>
+    void get_entries(const matrix_part &part, coo_entries &e, ColumnMap global) const {
+        if (!part.nnz) return;
+
+        std::vector<dev_idx_t> row(n + 1);
+        std::vector<dev_col_t> col(part.nnz);
+        std::vector<store_t>   val(part.nnz);
+
+        part.row.read(queue, 0, n + 1,    row.data());
+        part.col.read(queue, 0, part.nnz, col.data());
+        part.val.read(queue, 0, part.nnz, val.data(), true);
+
+        for(size_t i = 0; i < n; ++i)
+            for(size_t j = row[i]; j < row[i + 1]; ++j)
+                e.push_back(i, global(col[j]), val[j]);
+    }
+
     static void inline_preamble(backend::source_generator &src,
             const std::string &prm_name)
     {
         src.function<val_t>(prm_name + "_csr_spmv")
             .open("(")
-                .template parameter< global_ptr<const idx_t> >("row")
-                .template parameter< global_ptr<const col_t> >("col")
-                .template parameter< global_ptr<const val_t> >("val")
+                .template parameter< global_ptr<const dev_idx_t> >("row")
+                .template parameter< global_ptr<const dev_col_t> >("col")
+                .template parameter< global_ptr<const store_t> >("val")
                 .template parameter< global_ptr<const val_t> >("in")
                 .template parameter< size_t >("i")
             .close(")").open("{");
         src.new_line() << type_name<val_t>() << " sum = 0;";
+        src.new_line() << "if (row)";
+        src.open("{");
         src.new_line() << "for(size_t j = row[i], e = row[i + 1]; j < e; ++j)";
         src.open("{");
         src.new_line() << "sum += val[j] * in[col[j]];";
-        src.close("}");
+        src.close("}").close("}");
         src.new_line() << "return sum;";
         src.close("}");
     }
 
     static void inline_expression(backend::source_generator &src,
-            const std::string &prm_name)
+            const std::string &prm_name, const std::string &part = "")
     {
         src << prm_name << "_csr_spmv" << "("
-            << prm_name << "_row, "
-            << prm_name << "_col, "
-            << prm_name << "_val, "
-            << prm_name << "_vec, idx)";
+            << prm_name << part << "_row, "
+            << prm_name << part << "_col, "
+            << prm_name << part << "_val, "
+            << prm_name << part << "_vec, idx)";
     }
 
     static void inline_parameters(backend::source_generator &src,
             const std::string &prm_name)
     {
-        src.template parameter< global_ptr<const idx_t> >(prm_name) << "_row";
-        src.template parameter< global_ptr<const col_t> >(prm_name) << "_col";
-        src.template parameter< global_ptr<const val_t> >(prm_name) << "_val";
-        src.template parameter< global_ptr<const val_t> >(prm_name) << "_vec";
+        src.template parameter< global_ptr<const dev_idx_t> >(prm_name) << "_row";
+        src.template parameter< global_ptr<const dev_col_t> >(prm_name) << "_col";
+        src.template parameter< global_ptr<const store_t> >(prm_name) << "_val";
+    }
+
+    void setArgs(backend::kernel &krn) const {
+        set_args(loc, krn);
+    }
+
+    void setRemoteArgs(backend::kernel &krn) const {
+        set_args(rem, krn);
+    }
+
+    static void set_args(const matrix_part &part, backend::kernel &krn) {
+        if (part.nnz) {
+            krn.push_arg(part.row);
+            krn.push_arg(part.col);
+            krn.push_arg(part.val);
+        } else {
+            null_args(krn);
+        }
     }
 
-    void setArgs(backend::kernel &krn, unsigned device, const vector<val_t> &x) const {
-        krn.push_arg(loc.row);
-        krn.push_arg(loc.col);
-        krn.push_arg(loc.val);
-        krn.push_arg(x(device));
+    static void null_args(backend::kernel &krn) {
+        krn.push_arg(static_cast<void*>(0));
+        krn.push_arg(static_cast<void*>(0));
+        krn.push_arg(static_cast<void*>(0));
     }
 };
 
@@ -0,0 +1,199 @@
+#ifndef VEXCL_SPMAT_FORMAT_HPP
+#define VEXCL_SPMAT_FORMAT_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2026 Denis Demidov <ddemidov@ksu.ru>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/spmat/format.hpp
+ * \author Denis Demidov <ddemidov@ksu.ru>
+ * \brief  Selection of sparse matrix storage format from row statistics.
+ */
+
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+#include <vexcl/backend.hpp>
+#include <vexcl/vector.hpp>
+#include <vexcl/vector_view.hpp>
+#include <vexcl/reductor.hpp>
+
+namespace vex {
+
+/// Storage format of a device partition of vex::SpMat.
+enum class spmat_format {
+    csr,        ///< CSR, a thread per row.
+    csr_vector, ///< CSR, a group of threads per row.
+    hell        ///< Hybrid ELL-CSR.
+};
+
+inline std::ostream& operator<<(std::ostream &os, spmat_format f) {
+    switch (f) {
+        case spmat_format::csr:
+            return os << "CSR";
+        case spmat_format::csr_vector:
+            return os << "vector CSR";
+        case spmat_format::hell:
+            return os << "hybrid ELL";
+    }
+    return os;
+}
+
+/// Statistics of row widths in a sparse matrix partition.
+struct row_statistics {
+    size_t rows;      ///< Number of rows.
+    size_t nonzeros;  ///< Number of nonzero entries.
+    size_t max_width; ///< Maximum number of nonzeros in a row.
+    double mean;      ///< Mean number of nonzeros in a row.
+    double stdev;     ///< Standard deviation of nonzeros in a row.
+
+    row_statistics() : rows(0), nonzeros(0), max_width(0), mean(0), stdev(0) {}
+
+    /// Computes statistics from CSR row pointers on the host.
+    template <typename idx_t>
+    row_statistics(const idx_t *row_begin, const idx_t *row_end)
+        : rows(row_end - row_begin), nonzeros(*row_end - *row_begin),
+          max_width(0), mean(0), stdev(0)
+    {
+        if (!rows) return;
+
+        double sum2 = 0;
+        for(auto row = row_begin; row != row_end; ++row) {
+            size_t w = row[1] - row[0];
+            max_width = std::max(max_width, w);
+            sum2 += static_cast<double>(w) * w;
+        }
+
+        init(sum2);
+    }
+
+    /// Computes statistics from CSR row pointers residing on a device.
+    template <typename idx_t>
+    row_statistics(const backend::command_queue &queue, size_t n,
+            const backend::device_vector<idx_t> &row)
+        : rows(n), nonzeros(0), max_width(0), mean(0), stdev(0)
+    {
+        if (!rows) return;
+
+        std::vector<backend::command_queue> q(1, queue);
+
+        slicer<1> slice(extents[n + 1]);
+
+        vex::vector<idx_t>  ptr(queue, row);
+        vex::vector<size_t> width(q, n);
+
+        width = slice[range(1, n + 1)](ptr) - slice[range(0, n)](ptr);
+
+        Reductor<size_t, MAX> max(q);
+        Reductor<size_t, SUM> sum(q);
+
+        max_width = max(width);
+        nonzeros  = sum(width);
+
+        init(static_cast<double>(sum(width * width)));
+    }
+
+    private:
+        void init(double sum2) {
+            mean  = static_cast<double>(nonzeros) / rows;
+            stdev = std::sqrt(std::max(0.0, sum2 / rows - mean * mean));
+        }
+};
+
+/// Storage format selected for a device partition of vex::SpMat.
+struct spmat_format_choice {
+    /// Selected format.
+    spmat_format format;
+
+    /// Row statistics of the partition the decision is based on.
+    row_statistics stat;
+
+    /// Speed of ELL relative to CSR (e.g. 2.0 -> ELL is twice as fast).
+    /**
+     * Used by the hybrid format to split rows between ELL and CSR parts:
+     * the ELL width is the smallest one that leaves less than
+     * rows / ell_vs_csr rows in the CSR part.
+     */
+    double ell_vs_csr;
+
+    /// Human-readable reason for the decision.
+    std::string reason;
+
+    spmat_format_choice()
+        : format(spmat_format::csr), ell_vs_csr(0), reason("empty partition")
+    {}
+};
+
+/// \cond INTERNAL
+namespace detail {
+
+// Selects storage format for a matrix partition. Rows on CPUs are processed
+// by a single thread each, so CSR is always used there. On GPUs, a group of
+// threads per row is used when rows are long enough to keep the group busy,
+// or when row widths vary so much that the CSR tail of the hybrid format
+// would be processed by a few overloaded threads. Otherwise, the hybrid
+// format provides coalesced memory access for the regular part of the
+// matrix.
+inline spmat_format_choice select_spmat_format(
+        const backend::command_queue &queue, const row_statistics &s)
+{
+    // Number of threads processing a row in the vector CSR kernel.
+    const size_t subgroup = 32;
+
+    spmat_format_choice c;
+    c.stat       = s;
+    c.ell_vs_csr = 3.0;
+
+    std::ostringstream reason;
+    reason << "rows: " << s.rows << ", mean width: " << s.mean
+           << ", stdev: " << s.stdev << ", max width: " << s.max_width << "; ";
+
+    if (backend::is_cpu(queue)) {
+        c.format = spmat_format::csr;
+        reason << "CPU device, a thread per row";
+    } else if (s.mean >= subgroup) {
+        c.format = spmat_format::csr_vector;
+        reason << "rows are long enough to keep " << subgroup
+               << " threads per row busy";
+    } else if (s.max_width >= subgroup && s.stdev > s.mean) {
+        c.format = spmat_format::csr_vector;
+        reason << "row widths are irregular (stdev exceeds mean)";
+    } else {
+        c.format = spmat_format::hell;
+        reason << "short regular rows, coalesced ELL access";
+    }
+
+    c.reason = reason.str();
+    return c;
+}
+
+} // namespace detail
+/// \endcond
+
+} // namespace vex
+
+#endif
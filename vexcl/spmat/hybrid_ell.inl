@@ -31,31 +31,35 @@ THE SOFTWARE.
  * \brief  OpenCL sparse matrix in Hybrid ELL-CSR format.
  */
 
-struct SpMatHELL : public sparse_matrix {
+template <typename dev_col_t, typename dev_idx_t>
+struct hell_matrix : public sparse_matrix {
     const backend::command_queue &queue;
     size_t n, pitch;
 
     struct matrix_part {
         struct {
             size_t     width;
-            backend::device_vector<col_t> col;
-            backend::device_vector<val_t> val;
+            backend::device_vector<dev_col_t> col;
+            backend::device_vector<store_t> val;
+            value_index<dev_idx_t> map;
         } ell;
 
         struct {
             size_t     nnz;
-            backend::device_vector<idx_t> row;
-            backend::device_vector<col_t> col;
-            backend::device_vector<val_t> val;
+            backend::device_vector<dev_idx_t> row;
+            backend::device_vector<dev_col_t> col;
+            backend::device_vector<store_t> val;
+            value_index<dev_idx_t> map;
         } csr;
     } loc, rem;
 
-    SpMatHELL(
+    hell_matrix(
             const backend::command_queue &queue,
             const idx_t *row_begin, const idx_t *row_end,
             const col_t *col, const val_t *val,
             size_t col_begin, size_t col_end,
-            std::set<col_t> ghost_cols
+            std::set<col_t> ghost_cols,
+            const spmat_format_choice &fmt
             )
         : queue(queue), n(row_end - row_begin), pitch( alignup(n, 16U) )
     {
@@ -65,8 +69,7 @@ struct SpMatHELL : public sparse_matrix {
 
         /* 1. Get optimal ELL widths for local and remote parts. */
         {
-            // Speed of ELL relative to CSR (e.g. 2.0 -> ELL is twice as fast):
-            const double ell_vs_csr = 3.0;
+            const double ell_vs_csr = fmt.ell_vs_csr;
 
             // Find maximum widths for local and remote parts:
             loc.ell.width = rem.ell.width = 0;
@@ -130,34 +133,41 @@ struct SpMatHELL : public sparse_matrix {
         }
 
         /* 3. Renumber columns. */
-        std::unordered_map<col_t,col_t> r2l(2 * ghost_cols.size());
+        std::unordered_map<col_t, dev_col_t> r2l(2 * ghost_cols.size());
         size_t nghost = 0;
         for(auto c = ghost_cols.begin(); c != ghost_cols.end(); c++)
-            r2l[*c] = static_cast<col_t>(nghost++);
+            r2l[*c] = static_cast<dev_col_t>(nghost++);
 
         // Prepare ELL and COO formats for transfer to devices.
-        const col_t not_a_column = static_cast<col_t>(-1);
-
-        std::vector<col_t> lell_col(pitch * loc.ell.width, not_a_column);
-        std::vector<val_t> lell_val(pitch * loc.ell.width, val_t());
-        std::vector<col_t> rell_col(pitch * rem.ell.width, not_a_column);
-        std::vector<val_t> rell_val(pitch * rem.ell.width, val_t());
-
-        std::vector<idx_t> lcsr_row;
-        std::vector<col_t> lcsr_col;
-        std::vector<val_t> lcsr_val;
-
-        std::vector<idx_t> rcsr_row;
-        std::vector<col_t> rcsr_col;
-        std::vector<val_t> rcsr_val;
+        const dev_col_t not_a_column = static_cast<dev_col_t>(-1);
+        const dev_idx_t not_a_value  = static_cast<dev_idx_t>(-1);
+
+        std::vector<dev_col_t> lell_col(pitch * loc.ell.width, not_a_column);
+        std::vector<store_t> lell_val(pitch * loc.ell.width, store_t());
+        std::vector<dev_idx_t> lell_map(pitch * loc.ell.width, not_a_value);
+        std::vector<dev_col_t> rell_col(pitch * rem.ell.width, not_a_column);
+        std::vector<store_t> rell_val(pitch * rem.ell.width, store_t());
+        std::vector<dev_idx_t> rell_map(pitch * rem.ell.width, not_a_value);
+
+        std::vector<dev_idx_t> lcsr_row;
+        std::vector<dev_col_t> lcsr_col;
+        std::vector<store_t> lcsr_val;
+        std::vector<dev_idx_t> lcsr_map;
+
+        std::vector<dev_idx_t> rcsr_row;
+        std::vector<dev_col_t> rcsr_col;
+        std::vector<store_t> rcsr_val;
+        std::vector<dev_idx_t> rcsr_map;
 
         lcsr_row.reserve(n + 1);
         lcsr_col.reserve(loc.csr.nnz);
         lcsr_val.reserve(loc.csr.nnz);
+        lcsr_map.reserve(loc.csr.nnz);
 
         rcsr_row.reserve(n + 1);
         rcsr_col.reserve(rem.csr.nnz);
         rcsr_val.reserve(rem.csr.nnz);
+        rcsr_map.reserve(rem.csr.nnz);
 
         lcsr_row.push_back(0);
         rcsr_row.push_back(0);
@@ -168,54 +178,209 @@ struct SpMatHELL : public sparse_matrix {
             for(idx_t j = row[0]; j < row[1]; ++j) {
                 if (is_local(col[j])) {
                     if (lcnt < loc.ell.width) {
-                        lell_col[k + pitch * lcnt] = static_cast<col_t>(col[j] - col_begin);
-                        lell_val[k + pitch * lcnt] = val[j];
+                        lell_col[k + pitch * lcnt] = static_cast<dev_col_t>(col[j] - col_begin);
+                        lell_val[k + pitch * lcnt] = static_cast<store_t>(val[j]);
+                        lell_map[k + pitch * lcnt] = static_cast<dev_idx_t>(j - row_begin[0]);
                         ++lcnt;
                     } else {
-                        lcsr_col.push_back(static_cast<col_t>(col[j] - col_begin));
-                        lcsr_val.push_back(val[j]);
+                        lcsr_col.push_back(static_cast<dev_col_t>(col[j] - col_begin));
+                        lcsr_val.push_back(static_cast<store_t>(val[j]));
+                        lcsr_map.push_back(static_cast<dev_idx_t>(j - row_begin[0]));
                     }
                 } else {
                     assert(r2l.count(col[j]));
                     if (rcnt < rem.ell.width) {
                         rell_col[k + pitch * rcnt] = r2l[col[j]];
-                        rell_val[k + pitch * rcnt] = val[j];
+                        rell_val[k + pitch * rcnt] = static_cast<store_t>(val[j]);
+                        rell_map[k + pitch * rcnt] = static_cast<dev_idx_t>(j - row_begin[0]);
                         ++rcnt;
                     } else {
                         rcsr_col.push_back(r2l[col[j]]);
-                        rcsr_val.push_back(val[j]);
+                        rcsr_val.push_back(static_cast<store_t>(val[j]));
+                        rcsr_map.push_back(static_cast<dev_idx_t>(j - row_begin[0]));
                     }
                 }
             }
 
-            lcsr_row.push_back(static_cast<idx_t>(lcsr_col.size()));
-            rcsr_row.push_back(static_cast<idx_t>(rcsr_col.size()));
+            lcsr_row.push_back(static_cast<dev_idx_t>(lcsr_col.size()));
+            rcsr_row.push_back(static_cast<dev_idx_t>(rcsr_col.size()));
         }
 
         /* Copy data to device */
         if (loc.ell.width) {
-            loc.ell.col = backend::device_vector<col_t>(queue, lell_col.size(), lell_col.data());
-            loc.ell.val = backend::device_vector<val_t>(queue, lell_val.size(), lell_val.data());
+            loc.ell.col = backend::device_vector<dev_col_t>(queue, lell_col.size(), lell_col.data());
+            loc.ell.val = backend::device_vector<store_t>(queue, lell_val.size(), lell_val.data());
+            loc.ell.map.host.swap(lell_map);
         }
 
         if (loc.csr.nnz) {
-            loc.csr.row = backend::device_vector<idx_t>(queue, lcsr_row.size(), lcsr_row.data());
-            loc.csr.col = backend::device_vector<col_t>(queue, lcsr_col.size(), lcsr_col.data());
-            loc.csr.val = backend::device_vector<val_t>(queue, lcsr_val.size(), lcsr_val.data());
+            loc.csr.row = backend::device_vector<dev_idx_t>(queue, lcsr_row.size(), lcsr_row.data());
+            loc.csr.col = backend::device_vector<dev_col_t>(queue, lcsr_col.size(), lcsr_col.data());
+            loc.csr.val = backend::device_vector<store_t>(queue, lcsr_val.size(), lcsr_val.data());
+            loc.csr.map.host.swap(lcsr_map);
         }
 
         if (rem.ell.width) {
-            rem.ell.col = backend::device_vector<col_t>(queue, rell_col.size(), rell_col.data());
-            rem.ell.val = backend::device_vector<val_t>(queue, rell_val.size(), rell_val.data());
+            rem.ell.col = backend::device_vector<dev_col_t>(queue, rell_col.size(), rell_col.data());
+            rem.ell.val = backend::device_vector<store_t>(queue, rell_val.size(), rell_val.data());
+            rem.ell.map.host.swap(rell_map);
         }
 
         if (rem.csr.nnz) {
-            rem.csr.row = backend::device_vector<idx_t>(queue, rcsr_row.size(), rcsr_row.data());
-            rem.csr.col = backend::device_vector<col_t>(queue, rcsr_col.size(), rcsr_col.data());
-            rem.csr.val = backend::device_vector<val_t>(queue, rcsr_val.size(), rcsr_val.data());
+            rem.csr.row = backend::device_vector<dev_idx_t>(queue, rcsr_row.size(), rcsr_row.data());
+            rem.csr.col = backend::device_vector<dev_col_t>(queue, rcsr_col.size(), rcsr_col.data());
+            rem.csr.val = backend::device_vector<store_t>(queue, rcsr_val.size(), rcsr_val.data());
+            rem.csr.map.host.swap(rcsr_map);
         }
     }
 
+    // Converts local CSR matrix residing on the device.
+    hell_matrix(
+            const backend::command_queue &queue, size_t n, size_t nnz,
+            const backend::device_vector<dev_idx_t> &row,
+            const backend::device_vector<dev_col_t> &col,
+            const backend::device_vector<store_t> &val,
+            const spmat_format_choice &fmt
+            )
+        : queue(queue), n(n), pitch( alignup(n, 16U) )
+    {
+        using namespace detail;
+
+        std::vector<backend::command_queue> q(1, queue);
+
+        rem.ell.width = 0;
+        rem.csr.nnz   = 0;
+
+        /* 1. Get optimal ELL width. */
+        slicer<1> slice(extents[n + 1]);
+
+        vex::vector<dev_idx_t> ptr(queue, row);
+        vex::vector<dev_idx_t> width(q, n);
+
+        width = slice[range(1, n + 1)](ptr) - slice[range(0, n)](ptr);
+
+        {
+            const double ell_vs_csr = fmt.ell_vs_csr;
+
+            Reductor<size_t, MAX> max_width(q);
+            Reductor<size_t, SUM> count(q);
+
+            // The number of rows wider than w does not increase with w, so
+            // the smallest acceptable width is found by bisection.
+            size_t lo = 0, hi = max_width(width);
+            while(lo < hi) {
+                size_t w = (lo + hi) / 2;
+
+                if (ell_vs_csr * count(width > w) < n)
+                    hi = w;
+                else
+                    lo = w + 1;
+            }
+
+            loc.ell.width = lo;
+        }
+
+        /* 2. Count nonzeros in CSR part of the matrix. */
+        vex::vector<dev_idx_t> tail(q, n + 1);
+        vex::vector<dev_idx_t> tail_ptr(q, n + 1);
+
+        tail = 0;
+        slice[range(0, n)](tail) = if_else(
+                width > loc.ell.width, width - loc.ell.width, 0);
+
+        exclusive_scan(tail, tail_ptr);
+
+        loc.csr.nnz = tail_ptr[n];
+
+        /* 3. Fill ELL and CSR parts. */
+        if (!nnz) return;
+
+        if (loc.ell.width) {
+            loc.ell.col = backend::device_vector<dev_col_t>(queue, pitch * loc.ell.width);
+            loc.ell.val = backend::device_vector<store_t>(queue, pitch * loc.ell.width);
+        }
+
+        if (loc.csr.nnz) {
+            loc.csr.row = tail_ptr(0);
+            loc.csr.col = backend::device_vector<dev_col_t>(queue, loc.csr.nnz);
+            loc.csr.val = backend::device_vector<store_t>(queue, loc.csr.nnz);
+        }
+
+        static kernel_cache cache;
+
+        auto key    = backend::cache_key(queue);
+        auto kernel = cache.find(key);
+
+        backend::select_context(queue);
+
+        if (kernel == cache.end()) {
+            backend::source_generator source(queue);
+
+            source.kernel("csr_to_hybrid_ell")
+                .open("(")
+                    .template parameter<size_t>("n")
+                    .template parameter<size_t>("ell_w")
+                    .template parameter<size_t>("ell_pitch")
+                    .template parameter< global_ptr<const dev_idx_t> >("row")
+                    .template parameter< global_ptr<const dev_col_t> >("col")
+                    .template parameter< global_ptr<const store_t> >("val")
+                    .template parameter< global_ptr<dev_col_t> >("ell_col")
+                    .template parameter< global_ptr<store_t> >("ell_val")
+                    .template parameter< global_ptr<const dev_idx_t> >("csr_row")
+                    .template parameter< global_ptr<dev_col_t> >("csr_col")
+                    .template parameter< global_ptr<store_t> >("csr_val")
+                .close(")")
+                .open("{")
+                    .grid_stride_loop("i").open("{");
+
+            source.new_line() << "size_t j = row[i], e = row[i + 1];";
+            source.new_line() << "for(size_t k = 0; k < ell_w; ++k, ++j)";
+            source.open("{");
+            source.new_line() << "ell_col[i + k * ell_pitch] = j < e ? col[j] : ("
+                << type_name<dev_col_t>() << ")(-1);";
+            source.new_line() << "ell_val[i + k * ell_pitch] = j < e ? val[j] : 0;";
+            source.close("}");
+            source.new_line() << "if (csr_row)";
+            source.open("{");
+            source.new_line() << "for(size_t p = csr_row[i]; j < e; ++j, ++p)";
+            source.open("{");
+            source.new_line() << "csr_col[p] = col[j];";
+            source.new_line() << "csr_val[p] = val[j];";
+            source.close("}").close("}");
+            source.close("}").close("}");
+
+            backend::kernel krn(queue, source.str(), "csr_to_hybrid_ell");
+            kernel = cache.insert(std::make_pair(key, krn)).first;
+        }
+
+        kernel->second.push_arg(n);
+        kernel->second.push_arg(loc.ell.width);
+        kernel->second.push_arg(pitch);
+        kernel->second.push_arg(row);
+        kernel->second.push_arg(col);
+        kernel->second.push_arg(val);
+
+        if (loc.ell.width) {
+            kernel->second.push_arg(loc.ell.col);
+            kernel->second.push_arg(loc.ell.val);
+        } else {
+            kernel->second.push_arg(static_cast<void*>(0));
+            kernel->second.push_arg(static_cast<void*>(0));
+        }
+
+        if (loc.csr.nnz) {
+            kernel->second.push_arg(loc.csr.row);
+            kernel->second.push_arg(loc.csr.col);
+            kernel->second.push_arg(loc.csr.val);
+        } else {
+            kernel->second.push_arg(static_cast<void*>(0));
+            kernel->second.push_arg(static_cast<void*>(0));
+            kernel->second.push_arg(static_cast<void*>(0));
+        }
+
+        kernel->second(queue);
+    }
+
     template <class OP>
     void mul(
             const matrix_part &part,
@@ -242,11 +407,11 @@ struct SpMatHELL : public sparse_matrix {
                     .template parameter<scalar_type>("scale")
                     .template parameter<size_t>("ell_w")
                     .template parameter<size_t>("ell_pitch")
-                    .template parameter< global_ptr<const col_t> >("ell_col")
-                    .template parameter< global_ptr<const val_t> >("ell_val")
-                    .template parameter< global_ptr<const idx_t> >("csr_row")
-                    .template parameter< global_ptr<const col_t> >("csr_col")
-                    .template parameter< global_ptr<const val_t> >("csr_val")
+                    .template parameter< global_ptr<const dev_col_t> >("ell_col")
+                    .template parameter< global_ptr<const store_t> >("ell_val")
+                    .template parameter< global_ptr<const dev_idx_t> >("csr_row")
+                    .template parameter< global_ptr<const dev_col_t> >("csr_col")
+                    .template parameter< global_ptr<const store_t> >("csr_val")
                     .template parameter< global_ptr<const val_t> >("in")
                     .template parameter< global_ptr<val_t> >("out")
                 .close(")")
@@ -256,8 +421,8 @@ struct SpMatHELL : public sparse_matrix {
             source.new_line() << type_name<val_t>() << " sum = 0;";
             source.new_line() << "for(size_t j = 0; j < ell_w; ++j)";
             source.open("{");
-            source.new_line() << type_name<col_t>() << " c = ell_col[i + j * ell_pitch];";
-            source.new_line() << "if (c != ("<< type_name<col_t>() << ")(-1))";
+            source.new_line() << type_name<dev_col_t>() << " c = ell_col[i + j * ell_pitch];";
+            source.new_line() << "if (c != ("<< type_name<dev_col_t>() << ")(-1))";
             source.open("{").new_line() << "sum += ell_val[i + j * ell_pitch] * in[c];";
             source.close("}").close("}");
             source.new_line() << "if (csr_row)";
@@ -320,6 +485,191 @@ struct SpMatHELL : public sparse_matrix {
         mul<assign::ADD>(rem, in, out, scale);
     }
 
+    template <class OP>
+    void mul(
+            const matrix_part &part,
+            const block &in, const block &out,
+            scalar_type scale
+            ) const
+    {
+        using namespace detail;
+
+        static kernel_cache cache[2][max_block_width];
+
+        const size_t w = in.width();
+        const bool   vload = vector_loads(in);
+
+        auto key    = backend::cache_key(queue);
+        auto kernel = cache[vload][w - 1].find(key);
+
+        backend::select_context(queue);
+
+        if (kernel == cache[vload][w - 1].end()) {
+            backend::source_generator source(queue);
+
+            source.kernel("hybrid_ell_spmm")
+                .open("(")
+                    .template parameter<size_t>("n")
+                    .template parameter<scalar_type>("scale")
+                    .template parameter<size_t>("ell_w")
+                    .template parameter<size_t>("ell_pitch")
+                    .template parameter< global_ptr<const dev_col_t> >("ell_col")
+                    .template parameter< global_ptr<const store_t> >("ell_val")
+                    .template parameter< global_ptr<const dev_idx_t> >("csr_row")
+                    .template parameter< global_ptr<const dev_col_t> >("csr_col")
+                    .template parameter< global_ptr<const store_t> >("csr_val")
+                    .template parameter<size_t>("in_stride")
+                    .template parameter<size_t>("out_stride");
+
+            for(size_t k = 0; k < w; ++k) {
+                source.template parameter< global_ptr<const val_t> >("in") << k;
+                source.template parameter<size_t>("in_off") << k;
+            }
+
+            for(size_t k = 0; k < w; ++k) {
+                source.template parameter< global_ptr<val_t> >("out") << k;
+                source.template parameter<size_t>("out_off") << k;
+            }
+
+            source.close(")").open("{").grid_stride_loop("i").open("{");
+
+            for(size_t k = 0; k < w; ++k)
+                source.new_line() << type_name<val_t>() << " sum" << k << " = 0;";
+
+            source.new_line() << "for(size_t j = 0; j < ell_w; ++j)";
+            source.open("{");
+            source.new_line() << type_name<dev_col_t>() << " c = ell_col[i + j * ell_pitch];";
+            source.new_line() << "if (c != ("<< type_name<dev_col_t>() << ")(-1))";
+            source.open("{");
+            source.new_line() << type_name<val_t>() << " v = ell_val[i + j * ell_pitch];";
+            source.new_line() << "size_t p = c * in_stride;";
+            block_update(source, w, vload);
+            source.close("}").close("}");
+            source.new_line() << "if (csr_row)";
+            source.open("{");
+            source.new_line() << "for(size_t j = csr_row[i], e = csr_row[i + 1]; j < e; ++j)";
+            source.open("{");
+            source.new_line() << type_name<val_t>() << " v = csr_val[j];";
+            source.new_line() << "size_t p = csr_col[j] * in_stride;";
+            block_update(source, w, vload);
+            source.close("}").close("}");
+            for(size_t k = 0; k < w; ++k)
+                source.new_line() << "out" << k << "[out_off" << k << " + i * out_stride] "
+                    << OP::string() << " scale * sum" << k << ";";
+            source.close("}").close("}");
+
+            backend::kernel krn(queue, source.str(), "hybrid_ell_spmm");
+            kernel = cache[vload][w - 1].insert(std::make_pair(key, krn)).first;
+        }
+
+        kernel->second.push_arg(n);
+        kernel->second.push_arg(scale);
+        kernel->second.push_arg(part.ell.width);
+        kernel->second.push_arg(pitch);
+
+        if (part.ell.width) {
+            kernel->second.push_arg(part.ell.col);
+            kernel->second.push_arg(part.ell.val);
+        } else {
+            kernel->second.push_arg(static_cast<void*>(0));
+            kernel->second.push_arg(static_cast<void*>(0));
+        }
+
+        if (part.csr.nnz) {
+            kernel->second.push_arg(part.csr.row);
+            kernel->second.push_arg(part.csr.col);
+            kernel->second.push_arg(part.csr.val);
+        } else {
+            kernel->second.push_arg(static_cast<void*>(0));
+            kernel->second.push_arg(static_cast<void*>(0));
+            kernel->second.push_arg(static_cast<void*>(0));
+        }
+
+        kernel->second.push_arg(in.stride);
+        kernel->second.push_arg(out.stride);
+
+        for(size_t k = 0; k < w; ++k) {
+            kernel->second.push_arg(*in.col[k]);
+            kernel->second.push_arg(in.off[k]);
+        }
+
+        for(size_t k = 0; k < w; ++k) {
+            kernel->second.push_arg(*out.col[k]);
+            kernel->second.push_arg(out.off[k]);
+        }
+
+        kernel->second(queue);
+    }
+
+    void mul_local(const block &in, const block &out,
+            scalar_type scale, bool append) const
+    {
+        if (append)
+            mul<assign::ADD>(loc, in, out, scale);
+        else
+            mul<assign::SET>(loc, in, out, scale);
+    }
+
+    void mul_remote(const block &in, const block &out,
+            scalar_type scale) const
+    {
+        mul<assign::ADD>(rem, in, out, scale);
+    }
+
+    void update_values(const backend::device_vector<val_t> &val) const {
+        std::vector< value_map<dev_idx_t> > parts;
+
+        if (loc.ell.width) parts.push_back(value_map<dev_idx_t>(pitch * loc.ell.width, loc.ell.map.device(queue), loc.ell.val));
+        if (loc.csr.nnz)   parts.push_back(value_map<dev_idx_t>(loc.csr.nnz,           loc.csr.map.device(queue), loc.csr.val));
+        if (rem.ell.width) parts.push_back(value_map<dev_idx_t>(pitch * rem.ell.width, rem.ell.map.device(queue), rem.ell.val));
+        if (rem.csr.nnz)   parts.push_back(value_map<dev_idx_t>(rem.csr.nnz,           rem.csr.map.device(queue), rem.csr.val));
+
+        scatter_values(queue, val, parts);
+    }
+
+    void get_entries(col_t col_begin, const std::vector<col_t> &ghost,
+            coo_entries &e) const
+    {
+        get_entries(loc, e, [col_begin](dev_col_t c) { return col_begin + c; });
+        get_entries(rem, e, [&ghost](dev_col_t c) { return ghost[c]; });
+    }
+
+    template <class ColumnMap>
+    void get_entries(const matrix_part &part, coo_entries &e, ColumnMap global) const {
+        const dev_col_t not_a_column = static_cast<dev_col_t>(-1);
+
+        std::vector<dev_col_t> ell_col(pitch * part.ell.width);
+        std::vector<store_t>   ell_val(pitch * part.ell.width);
+
+        std::vector<dev_idx_t> csr_row(part.csr.nnz ? n + 1 : 0);
+        std::vector<dev_col_t> csr_col(part.csr.nnz);
+        std::vector<store_t>   csr_val(part.csr.nnz);
+
+        if (part.ell.width) {
+            part.ell.col.read(queue, 0, ell_col.size(), ell_col.data());
+            part.ell.val.read(queue, 0, ell_val.size(), ell_val.data());
+        }
+
+        if (part.csr.nnz) {
+            part.csr.row.read(queue, 0, csr_row.size(), csr_row.data());
+            part.csr.col.read(queue, 0, csr_col.size(), csr_col.data());
+            part.csr.val.read(queue, 0, csr_val.size(), csr_val.data());
+        }
+
+        queue.finish();
+
+        for(size_t i = 0; i < n; ++i) {
+            for(size_t k = 0; k < part.ell.width; ++k) {
+                dev_col_t c = ell_col[i + k * pitch];
+                if (c != not_a_column) e.push_back(i, global(c), ell_val[i + k * pitch]);
+            }
+
+            if (part.csr.nnz)
+                for(size_t j = csr_row[i]; j < csr_row[i + 1]; ++j)
+                    e.push_back(i, global(csr_col[j]), csr_val[j]);
+        }
+    }
+
     static void inline_preamble(backend::source_generator &src,
         const std::string &prm_name)
     {
@@ -327,19 +677,19 @@ struct SpMatHELL : public sparse_matrix {
             .open("(")
                 .template parameter<size_t>("ell_w")
                 .template parameter<size_t>("ell_pitch")
-                .template parameter< global_ptr<const col_t> >("ell_col")
-                .template parameter< global_ptr<const val_t> >("ell_val")
-                .template parameter< global_ptr<const idx_t> >("csr_row")
-                .template parameter< global_ptr<const col_t> >("csr_col")
-                .template parameter< global_ptr<const val_t> >("csr_val")
+                .template parameter< global_ptr<const dev_col_t> >("ell_col")
+                .template parameter< global_ptr<const store_t> >("ell_val")
+                .template parameter< global_ptr<const dev_idx_t> >("csr_row")
+                .template parameter< global_ptr<const dev_col_t> >("csr_col")
+                .template parameter< global_ptr<const store_t> >("csr_val")
                 .template parameter< global_ptr<const val_t> >("in")
                 .template parameter< size_t >("i")
             .close(")").open("{");
         src.new_line() << type_name<val_t>() << " sum = 0;";
         src.new_line() << "for(size_t j = 0; j < ell_w; ++j)";
         src.open("{");
-        src.new_line() << type_name<col_t>() << " c = ell_col[i + j * ell_pitch];";
-        src.new_line() << "if (c != ("<< type_name<col_t>() << ")(-1))";
+        src.new_line() << type_name<dev_col_t>() << " c = ell_col[i + j * ell_pitch];";
+        src.new_line() << "if (c != ("<< type_name<dev_col_t>() << ")(-1))";
         src.open("{").new_line() << "sum += ell_val[i + j * ell_pitch] * in[c];";
         src.close("}").close("}");
         src.new_line() << "if (csr_row)";
@@ -352,17 +702,17 @@ struct SpMatHELL : public sparse_matrix {
     }
 
     static void inline_expression(backend::source_generator &src,
-            const std::string &prm_name)
+            const std::string &prm_name, const std::string &part = "")
     {
         src << prm_name << "_hell_spmv" << "("
-            << prm_name << "_ell_w, "
-            << prm_name << "_ell_pitch, "
-            << prm_name << "_ell_col, "
-            << prm_name << "_ell_val, "
-            << prm_name << "_csr_row, "
-            << prm_name << "_csr_col, "
-            << prm_name << "_csr_val, "
-            << prm_name << "_vec, idx)";
+            << prm_name << part << "_ell_w, "
+            << prm_name << part << "_ell_pitch, "
+            << prm_name << part << "_ell_col, "
+            << prm_name << part << "_ell_val, "
+            << prm_name << part << "_csr_row, "
+            << prm_name << part << "_csr_col, "
+            << prm_name << part << "_csr_val, "
+            << prm_name << part << "_vec, idx)";
     }
 
     static void inline_parameters(backend::source_generator &src,
@@ -370,34 +720,47 @@ struct SpMatHELL : public sparse_matrix {
     {
         src.template parameter<size_t>(prm_name) << "_ell_w";
         src.template parameter<size_t>(prm_name) << "_ell_pitch";
-        src.template parameter< global_ptr<const col_t> >(prm_name) << "_ell_col";
-        src.template parameter< global_ptr<const val_t> >(prm_name) << "_ell_val";
-        src.template parameter< global_ptr<const idx_t> >(prm_name) << "_csr_row";
-        src.template parameter< global_ptr<const col_t> >(prm_name) << "_csr_col";
-        src.template parameter< global_ptr<const val_t> >(prm_name) << "_csr_val";
-        src.template parameter< global_ptr<const val_t> >(prm_name) << "_vec";
+        src.template parameter< global_ptr<const dev_col_t> >(prm_name) << "_ell_col";
+        src.template parameter< global_ptr<const store_t> >(prm_name) << "_ell_val";
+        src.template parameter< global_ptr<const dev_idx_t> >(prm_name) << "_csr_row";
+        src.template parameter< global_ptr<const dev_col_t> >(prm_name) << "_csr_col";
+        src.template parameter< global_ptr<const store_t> >(prm_name) << "_csr_val";
+    }
+
+    void setArgs(backend::kernel &krn) const {
+        set_args(loc, krn);
     }
 
-    void setArgs(backend::kernel &krn, unsigned device, const vector<val_t> &x) const {
-        krn.push_arg(loc.ell.width);
+    void setRemoteArgs(backend::kernel &krn) const {
+        set_args(rem, krn);
+    }
+
+    void set_args(const matrix_part &part, backend::kernel &krn) const {
+        krn.push_arg(part.ell.width);
         krn.push_arg(pitch);
-        if (loc.ell.width) {
-            krn.push_arg(loc.ell.col);
-            krn.push_arg(loc.ell.val);
+        if (part.ell.width) {
+            krn.push_arg(part.ell.col);
+            krn.push_arg(part.ell.val);
         } else {
             krn.push_arg(static_cast<void*>(0));
             krn.push_arg(static_cast<void*>(0));
         }
-        if (loc.csr.nnz) {
-            krn.push_arg(loc.csr.row);
-            krn.push_arg(loc.csr.col);
-            krn.push_arg(loc.csr.val);
+        if (part.csr.nnz) {
+            krn.push_arg(part.csr.row);
+            krn.push_arg(part.csr.col);
+            krn.push_arg(part.csr.val);
         } else {
             krn.push_arg(static_cast<void*>(0));
             krn.push_arg(static_cast<void*>(0));
             krn.push_arg(static_cast<void*>(0));
         }
-        krn.push_arg(x(device));
+    }
+
+    static void null_args(backend::kernel &krn) {
+        krn.push_arg(static_cast<size_t>(0));
+        krn.push_arg(static_cast<size_t>(0));
+        for(int i = 0; i < 5; ++i)
+            krn.push_arg(static_cast<void*>(0));
     }
 };
 
@@ -47,7 +47,10 @@ struct inline_spmv : inline_spmv_terminal_expression {
     const M &A;
     const V &x;
 
-    inline_spmv(const M &A, const V &x) : A(A), x(x) {}
+    // Ghost values of x for matrices split between several devices.
+    std::shared_ptr<typename M::ghost_buffers> rx;
+
+    inline_spmv(const M &A, const V &x) : A(A), x(x), rx(A.inline_ghosts()) {}
 };
 /// \endcond
 
@@ -55,8 +58,13 @@ struct inline_spmv : inline_spmv_terminal_expression {
 /**
  * When applied to a matrix-vector product, the product becomes inlineable.
  * That is, it may be used in any vector expression (not just additive
- * expression). This is only possible in single-device contexts, so user has to
- * guarantee that.
+ * expression).
+ *
+ * In multi-device contexts, ghost values of x are exchanged between devices
+ * each time the expression is computed, before the kernels are launched, and
+ * the remote part of the matrix is applied to them inside the kernel. Each
+ * inlined product keeps ghost buffers of its own, so products of the same
+ * matrix with different vectors may be used in a single expression.
  *
  * Example:
  * \code
@@ -64,12 +72,10 @@ struct inline_spmv : inline_spmv_terminal_expression {
  * eps = sum( fabs(f - vex::make_inline(A * x)) );
  * \endcode
  */
-template <typename val_t, typename col_t, typename idx_t>
-inline_spmv< SpMat<val_t, col_t, idx_t>, vector<val_t> >
-make_inline(const additive_operator< SpMat<val_t, col_t, idx_t>, vector<val_t> > &base) {
-    precondition(base.x.nparts() == 1, "Can not inline multi-device SpMV operation.");
-
-    return inline_spmv< SpMat<val_t, col_t, idx_t>, vector<val_t> >(base.A, base.x);
+template <typename val_t, typename col_t, typename idx_t, typename store_t>
+inline_spmv< SpMat<val_t, col_t, idx_t, store_t>, vector<val_t> >
+make_inline(const additive_operator< SpMat<val_t, col_t, idx_t, store_t>, vector<val_t> > &base) {
+    return inline_spmv< SpMat<val_t, col_t, idx_t, store_t>, vector<val_t> >(base.A, base.x);
 }
 
 #ifdef VEXCL_MULTIVECTOR_HPP
@@ -102,12 +108,12 @@ struct mv_inline_spmv : mv_inline_spmv_terminal_expression {
  * eps = sum( fabs(f - vex::make_inline(A * x)) );
  * \endcode
  */
-template <typename val_t, typename col_t, typename idx_t, class V>
-mv_inline_spmv<SpMat<val_t, col_t, idx_t>, V>
-make_inline(const multiadditive_operator<SpMat<val_t, col_t, idx_t>, V> &base) {
+template <typename val_t, typename col_t, typename idx_t, typename store_t, class V>
+mv_inline_spmv<SpMat<val_t, col_t, idx_t, store_t>, V>
+make_inline(const multiadditive_operator<SpMat<val_t, col_t, idx_t, store_t>, V> &base) {
     precondition(base.x(0).nparts() == 1, "Can not inline multi-device SpMV operation.");
 
-    return mv_inline_spmv<SpMat<val_t, col_t, idx_t>, V>(base.A, base.x);
+    return mv_inline_spmv<SpMat<val_t, col_t, idx_t, store_t>, V>(base.A, base.x);
 }
 #endif
 
@@ -178,7 +184,7 @@ struct kernel_arg_setter< inline_spmv<M, V> > {
             detail::kernel_generator_state_ptr state)
     {
         M::inline_arguments(
-                kernel, part, index_offset, term.A, term.x, state
+                kernel, part, index_offset, term.A, term.x, term.rx.get(), state
                 );
     }
 };
@@ -0,0 +1,142 @@
+#ifndef VEXCL_SPMAT_POLYNOMIAL_HPP
+#define VEXCL_SPMAT_POLYNOMIAL_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2026 Denis Demidov <ddemidov@ksu.ru>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/spmat/polynomial.hpp
+ * \author Denis Demidov <ddemidov@ksu.ru>
+ * \brief  Chebyshev polynomial of a sparse matrix.
+ */
+
+#include <vexcl/temporary.hpp>
+
+namespace vex {
+
+/// Chebyshev polynomial of a sparse matrix.
+/**
+ * Computes \f$y = \sum_{k=0}^d c_k T_k(\hat A) x\f$, where \f$T_k\f$ are
+ * Chebyshev polynomials of the first kind, and
+ * \f$\hat A = (2A - (\lambda_{max} + \lambda_{min}) I) / (\lambda_{max} - \lambda_{min})\f$
+ * maps the spectrum interval of A onto [-1, 1]. Such polynomials are used
+ * as smoothers and polynomial preconditioners.
+ *
+ * The three-term recurrence
+ * \f$t_{k+1} = 2 \hat A t_k - t_{k-1}\f$ is evaluated together with the
+ * update of y by a single kernel per degree, with the matrix-vector
+ * product inlined into the kernel (see vex::make_inline()). The object
+ * provides apply(x, y) method, so that it may be used as a preconditioner:
+ * \code
+ * vex::chebyshev_polynomial<double> P(A, coef, lmin, lmax);
+ * P.apply(r, z);
+ * \endcode
+ */
+template <typename val_t, typename col_t = size_t, typename idx_t = size_t,
+          typename store_t = val_t>
+class chebyshev_polynomial {
+    public:
+        typedef val_t value_type;
+        typedef typename cl_scalar_of<val_t>::type scalar_type;
+        typedef SpMat<val_t, col_t, idx_t, store_t> matrix;
+
+        /// Constructor.
+        /**
+         * \param A    the matrix. Should outlive the polynomial.
+         * \param c    coefficients of the polynomial in Chebyshev basis.
+         * \param lmin lower bound of the spectrum of A.
+         * \param lmax upper bound of the spectrum of A.
+         */
+        chebyshev_polynomial(const matrix &A, const std::vector<scalar_type> &c,
+                scalar_type lmin, scalar_type lmax)
+            : A(A), c(c),
+              delta(2 / (lmax - lmin)), sigma((lmax + lmin) / (lmax - lmin))
+        {
+            precondition(!c.empty(), "Polynomial should have at least one coefficient");
+            precondition(lmax > lmin, "Empty spectrum interval");
+        }
+
+        /// Degree of the polynomial.
+        size_t degree() const {
+            return c.size() - 1;
+        }
+
+        /// Applies the polynomial.
+        /**
+         * Computes \f$y = p(A) x\f$. x and y should be different vectors.
+         */
+        void apply(const vector<val_t> &x, vector<val_t> &y) const {
+            precondition(std::addressof(x) != std::addressof(y),
+                    "Polynomial can not be applied in place");
+
+            if (c.size() == 1) {
+                y = c[0] * x;
+                return;
+            }
+
+            for(int i = 0; i < 3; ++i)
+                if (t[i].size() != x.size())
+                    t[i] = vector<val_t>(x.queue_list(), x.size());
+
+            // t_1 = \hat A x, y = c_0 x + c_1 t_1.
+            first(make_inline(A * x), x, y);
+
+            const vector<val_t> *prev = &x;
+            const vector<val_t> *curr = &t[0];
+
+            for(size_t k = 2; k < c.size(); ++k) {
+                vector<val_t> &next = t[(k - 1) % 3];
+
+                step(make_inline(A * (*curr)), *prev, *curr, next, y, c[k]);
+
+                prev = curr;
+                curr = &next;
+            }
+        }
+    private:
+        const matrix &A;
+        std::vector<scalar_type> c;
+        scalar_type delta, sigma;
+
+        // Three consecutive terms of the recurrence.
+        mutable vector<val_t> t[3];
+
+        template <class Ax>
+        void first(const Ax &ax, const vector<val_t> &x, vector<val_t> &y) const {
+            auto tn = make_temp<1>(delta * ax - sigma * x);
+            vex::tie(t[0], y) = std::tie(tn, c[0] * x + c[1] * tn);
+        }
+
+        template <class Ax>
+        void step(const Ax &ax, const vector<val_t> &prev, const vector<val_t> &curr,
+                vector<val_t> &next, vector<val_t> &y, scalar_type ck) const
+        {
+            auto tn = make_temp<1>(2 * delta * ax - 2 * sigma * curr - prev);
+            vex::tie(next, y) = std::tie(tn, y + ck * tn);
+        }
+};
+
+} // namespace vex
+
+#endif
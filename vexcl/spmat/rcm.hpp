@@ -0,0 +1,195 @@
+#ifndef VEXCL_SPMAT_RCM_HPP
+#define VEXCL_SPMAT_RCM_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2026 Denis Demidov <ddemidov@ksu.ru>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/spmat/rcm.hpp
+ * \author Denis Demidov <ddemidov@ksu.ru>
+ * \brief  Reverse Cuthill-McKee reordering of sparse matrices.
+ */
+
+#include <vector>
+#include <numeric>
+#include <algorithm>
+
+namespace vex {
+
+/// Ordering of rows and columns of a sparse matrix.
+enum class ordering {
+    natural, ///< The matrix is used as given.
+    rcm      ///< Reverse Cuthill-McKee ordering.
+};
+
+/// \cond INTERNAL
+namespace detail {
+
+// Adjacency graph of a square sparse matrix. Nonsymmetric patterns are
+// treated as A + A^T, so that edges of the transposed matrix are kept as
+// well.
+template <typename idx_t, typename col_t>
+class rcm_graph {
+    public:
+        rcm_graph(size_t n, const idx_t *row, const col_t *col)
+            : n(n), row(row), col(col), tptr(n + 1, 0), tcol(row[n]),
+              deg(n), stamp(n, 0), generation(0)
+        {
+            for(size_t i = 0; i < n; ++i)
+                for(size_t j = row[i]; j < static_cast<size_t>(row[i + 1]); ++j)
+                    ++tptr[col[j] + 1];
+
+            std::partial_sum(tptr.begin(), tptr.end(), tptr.begin());
+
+            std::vector<size_t> pos(tptr.begin(), tptr.end() - 1);
+            for(size_t i = 0; i < n; ++i)
+                for(size_t j = row[i]; j < static_cast<size_t>(row[i + 1]); ++j)
+                    tcol[pos[col[j]]++] = i;
+
+            for(size_t i = 0; i < n; ++i)
+                deg[i] = (row[i + 1] - row[i]) + (tptr[i + 1] - tptr[i]);
+        }
+
+        // Returns permutation p, such that row i of the reordered matrix is
+        // row p[i] of the original one.
+        std::vector<size_t> order() {
+            std::vector<size_t> perm;
+            perm.reserve(n);
+
+            std::vector<bool> done(n, false);
+            std::vector<size_t> nbr;
+
+            // Cuthill-McKee ordering of each connected component in turn.
+            for(size_t i = 0; i < n; ++i) {
+                if (done[i]) continue;
+
+                size_t head = perm.size();
+                perm.push_back(peripheral(i));
+                done[perm.back()] = true;
+
+                for(; head < perm.size(); ++head) {
+                    size_t v = perm[head];
+
+                    nbr.clear();
+                    for_each_neighbor(v, [&](size_t u) {
+                            if (!done[u]) {
+                                done[u] = true;
+                                nbr.push_back(u);
+                            }
+                            });
+
+                    std::stable_sort(nbr.begin(), nbr.end(),
+                            [&](size_t a, size_t b) { return deg[a] < deg[b]; });
+
+                    perm.insert(perm.end(), nbr.begin(), nbr.end());
+                }
+            }
+
+            std::reverse(perm.begin(), perm.end());
+            return perm;
+        }
+    private:
+        size_t n;
+        const idx_t *row;
+        const col_t *col;
+
+        std::vector<size_t> tptr;
+        std::vector<size_t> tcol;
+        std::vector<size_t> deg;
+
+        std::vector<size_t> stamp;
+        size_t generation;
+
+        std::vector<size_t> level;
+
+        template <class F>
+        void for_each_neighbor(size_t v, F &&f) const {
+            for(size_t j = row[v]; j < static_cast<size_t>(row[v + 1]); ++j)
+                f(static_cast<size_t>(col[j]));
+            for(size_t j = tptr[v]; j < tptr[v + 1]; ++j)
+                f(tcol[j]);
+        }
+
+        // Breadth-first search from root. Returns the depth of the level
+        // structure; the last level is left at the tail of the level array,
+        // starting at the returned offset.
+        size_t bfs(size_t root, size_t &last) {
+            ++generation;
+
+            level.clear();
+            level.push_back(root);
+            stamp[root] = generation;
+
+            size_t depth = 0;
+            last = 0;
+
+            for(size_t begin = 0, end = 1; begin < end; begin = end, end = level.size()) {
+                ++depth;
+                last = begin;
+
+                for(size_t k = begin; k < end; ++k) {
+                    for_each_neighbor(level[k], [&](size_t u) {
+                            if (stamp[u] != generation) {
+                                stamp[u] = generation;
+                                level.push_back(u);
+                            }
+                            });
+                }
+            }
+
+            return depth;
+        }
+
+        // Finds a pseudo-peripheral node of the component containing start
+        // (George-Liu algorithm).
+        size_t peripheral(size_t start) {
+            size_t root = start, last;
+            size_t depth = bfs(root, last);
+
+            for(;;) {
+                size_t cand = level[last];
+                for(size_t k = last + 1; k < level.size(); ++k)
+                    if (deg[level[k]] < deg[cand]) cand = level[k];
+
+                size_t d = bfs(cand, last);
+                if (d <= depth) return root;
+
+                root  = cand;
+                depth = d;
+            }
+        }
+};
+
+// Reverse Cuthill-McKee permutation of a square sparse matrix in CSR format.
+template <typename idx_t, typename col_t>
+std::vector<size_t> rcm(size_t n, const idx_t *row, const col_t *col) {
+    return rcm_graph<idx_t, col_t>(n, row, col).order();
+}
+
+} // namespace detail
+/// \endcond
+
+} // namespace vex
+
+#endif
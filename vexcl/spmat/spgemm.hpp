@@ -0,0 +1,216 @@
+#ifndef VEXCL_SPMAT_SPGEMM_HPP
+#define VEXCL_SPMAT_SPGEMM_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2026 Denis Demidov <ddemidov@ksu.ru>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/spmat/spgemm.hpp
+ * \author Denis Demidov <ddemidov@ksu.ru>
+ * \brief  Sparse matrix-matrix product on compute device.
+ */
+
+namespace vex {
+
+/// \cond INTERNAL
+namespace detail {
+
+// Expand step of the expand-sort-compress (ESC) algorithm: writes every
+// elementary product A(i,j) * B(j,k) as a COO triplet.
+template <typename val_t, typename col_t, typename idx_t>
+void spgemm_expand(
+        const vector<idx_t> &Aptr, const vector<col_t> &Acol, const vector<val_t> &Aval,
+        const vector<idx_t> &Bptr, const vector<col_t> &Bcol, const vector<val_t> &Bval,
+        vector<col_t> &row, vector<col_t> &col, vector<val_t> &val
+        )
+{
+    const std::vector<backend::command_queue> &queue = Aptr.queue_list();
+
+    precondition(queue.size() == 1,
+            "Sparse matrix-matrix product is only supported for single device contexts");
+
+    const size_t n   = Aptr.size() - 1;
+    const size_t nnz = Acol.size();
+
+    if (!nnz) {
+        row.resize(queue, 0);
+        col.resize(queue, 0);
+        val.resize(queue, 0);
+        return;
+    }
+
+    // Number of products contributed by each nonzero of A, and their
+    // positions in the expanded arrays.
+    vector<idx_t> cnt(queue, nnz);
+    vector<idx_t> off(queue, nnz);
+
+    cnt = permutation(Acol + 1)(Bptr) - permutation(Acol)(Bptr);
+    exclusive_scan(cnt, off);
+
+    const size_t total = static_cast<size_t>(off[nnz - 1]) + static_cast<size_t>(cnt[nnz - 1]);
+
+    row.resize(queue, total);
+    col.resize(queue, total);
+    val.resize(queue, total);
+
+    if (!total) return;
+
+    const backend::command_queue &q = queue[0];
+
+    static kernel_cache cache;
+
+    auto key    = backend::cache_key(q);
+    auto kernel = cache.find(key);
+
+    backend::select_context(q);
+
+    if (kernel == cache.end()) {
+        backend::source_generator src(q);
+
+        src.kernel("spgemm_expand")
+            .open("(")
+                .template parameter< size_t >("n")
+                .template parameter< global_ptr<const idx_t> >("Aptr")
+                .template parameter< global_ptr<const col_t> >("Acol")
+                .template parameter< global_ptr<const val_t> >("Aval")
+                .template parameter< global_ptr<const idx_t> >("Bptr")
+                .template parameter< global_ptr<const col_t> >("Bcol")
+                .template parameter< global_ptr<const val_t> >("Bval")
+                .template parameter< global_ptr<const idx_t> >("off")
+                .template parameter< global_ptr<col_t> >("row")
+                .template parameter< global_ptr<col_t> >("col")
+                .template parameter< global_ptr<val_t> >("val")
+            .close(")").open("{");
+
+        src.grid_stride_loop("i").open("{");
+        src.new_line() << "for(size_t j = Aptr[i], e = Aptr[i + 1]; j < e; ++j)";
+        src.open("{");
+        src.new_line() << type_name<val_t>() << " a = Aval[j];";
+        src.new_line() << type_name<col_t>() << " c = Acol[j];";
+        src.new_line() << "size_t o = off[j];";
+        src.new_line() << "for(size_t k = Bptr[c], f = Bptr[c + 1]; k < f; ++k, ++o)";
+        src.open("{");
+        src.new_line() << "row[o] = i;";
+        src.new_line() << "col[o] = Bcol[k];";
+        src.new_line() << "val[o] = a * Bval[k];";
+        src.close("}");
+        src.close("}");
+        src.close("}");
+
+        src.close("}");
+
+        backend::kernel krn(q, src.str(), "spgemm_expand");
+        kernel = cache.insert(std::make_pair(key, krn)).first;
+    }
+
+    kernel->second.push_arg(n);
+    kernel->second.push_arg(Aptr(0));
+    kernel->second.push_arg(Acol(0));
+    kernel->second.push_arg(Aval(0));
+    kernel->second.push_arg(Bptr(0));
+    kernel->second.push_arg(Bcol(0));
+    kernel->second.push_arg(Bval(0));
+    kernel->second.push_arg(off(0));
+    kernel->second.push_arg(row(0));
+    kernel->second.push_arg(col(0));
+    kernel->second.push_arg(val(0));
+
+    kernel->second(q);
+}
+
+} // namespace detail
+/// \endcond
+
+/// Sparse matrix-matrix product.
+/**
+ * Computes \f$C = AB\f$, where all matrices are stored in CSR format on a
+ * single compute device. The product is formed with the expand-sort-compress
+ * algorithm: elementary products are expanded into COO triplets, sorted with
+ * sort_by_key(), and duplicate entries are summed with reduce_by_key(). The
+ * matrices never leave the device, so that e.g. Galerkin operators
+ * \f$RAP\f$ for multigrid hierarchies may be built with two products.
+ *
+ * \param Aptr, Acol, Aval CSR arrays of the left matrix (n rows).
+ * \param Bptr, Bcol, Bval CSR arrays of the right matrix.
+ * \param m    number of columns in the right matrix.
+ * \param Cptr, Ccol, Cval CSR arrays of the product (resized as needed).
+ */
+template <typename val_t, typename col_t, typename idx_t>
+void spgemm(
+        const vector<idx_t> &Aptr, const vector<col_t> &Acol, const vector<val_t> &Aval,
+        const vector<idx_t> &Bptr, const vector<col_t> &Bcol, const vector<val_t> &Bval,
+        size_t m,
+        vector<idx_t> &Cptr, vector<col_t> &Ccol, vector<val_t> &Cval
+        )
+{
+    const std::vector<backend::command_queue> &queue = Aptr.queue_list();
+    const size_t n = Aptr.size() - 1;
+
+    vector<col_t> row, col;
+    vector<val_t> val;
+
+    detail::spgemm_expand(Aptr, Acol, Aval, Bptr, Bcol, Bval, row, col, val);
+
+    backend::device_vector<idx_t> ptr;
+    backend::device_vector<col_t> c;
+
+    size_t nnz = detail::coo_to_csr(queue, n, m, row, col, val, ptr, c, Cval);
+
+    Cptr = vector<idx_t>(queue[0], ptr);
+
+    if (nnz) {
+        Ccol = vector<col_t>(queue[0], c);
+    } else {
+        Ccol.resize(queue, 0);
+        Cval.resize(queue, 0);
+    }
+}
+
+#if defined(VEXCL_BACKEND_OPENCL) || !defined(VEXCL_USE_CUSPARSE)
+/// Sparse matrix-matrix product.
+/**
+ * Same as above, but returns the product as vex::SpMat, ready to be used
+ * in matrix-vector products. The expanded triplets are passed to the
+ * device-side COO constructor of vex::SpMat, which sorts and compresses
+ * them.
+ */
+template <typename val_t, typename col_t, typename idx_t>
+SpMat<val_t, col_t, idx_t> spgemm(
+        const vector<idx_t> &Aptr, const vector<col_t> &Acol, const vector<val_t> &Aval,
+        const vector<idx_t> &Bptr, const vector<col_t> &Bcol, const vector<val_t> &Bval,
+        size_t m
+        )
+{
+    vector<col_t> row, col;
+    vector<val_t> val;
+
+    detail::spgemm_expand(Aptr, Acol, Aval, Bptr, Bcol, Bval, row, col, val);
+
+    return SpMat<val_t, col_t, idx_t>(Aptr.queue_list(), Aptr.size() - 1, m, row, col, val);
+}
+#endif
+
+} // namespace vex
+
+#endif
@@ -0,0 +1,309 @@
+#ifndef VEXCL_SPMAT_TRIANGULAR_HPP
+#define VEXCL_SPMAT_TRIANGULAR_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2026 Denis Demidov <ddemidov@ksu.ru>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/spmat/triangular.hpp
+ * \author Denis Demidov <ddemidov@ksu.ru>
+ * \brief  Sparse triangular solver with level scheduling.
+ */
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <type_traits>
+
+namespace vex {
+
+/// Triangle of a sparse matrix.
+enum class triangle {
+    lower, ///< Entries on and below the diagonal.
+    upper  ///< Entries on and above the diagonal.
+};
+
+/// Sparse triangular solver.
+/**
+ * Solves \f$Tx = b\f$, where T is the lower or the upper triangle of a
+ * sparse matrix given in CSR format (the same arrays vex::SpMat is
+ * constructed from). Entries of the other triangle are ignored, so that
+ * both factors of an incomplete LU factorization stored in a single CSR
+ * matrix may be applied with two solvers:
+ * \code
+ * vex::sparse_triangular_solver<double> L(ctx, n, row, col, val, vex::triangle::lower, true);
+ * vex::sparse_triangular_solver<double> U(ctx, n, row, col, val, vex::triangle::upper);
+ *
+ * L.apply(r, t); // t = L^-1 r
+ * U.apply(t, z); // z = U^-1 t
+ * \endcode
+ * With the CSR arrays of the system matrix itself, a lower triangle solve is
+ * a forward Gauss-Seidel sweep with zero initial approximation.
+ *
+ * Rows are grouped into levels at setup: a row belongs to the level next to
+ * the deepest level of the rows it depends on, so that rows of a level are
+ * independent and may be processed in parallel. The matrix is stored on the
+ * device in level order, with the inverted diagonal kept separately, and a
+ * kernel is launched per level. Only single-device contexts are supported.
+ */
+template <typename val_t, typename col_t = size_t, typename idx_t = size_t>
+class sparse_triangular_solver {
+    public:
+        typedef val_t value_type;
+
+        /// Type of column numbers stored on compute devices.
+        typedef typename std::conditional<
+            (sizeof(col_t) > sizeof(cl_uint)), cl_uint, col_t
+            >::type dev_col_t;
+
+        /// Type of row pointers stored on compute devices.
+        typedef typename std::conditional<
+            (sizeof(idx_t) > sizeof(cl_uint)), cl_uint, idx_t
+            >::type dev_idx_t;
+
+        /// Constructor.
+        /**
+         * \param queue vector of queues (should contain single queue).
+         * \param n     number of rows in the matrix.
+         * \param row   row index into col and val vectors.
+         * \param col   column numbers of nonzero elements of the matrix.
+         * \param val   values of nonzero elements of the matrix.
+         * \param tri   triangle of the matrix to solve with.
+         * \param unit_diagonal when set, the diagonal is assumed to consist
+         *              of ones and diagonal entries of the matrix are ignored.
+         *              Otherwise each row should have a diagonal entry.
+         */
+        sparse_triangular_solver(
+                const std::vector<backend::command_queue> &queue,
+                size_t n, const idx_t *row, const col_t *col, const val_t *val,
+                triangle tri = triangle::lower, bool unit_diagonal = false
+                )
+            : queue(queue), n(n), nnz(0)
+        {
+            precondition(queue.size() == 1,
+                    "Sparse triangular solver is only supported for single device contexts");
+
+            precondition(fits<dev_col_t>(n) && fits<dev_idx_t>(static_cast<size_t>(row[n])),
+                    "Matrix is too large for the device index types");
+
+            if (!n) return;
+
+            const bool lower = tri == triangle::lower;
+
+            // Level of each row.
+            std::vector<size_t> level(n, 0);
+            size_t nlev = 0;
+
+            for(size_t k = 0; k < n; ++k) {
+                size_t i = lower ? k : n - 1 - k;
+                size_t l = 0;
+
+                for(size_t j = row[i]; j < static_cast<size_t>(row[i + 1]); ++j) {
+                    size_t c = static_cast<size_t>(col[j]);
+                    if (lower ? c < i : c > i) l = std::max(l, level[c] + 1);
+                }
+
+                level[i] = l;
+                nlev = std::max(nlev, l + 1);
+            }
+
+            // Rows sorted by level.
+            lptr.assign(nlev + 1, 0);
+            for(size_t i = 0; i < n; ++i) ++lptr[level[i] + 1];
+            std::partial_sum(lptr.begin(), lptr.end(), lptr.begin());
+
+            std::vector<dev_col_t> order(n);
+            {
+                std::vector<size_t> pos(lptr.begin(), lptr.end() - 1);
+                for(size_t i = 0; i < n; ++i)
+                    order[pos[level[i]]++] = static_cast<dev_col_t>(i);
+            }
+
+            // Off-diagonal entries of the triangle in level order, and
+            // inverted diagonal.
+            std::vector<dev_idx_t> p(n + 1);
+            std::vector<dev_col_t> c;
+            std::vector<val_t>     v;
+            std::vector<val_t>     d(n, static_cast<val_t>(1));
+
+            c.reserve(row[n]);
+            v.reserve(row[n]);
+
+            p[0] = 0;
+            for(size_t r = 0; r < n; ++r) {
+                size_t i = order[r];
+                bool has_diagonal = false;
+
+                for(size_t j = row[i]; j < static_cast<size_t>(row[i + 1]); ++j) {
+                    size_t k = static_cast<size_t>(col[j]);
+
+                    if (k == i) {
+                        if (!unit_diagonal) d[r] = 1 / val[j];
+                        has_diagonal = true;
+                    } else if (lower ? k < i : k > i) {
+                        c.push_back(static_cast<dev_col_t>(k));
+                        v.push_back(val[j]);
+                    }
+                }
+
+                precondition(unit_diagonal || has_diagonal,
+                        "Missing diagonal entry in sparse triangular solver");
+
+                p[r + 1] = static_cast<dev_idx_t>(c.size());
+            }
+
+            const backend::command_queue &q = queue[0];
+
+            this->ord = backend::device_vector<dev_col_t>(q, n, order.data(), backend::MEM_READ_ONLY);
+            this->ptr = backend::device_vector<dev_idx_t>(q, n + 1, p.data(), backend::MEM_READ_ONLY);
+            this->dia = backend::device_vector<val_t>(q, n, d.data(), backend::MEM_READ_ONLY);
+
+            nnz = c.size();
+
+            if (nnz) {
+                this->col = backend::device_vector<dev_col_t>(q, c.size(), c.data(), backend::MEM_READ_ONLY);
+                this->val = backend::device_vector<val_t>(q, v.size(), v.data(), backend::MEM_READ_ONLY);
+            }
+        }
+
+        /// Number of rows in the matrix.
+        size_t rows() const {
+            return n;
+        }
+
+        /// Number of levels (kernel launches per solve).
+        size_t levels() const {
+            return lptr.empty() ? 0 : lptr.size() - 1;
+        }
+
+        /// Solves the system.
+        /**
+         * Computes \f$x = T^{-1} b\f$. The solve may be done in place, with
+         * x and rhs being the same vector.
+         */
+        void apply(const vex::vector<val_t> &rhs, vex::vector<val_t> &x) const {
+            using namespace detail;
+
+            precondition(rhs.nparts() == 1 && x.nparts() == 1,
+                    "Sparse triangular solver does not support multi-device computation");
+            precondition(rhs.size() == n && x.size() == n, "Incompatible vector sizes");
+
+            if (!n) return;
+
+            const backend::command_queue &q = queue[0];
+
+            static kernel_cache cache;
+
+            auto key    = backend::cache_key(q);
+            auto kernel = cache.find(key);
+
+            backend::select_context(q);
+
+            if (kernel == cache.end()) {
+                backend::source_generator src(q);
+
+                src.kernel("sparse_trsv")
+                    .open("(")
+                        .template parameter< size_t                      >("n")
+                        .template parameter< size_t                      >("start")
+                        .template parameter< global_ptr<const dev_col_t> >("ord")
+                        .template parameter< global_ptr<const dev_idx_t> >("ptr")
+                        .template parameter< global_ptr<const dev_col_t> >("col")
+                        .template parameter< global_ptr<const val_t>     >("val")
+                        .template parameter< global_ptr<const val_t>     >("dia")
+                        .template parameter< global_ptr<const val_t>     >("rhs")
+                        .template parameter< global_ptr<val_t>           >("x")
+                    .close(")").open("{");
+
+                src.grid_stride_loop().open("{");
+                src.new_line() << "size_t r = start + idx;";
+                src.new_line() << "size_t i = ord[r];";
+                src.new_line() << type_name<val_t>() << " s = rhs[i];";
+                src.new_line() << "for(size_t j = ptr[r], e = ptr[r + 1]; j < e; ++j) s -= val[j] * x[col[j]];";
+                src.new_line() << "x[i] = s * dia[r];";
+                src.close("}");
+
+                src.close("}");
+
+                backend::kernel krn(q, src.str(), "sparse_trsv");
+                kernel = cache.insert(std::make_pair(key, krn)).first;
+            }
+
+            backend::kernel &K = kernel->second;
+
+            // Levels are often narrow, so only as many workgroups as there
+            // are rows in a level are launched.
+            size_t wgs = K.workgroup_size();
+            size_t ngr = backend::kernel::num_workgroups(q);
+
+            for(size_t l = 0; l + 1 < lptr.size(); ++l) {
+                size_t start = lptr[l];
+                size_t size  = lptr[l + 1] - start;
+
+                K.config(std::min(ngr, (size + wgs - 1) / wgs), wgs);
+
+                K.push_arg(size);
+                K.push_arg(start);
+                K.push_arg(ord);
+                K.push_arg(ptr);
+
+                if (nnz) {
+                    K.push_arg(col);
+                    K.push_arg(val);
+                } else {
+                    K.push_arg(static_cast<void*>(0));
+                    K.push_arg(static_cast<void*>(0));
+                }
+                K.push_arg(dia);
+                K.push_arg(rhs(0));
+                K.push_arg(x(0));
+
+                K(q);
+            }
+        }
+    private:
+        std::vector<backend::command_queue> queue;
+        size_t n;
+
+        // Number of off-diagonal entries in the triangle.
+        size_t nnz;
+
+        std::vector<size_t> lptr;
+
+        backend::device_vector<dev_col_t> ord;
+        backend::device_vector<dev_idx_t> ptr;
+        backend::device_vector<dev_col_t> col;
+        backend::device_vector<val_t>     val;
+        backend::device_vector<val_t>     dia;
+
+        template <typename T>
+        static bool fits(size_t n) {
+            return n < static_cast<size_t>(std::numeric_limits<T>::max());
+        }
+};
+
+} // namespace vex
+
+#endif
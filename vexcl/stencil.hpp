@@ -33,12 +33,23 @@ THE SOFTWARE.
 
 #include <vector>
 #include <map>
+#include <memory>
+#include <string>
 #include <sstream>
+#include <iomanip>
+#include <limits>
+#include <type_traits>
 #include <cassert>
 #include <vexcl/vector.hpp>
 
 namespace vex {
 
+/// How coefficients of vex::stencil are passed to the convolution kernel.
+enum class stencil_coefficients {
+    runtime, ///< Coefficients are read from a device buffer.
+    inlined  ///< Coefficients are compiled into the kernel as literals.
+};
+
 template <typename T>
 class stencil_base {
     protected:
@@ -48,16 +59,58 @@ class stencil_base {
                 unsigned width, unsigned center, Iterator begin, Iterator end
                 );
 
-        void exchange_halos(const vex::vector<T> &x) const;
+        void exchange_halos(const vex::vector<T> &x) const {
+            sync_halo_queues();
+            exchange_halos(x, lhalo, rhalo, dbuf, hbuf);
+        }
+
+        // Makes the secondary queues wait for the commands already
+        // submitted to the primary ones, so that halos are read from the
+        // up-to-date input. Commands submitted to the primary queues after
+        // this call may run concurrently with the halo exchange.
+        void sync_halo_queues() const;
+
+        // Gathers halos of the given widths into buf (of size lh + rh per
+        // device), using hb as a host-side staging area. Transfers are
+        // done on the secondary queues; sync_halo_queues() should be
+        // called first.
+        void exchange_halos(const vex::vector<T> &x, int lh, int rh,
+                const std::vector< backend::device_vector<T> > &buf,
+                std::vector<T> &hb) const;
+
+        // Range [lo, hi) of the d-th partition of size psize that does not
+        // depend on halos from other devices.
+        void interior(unsigned d, size_t psize, size_t &lo, size_t &hi) const {
+            bool exchange = queue.size() > 1 && lhalo + rhalo > 0;
+
+            lo = (exchange && d > 0) ? std::min<size_t>(lhalo, psize) : 0;
+            hi = (exchange && d + 1 < queue.size()) ?
+                std::max(lo, psize - std::min<size_t>(rhalo, psize)) : psize;
+        }
+
+        // Copies x[begin, end) into buf[d] starting at pos.
+        void copy_halo(const vex::vector<T> &x,
+                const std::vector< backend::device_vector<T> > &buf, unsigned d,
+                size_t begin, size_t end, size_t pos) const;
+
+        // Reads x[begin, end) to host memory over the secondary queues.
+        void read_halo(const vex::vector<T> &x,
+                size_t begin, size_t end, T *dst) const;
 
         const std::vector<backend::command_queue> &queue;
 
+        // Secondary queues for halo transfers.
+        std::vector<backend::command_queue> squeue;
+
         mutable std::vector<T>  hbuf;
         std::vector< backend::device_vector<T> > dbuf;
         std::vector< backend::device_vector<T> > s;
 
         int lhalo;
         int rhalo;
+
+        // Halos are copied directly between devices sharing a context.
+        bool direct;
 };
 
 template <typename T> template <class Iterator>
@@ -67,7 +120,7 @@ stencil_base<T>::stencil_base(
         )
     : queue(queue), hbuf(queue.size() * (width - 1)),
       dbuf(queue.size()), s(queue.size()),
-      lhalo(center), rhalo(width - center - 1)
+      lhalo(center), rhalo(width - center - 1), direct(queue.size() > 1)
 {
     assert(queue.size());
     assert(lhalo >= 0);
@@ -75,6 +128,13 @@ stencil_base<T>::stencil_base(
     assert(width);
     assert(center < width);
 
+    for(unsigned d = 1; d < queue.size(); d++)
+        if (!backend::is_same_context(queue[0], queue[d])) direct = false;
+
+    if (queue.size() > 1)
+        for(unsigned d = 0; d < queue.size(); d++)
+            squeue.push_back(backend::duplicate_queue(queue[d]));
+
     for(unsigned d = 0; d < queue.size(); d++) {
         if (begin != end)
             s[d] = backend::device_vector<T>(queue[d], end - begin, &begin[0], backend::MEM_READ_ONLY);
@@ -87,66 +147,152 @@ stencil_base<T>::stencil_base(
 }
 
 template <typename T>
-void stencil_base<T>::exchange_halos(const vex::vector<T> &x) const {
-    int width = lhalo + rhalo;
+void stencil_base<T>::sync_halo_queues() const {
+    if (squeue.empty()) return;
+
+    if (direct) {
+        // Halos are copied from all devices of the shared context.
+        std::vector<backend::event> ready;
+        for(unsigned d = 0; d < queue.size(); d++)
+            ready.push_back(backend::enqueue_marker(queue[d]));
+
+        for(unsigned d = 0; d < queue.size(); d++)
+            backend::enqueue_wait(squeue[d], ready);
+    } else {
+        for(unsigned d = 0; d < queue.size(); d++)
+            backend::enqueue_wait(squeue[d],
+                    std::vector<backend::event>(1, backend::enqueue_marker(queue[d])));
+    }
+}
+
+template <typename T>
+void stencil_base<T>::exchange_halos(const vex::vector<T> &x, int lh, int rh,
+        const std::vector< backend::device_vector<T> > &buf,
+        std::vector<T> &hb) const
+{
+    int width = lh + rh;
 
     if ((queue.size() <= 1) || (width <= 0)) return;
 
+    if (direct) {
+        for(unsigned d = 0; d < queue.size(); d++) {
+            if (!x.part_size(d)) continue;
+
+            // Get halo from left neighbour, pad it with x[0] if needed.
+            if (d > 0 && lh > 0) {
+                size_t end   = x.part_start(d);
+                size_t begin = end >= static_cast<unsigned>(lh) ?  end - lh : 0;
+                size_t size  = end - begin;
+
+                copy_halo(x, buf, d, begin, end, lh - size);
+
+                for(size_t i = 0; i < lh - size; i++)
+                    copy_halo(x, buf, d, 0, 1, i);
+            }
+
+            // Get halo from right neighbour, pad it with x[n-1] if needed.
+            if (d + 1 < queue.size() && rh > 0) {
+                size_t begin = x.part_start(d + 1);
+                size_t end   = std::min(begin + rh, x.size());
+                size_t size  = end - begin;
+
+                copy_halo(x, buf, d, begin, end, lh);
+
+                for(size_t i = lh + size; i < static_cast<size_t>(width); i++)
+                    copy_halo(x, buf, d, x.size() - 1, x.size(), i);
+            }
+        }
+
+        // Wait for the end of transfer.
+        for(unsigned d = 0; d < queue.size(); d++) squeue[d].finish();
+
+        return;
+    }
+
     // Get halos from neighbours.
     for(unsigned d = 0; d < queue.size(); d++) {
         if (!x.part_size(d)) continue;
 
         // Get halo from left neighbour.
-        if (d > 0 && lhalo > 0) {
+        if (d > 0 && lh > 0) {
             size_t end   = x.part_start(d);
-            size_t begin = end >= static_cast<unsigned>(lhalo) ?  end - lhalo : 0;
+            size_t begin = end >= static_cast<unsigned>(lh) ?  end - lh : 0;
             size_t size  = end - begin;
-            x.read_data(begin, size, &hbuf[d * width + lhalo - size], false);
+            read_halo(x, begin, end, &hb[d * width + lh - size]);
         }
 
         // Get halo from right neighbour.
-        if (d + 1 < queue.size() && rhalo > 0) {
+        if (d + 1 < queue.size() && rh > 0) {
             size_t begin = x.part_start(d + 1);
-            size_t end   = std::min(begin + rhalo, x.size());
-            size_t size  = end - begin;
-            x.read_data(begin, size, &hbuf[d * width + lhalo], false);
+            size_t end   = std::min(begin + rh, x.size());
+            read_halo(x, begin, end, &hb[d * width + lh]);
         }
     }
 
     // Wait for the end of transfer.
-    for(unsigned d = 0; d < queue.size(); d++) queue[d].finish();
+    for(unsigned d = 0; d < queue.size(); d++) squeue[d].finish();
 
     // Write halos to a local buffer.
     for(unsigned d = 0; d < queue.size(); d++) {
         if (!x.part_size(d)) continue;
 
-        if (d > 0 && lhalo > 0) {
+        if (d > 0 && lh > 0) {
             size_t end   = x.part_start(d);
-            size_t begin = end >= static_cast<unsigned>(lhalo) ?  end - lhalo : 0;
+            size_t begin = end >= static_cast<unsigned>(lh) ?  end - lh : 0;
             size_t size  = end - begin;
             if (size)
-                std::fill(&hbuf[d * width], &hbuf[d * width + lhalo - size], hbuf[d * width + lhalo - size]);
+                std::fill(&hb[d * width], &hb[d * width + lh - size], hb[d * width + lh - size]);
             else
-                std::fill(&hbuf[d * width], &hbuf[d * width + lhalo - size], static_cast<T>(x[0]));
+                std::fill(&hb[d * width], &hb[d * width + lh - size], static_cast<T>(x[0]));
         }
 
-        if (d + 1 < queue.size() && rhalo > 0) {
+        if (d + 1 < queue.size() && rh > 0) {
             size_t begin = x.part_start(d + 1);
-            size_t end   = std::min(begin + rhalo, x.size());
+            size_t end   = std::min(begin + rh, x.size());
             size_t size  = end - begin;
             if (size)
-                std::fill(&hbuf[d * width + lhalo + size], &hbuf[(d + 1) * width], hbuf[d * width + lhalo + size - 1]);
+                std::fill(&hb[d * width + lh + size], &hb[(d + 1) * width], hb[d * width + lh + size - 1]);
             else
-                std::fill(&hbuf[d * width + lhalo + size], &hbuf[(d + 1) * width], static_cast<T>(x[x.size()-1]));
+                std::fill(&hb[d * width + lh + size], &hb[(d + 1) * width], static_cast<T>(x[x.size()-1]));
 
         }
 
-        if ((d > 0 && lhalo > 0) || (d + 1 < queue.size() && rhalo > 0))
-            dbuf[d].write(queue[d], 0, width, &hbuf[d * width]);
+        if ((d > 0 && lh > 0) || (d + 1 < queue.size() && rh > 0))
+            buf[d].write(squeue[d], 0, width, &hb[d * width]);
     }
 
     // Wait for the end of transfer.
-    for(unsigned d = 0; d < queue.size(); d++) queue[d].finish();
+    for(unsigned d = 0; d < queue.size(); d++) squeue[d].finish();
+}
+
+template <typename T>
+void stencil_base<T>::copy_halo(const vex::vector<T> &x,
+        const std::vector< backend::device_vector<T> > &buf, unsigned d,
+        size_t begin, size_t end, size_t pos) const
+{
+    // The range may span several devices.
+    for(unsigned p = 0; p < queue.size() && begin < end; p++) {
+        size_t b = std::max(begin, x.part_start(p));
+        size_t e = std::min(end,   x.part_start(p) + x.part_size(p));
+
+        if (b < e)
+            buf[d].copy_from(squeue[d], x(p),
+                    b - x.part_start(p), pos + b - begin, e - b);
+    }
+}
+
+template <typename T>
+void stencil_base<T>::read_halo(const vex::vector<T> &x,
+        size_t begin, size_t end, T *dst) const
+{
+    // The range may span several devices.
+    for(unsigned p = 0; p < queue.size() && begin < end; p++) {
+        size_t b = std::max(begin, x.part_start(p));
+        size_t e = std::min(end,   x.part_start(p) + x.part_size(p));
+
+        if (b < e)
+            x(p).read(squeue[p], b - x.part_start(p), e - b, dst + b - begin, false);
+    }
 }
 
 /// \endcond
@@ -177,14 +323,17 @@ class stencil : private stencil_base<T> {
          *               compute device.
          * \param st     vector holding stencil values.
          * \param center center of the stencil.
+         * \param mode   whether the coefficients are compiled into the
+         *               kernel (see stencil_coefficients).
          */
         stencil(const std::vector<backend::command_queue> &queue,
-                const std::vector<T> &st, unsigned center
+                const std::vector<T> &st, unsigned center,
+                stencil_coefficients mode = stencil_coefficients::runtime
                 )
             : stencil_base<T>(queue, static_cast<unsigned>(st.size()), center, st.begin(), st.end()),
-              conv(queue.size()), smem(queue.size())
+              conv(queue.size()), smem(queue.size()), kbuf_k(0), kbuf(queue.size())
         {
-            init(static_cast<unsigned>(st.size()));
+            init(st.begin(), st.end(), mode);
         }
 
         /// Costructor.
@@ -194,15 +343,18 @@ class stencil : private stencil_base<T> {
          * \param begin  iterator to begin of sequence holding stencil data.
          * \param end    iterator to end of sequence holding stencil data.
          * \param center center of the stencil.
+         * \param mode   whether the coefficients are compiled into the
+         *               kernel (see stencil_coefficients).
          */
         template <class Iterator>
         stencil(const std::vector<backend::command_queue> &queue,
-                Iterator begin, Iterator end, unsigned center
+                Iterator begin, Iterator end, unsigned center,
+                stencil_coefficients mode = stencil_coefficients::runtime
                 )
             : stencil_base<T>(queue, static_cast<unsigned>(end - begin), center, begin, end),
-              conv(queue.size()), smem(queue.size())
+              conv(queue.size()), smem(queue.size()), kbuf_k(0), kbuf(queue.size())
         {
-            init(static_cast<unsigned>(end - begin));
+            init(begin, end, mode);
         }
 
 #ifndef BOOST_NO_INITIALIZER_LISTS
@@ -212,14 +364,17 @@ class stencil : private stencil_base<T> {
          *               compute device.
          * \param list   intializer list holding stencil values.
          * \param center center of the stencil.
+         * \param mode   whether the coefficients are compiled into the
+         *               kernel (see stencil_coefficients).
          */
         stencil(const std::vector<backend::command_queue> &queue,
-                std::initializer_list<T> list, unsigned center
+                std::initializer_list<T> list, unsigned center,
+                stencil_coefficients mode = stencil_coefficients::runtime
                 )
             : stencil_base<T>(queue, list.size(), center, list.begin(), list.end()),
-              conv(queue.size()), smem(queue.size())
+              conv(queue.size()), smem(queue.size()), kbuf_k(0), kbuf(queue.size())
         {
-            init(list.size());
+            init(list.begin(), list.end(), mode);
         }
 #endif
 
@@ -234,6 +389,20 @@ class stencil : private stencil_base<T> {
          */
         void apply(const vex::vector<T> &x, vex::vector<T> &y,
                 T alpha = 1, bool append = false) const;
+
+        /// Applies the stencil k times in a row.
+        /**
+         * y = conv(conv(...conv(x))), with k convolutions. On GPUs, each
+         * workgroup loads a tile of x with halos k times wider than the
+         * stencil into local memory and performs all k sweeps there, so that
+         * x is read and y is written only once. In multi-device contexts the
+         * halos are exchanged once for the k sweeps. Falls back to k calls
+         * to apply() on CPUs, or when the tile does not fit into local memory.
+         * \param x input vector.
+         * \param y output vector (should not be the same as x).
+         * \param k number of sweeps.
+         */
+        void apply_k(const vex::vector<T> &x, vex::vector<T> &y, unsigned k) const;
     private:
         typedef stencil_base<T> Base;
 
@@ -247,10 +416,20 @@ class stencil : private stencil_base<T> {
         mutable std::vector<backend::kernel> conv;
         std::vector<size_t>  smem;
 
-        void init(unsigned width);
+        // Halo buffers for apply_k(), sized for kbuf_k sweeps.
+        mutable unsigned kbuf_k;
+        mutable std::vector<T> khbuf;
+        mutable std::vector< backend::device_vector<T> > kbuf;
+
+        template <class Iterator>
+        void init(Iterator begin, Iterator end, stencil_coefficients mode);
 
         static const detail::kernel_cache_entry& slow_conv(const backend::command_queue &queue);
         static const detail::kernel_cache_entry& fast_conv(const backend::command_queue &queue);
+        static const detail::kernel_cache_entry& sweep_conv(const backend::command_queue &queue);
+
+        static backend::kernel inlined_conv(const backend::command_queue &queue,
+                bool fast, const std::vector<T> &coef, int lhalo);
 };
 
 /// \cond INTERNAL
@@ -288,6 +467,66 @@ inline void define_read_x(backend::source_generator &source) {
     source.close("}").close("}");
 }
 
+template <typename T>
+std::string stencil_literal(T v) {
+    std::ostringstream s;
+    s << "( " << std::scientific
+      << std::setprecision(std::numeric_limits<T>::max_digits10) << v
+      << (std::is_same<T, float>::value ? "f" : "") << " )";
+    return s.str();
+}
+
+// Unrolled convolution sum with the coefficients as literals. term(j)
+// returns the expression for the input element at offset j from the
+// current one. Zero coefficients are skipped, unit coefficients are not
+// multiplied by, and symmetric (antisymmetric) pairs of coefficients share
+// a single multiplication.
+template <typename T, class Term>
+typename std::enable_if<std::is_arithmetic<T>::value, std::string>::type
+inlined_stencil_sum(const std::vector<T> &coef, int lhalo, Term &&term) {
+    const int width = static_cast<int>(coef.size());
+
+    std::vector<bool> done(width, false);
+    std::ostringstream sum;
+
+    for(int k = 0; k < width; ++k) {
+        const T c = coef[k];
+        if (done[k] || c == T(0)) continue;
+
+        const int j = k - lhalo;
+        const int m = lhalo - j;
+
+        std::string x = term(j);
+        if (j != 0 && m > k && m < width) {
+            if (coef[m] == c) {
+                x = term(j) + " + " + term(-j);
+                done[m] = true;
+            } else if (coef[m] == -c) {
+                x = term(j) + " - " + term(-j);
+                done[m] = true;
+            }
+        }
+
+        if (sum.tellp()) sum << " + ";
+
+        if (c == T(1))
+            sum << "(" << x << ")";
+        else if (c == T(-1))
+            sum << "-(" << x << ")";
+        else
+            sum << stencil_literal(c) << " * (" << x << ")";
+    }
+
+    return sum.tellp() ? sum.str() : std::string("0");
+}
+
+template <typename T, class Term>
+typename std::enable_if<!std::is_arithmetic<T>::value, std::string>::type
+inlined_stencil_sum(const std::vector<T>&, int, Term&&) {
+    precondition(false, "Inlined stencil coefficients require scalar value type");
+    return std::string();
+}
+
 }
 
 template <typename T>
@@ -309,6 +548,8 @@ const detail::kernel_cache_entry& stencil<T>::slow_conv(const backend::command_q
         source.kernel("slow_conv")
             .open("(")
                 .template parameter<size_t>("n")
+                .template parameter<size_t>("start")
+                .template parameter<size_t>("m")
                 .template parameter<char>("has_left")
                 .template parameter<char>("has_right")
                 .template parameter<int>("lhalo")
@@ -321,8 +562,9 @@ const detail::kernel_cache_entry& stencil<T>::slow_conv(const backend::command_q
                 .template parameter<T>("beta")
             .close(")").open("{");
 
-        source.grid_stride_loop().open("{");
+        source.grid_stride_loop("i", "m").open("{");
 
+        source.new_line() << "size_t idx = start + i;";
         source.new_line() << type_name<T>() << " sum = 0;";
         source.new_line() << "for(int j = -lhalo; j <= rhalo; j++)";
         source.open("{");
@@ -360,6 +602,8 @@ const detail::kernel_cache_entry& stencil<T>::fast_conv(const backend::command_q
         source.kernel("fast_conv")
             .open("(")
                 .template parameter<size_t>("n")
+                .template parameter<size_t>("start")
+                .template parameter<size_t>("m")
                 .template parameter<char>("has_left")
                 .template parameter<char>("has_right")
                 .template parameter<int>("lhalo")
@@ -381,23 +625,24 @@ const detail::kernel_cache_entry& stencil<T>::fast_conv(const backend::command_q
         source.new_line() << "int l_id = " << source.local_id(0) << ";";
         source.new_line() << "int block_size = " << source.local_size(0) << ";";
         source.new_line() << "for(int i = l_id; i < rhalo + lhalo + 1; i += block_size) S[i] = s[i];";
-        source.new_line() << "for(long g_id = " << source.global_id(0) << ", pos = 0; pos < n; g_id += grid_size, pos += grid_size)";
+        source.new_line() << "for(long g_id = " << source.global_id(0) << ", pos = 0; pos < m; g_id += grid_size, pos += grid_size)";
         source.open("{");
-        source.new_line() << "for(int i = l_id, j = g_id - lhalo; i < block_size + lhalo + rhalo; i += block_size, j += block_size)";
+        source.new_line() << "for(int i = l_id, j = start + g_id - lhalo; i < block_size + lhalo + rhalo; i += block_size, j += block_size)";
         source.open("{");
         source.new_line() << "X[i] = read_x(j, n, has_left, has_right, lhalo, rhalo, xloc, xrem);";
         source.close("}");
         source.new_line().barrier();
-        source.new_line() << "if (g_id < n)";
+        source.new_line() << "if (g_id < m)";
         source.open("{");
+        source.new_line() << "size_t idx = start + g_id;";
         source.new_line() << type_name<T>() << " sum = 0;";
         source.new_line() << "for(int j = -lhalo; j <= rhalo; j++)";
         source.open("{");
         source.new_line() << "sum += S[lhalo + j] * X[lhalo + l_id + j];";
         source.close("}");
         source.new_line() << "if (alpha) "
-            "y[g_id] = alpha * y[g_id] + beta * sum;";
-        source.new_line() << "else y[g_id] = beta * sum;";
+            "y[idx] = alpha * y[idx] + beta * sum;";
+        source.new_line() << "else y[idx] = beta * sum;";
         source.close("}");
         source.new_line().barrier();
         source.close("}").close("}");
@@ -410,21 +655,217 @@ const detail::kernel_cache_entry& stencil<T>::fast_conv(const backend::command_q
 }
 
 template <typename T>
-void stencil<T>::init(unsigned width) {
+const detail::kernel_cache_entry& stencil<T>::sweep_conv(const backend::command_queue &queue) {
+    using namespace detail;
+
+    static kernel_cache cache;
+
+    auto key    = backend::cache_key(queue);
+    auto kernel = cache.find(key);
+
+    backend::select_context(queue);
+
+    if (kernel == cache.end()) {
+        backend::source_generator source(queue);
+
+        define_read_x<T>(source);
+
+        source.kernel("sweep_conv")
+            .open("(")
+                .template parameter<size_t>("n")
+                .template parameter<char>("has_left")
+                .template parameter<char>("has_right")
+                .template parameter<int>("lhalo")
+                .template parameter<int>("rhalo")
+                .template parameter<int>("k")
+                .template parameter< global_ptr<const T> >("s")
+                .template parameter< global_ptr<const T> >("xloc")
+                .template parameter< global_ptr<const T> >("xrem")
+                .template parameter< global_ptr<T> >("y")
+                .template smem_parameter< T >()
+            .close(")").open("{");
+
+        // Local memory holds the stencil and two tiles of block_size
+        // elements with k-wide halos. Sweeps alternate between the tiles;
+        // after sweep t the tile is valid in [t * lhalo, tile - t * rhalo).
+        source.smem_declaration<T>();
+        source.new_line() << "int kl = k * lhalo;";
+        source.new_line() << "int kr = k * rhalo;";
+        source.new_line() << "int block_size = " << source.local_size(0) << ";";
+        source.new_line() << "int tile = block_size + kl + kr;";
+        source.new_line() << type_name< shared_ptr<T> >() << " S = smem;";
+        source.new_line() << type_name< shared_ptr<T> >() << " A = smem + lhalo + rhalo + 1;";
+        source.new_line() << type_name< shared_ptr<T> >() << " B = A + tile;";
+
+        source.new_line() << "size_t grid_size = " << source.global_size(0) << ";";
+        source.new_line() << "int l_id = " << source.local_id(0) << ";";
+        source.new_line() << "for(int i = l_id; i < rhalo + lhalo + 1; i += block_size) S[i] = s[i];";
+        source.new_line() << "for(long g_id = " << source.global_id(0) << ", pos = 0; pos < n; g_id += grid_size, pos += grid_size)";
+        source.open("{");
+        // Global index of the first tile element.
+        source.new_line() << "long g0 = g_id - l_id - kl;";
+        source.new_line() << "for(int i = l_id; i < tile; i += block_size)";
+        source.open("{");
+        source.new_line() << "A[i] = read_x(g0 + i, n, has_left, has_right, kl, kr, xloc, xrem);";
+        source.close("}");
+        source.new_line().barrier();
+
+        source.new_line() << type_name< shared_ptr<T> >() << " src = A;";
+        source.new_line() << type_name< shared_ptr<T> >() << " dst = B;";
+        source.new_line() << "for(int t = 1; t <= k; ++t)";
+        source.open("{");
+        source.new_line() << "int b = t * lhalo;";
+        source.new_line() << "int e = tile - t * rhalo;";
+        source.new_line() << "for(int i = b + l_id; i < e; i += block_size)";
+        source.open("{");
+        source.new_line() << type_name<T>() << " sum = 0;";
+        source.new_line() << "for(int j = -lhalo; j <= rhalo; j++) sum += S[lhalo + j] * src[i + j];";
+        source.new_line() << "dst[i] = sum;";
+        source.close("}");
+        source.new_line().barrier();
+        // Outside of the vector the intermediate results are extended by
+        // their boundary values, as read_x() does for the input.
+        source.new_line() << "for(int i = b + l_id; i < e; i += block_size)";
+        source.open("{");
+        source.new_line() << "long g = g0 + i;";
+        source.new_line() << "if (g < 0 && !has_left) dst[i] = dst[-g0];";
+        source.new_line() << "else if (g >= (long)n && !has_right && (long)n - 1 - g0 >= b) dst[i] = dst[(long)n - 1 - g0];";
+        source.close("}");
+        source.new_line().barrier();
+        source.new_line() << type_name< shared_ptr<T> >() << " tmp = src; src = dst; dst = tmp;";
+        source.close("}");
+
+        source.new_line() << "if (g_id < n) y[g_id] = src[kl + l_id];";
+        source.new_line().barrier();
+        source.close("}").close("}");
+
+        backend::kernel krn(queue, source.str(), "sweep_conv");
+        kernel = cache.insert(std::make_pair(key, krn)).first;
+    }
+
+    return kernel->second;
+}
+
+template <typename T>
+backend::kernel stencil<T>::inlined_conv(const backend::command_queue &queue,
+        bool fast, const std::vector<T> &coef, int lhalo)
+{
+    using namespace detail;
+
+    // Kernels are cached by their source, so that stencils sharing the
+    // coefficients share the compiled kernel.
+    static std::map<std::string, kernel_cache> cache;
+
+    backend::source_generator source(queue);
+
+    define_read_x<T>(source);
+
+    source.kernel("inlined_conv")
+        .open("(")
+            .template parameter<size_t>("n")
+            .template parameter<size_t>("start")
+            .template parameter<size_t>("m")
+            .template parameter<char>("has_left")
+            .template parameter<char>("has_right")
+            .template parameter<int>("lhalo")
+            .template parameter<int>("rhalo")
+            .template parameter< global_ptr<const T> >("s")
+            .template parameter< global_ptr<const T> >("xloc")
+            .template parameter< global_ptr<const T> >("xrem")
+            .template parameter< global_ptr<T> >("y")
+            .template parameter<T>("alpha")
+            .template parameter<T>("beta");
+    if (fast) source.template smem_parameter< T >();
+    source.close(")").open("{");
+
+    if (fast) {
+        // Same local memory layout as in fast_conv, the coefficients part
+        // is left unused.
+        source.smem_declaration<T>();
+        source.new_line() << type_name< shared_ptr<T> >() << " X = smem + lhalo + rhalo + 1;";
+
+        source.new_line() << "size_t grid_size = " << source.global_size(0) << ";";
+        source.new_line() << "int l_id = " << source.local_id(0) << ";";
+        source.new_line() << "int block_size = " << source.local_size(0) << ";";
+        source.new_line() << "for(long g_id = " << source.global_id(0) << ", pos = 0; pos < m; g_id += grid_size, pos += grid_size)";
+        source.open("{");
+        source.new_line() << "for(int i = l_id, j = start + g_id - lhalo; i < block_size + lhalo + rhalo; i += block_size, j += block_size)";
+        source.open("{");
+        source.new_line() << "X[i] = read_x(j, n, has_left, has_right, lhalo, rhalo, xloc, xrem);";
+        source.close("}");
+        source.new_line().barrier();
+        source.new_line() << "if (g_id < m)";
+        source.open("{");
+        source.new_line() << "size_t idx = start + g_id;";
+        source.new_line() << type_name<T>() << " sum = "
+            << inlined_stencil_sum(coef, lhalo, [lhalo](int j) {
+                    std::ostringstream s;
+                    s << "X[l_id + " << lhalo + j << "]";
+                    return s.str();
+                    }) << ";";
+        source.new_line() << "if (alpha) y[idx] = alpha * y[idx] + beta * sum;";
+        source.new_line() << "else y[idx] = beta * sum;";
+        source.close("}");
+        source.new_line().barrier();
+        source.close("}");
+    } else {
+        source.grid_stride_loop("i", "m").open("{");
+        source.new_line() << "size_t idx = start + i;";
+        source.new_line() << type_name<T>() << " sum = "
+            << inlined_stencil_sum(coef, lhalo, [](int j) {
+                    std::ostringstream s;
+                    s << "read_x((" << type_name<ptrdiff_t>() << ")idx + " << j
+                      << ", n, has_left, has_right, lhalo, rhalo, xloc, xrem)";
+                    return s.str();
+                    }) << ";";
+        source.new_line() << "if (alpha) y[idx] = alpha * y[idx] + beta * sum;";
+        source.new_line() << "else y[idx] = beta * sum;";
+        source.close("}");
+    }
+
+    source.close("}");
+
+    kernel_cache &c = cache[source.str()];
+
+    auto key    = backend::cache_key(queue);
+    auto kernel = c.find(key);
+
+    backend::select_context(queue);
+
+    if (kernel == c.end()) {
+        backend::kernel krn(queue, source.str(), "inlined_conv");
+        kernel = c.insert(std::make_pair(key, krn)).first;
+    }
+
+    return kernel->second;
+}
+
+template <typename T> template <class Iterator>
+void stencil<T>::init(Iterator begin, Iterator end, stencil_coefficients mode) {
+    const unsigned width = static_cast<unsigned>(end - begin);
+
+    std::vector<T> coef;
+    if (mode == stencil_coefficients::inlined) coef.assign(begin, end);
+
     for (unsigned d = 0; d < queue.size(); d++) {
         auto   fast_krn = fast_conv(queue[d]);
         size_t max_smem = fast_krn.max_shared_memory_per_block(queue[d]);
 
         auto smem_required = [width](size_t wgs) { return sizeof(T) * (2 * width + wgs - 1); };
 
-        if (backend::is_cpu(queue[d]) || max_smem < smem_required(64)) {
-            conv[d]  = slow_conv(queue[d]);
-            conv[d].config(queue[d], [](size_t){ return 0; });
-            smem[d] = 0;
-        } else {
-            conv[d] = fast_krn;
+        bool fast = !backend::is_cpu(queue[d]) && max_smem >= smem_required(64);
+
+        if (mode == stencil_coefficients::inlined)
+            conv[d] = inlined_conv(queue[d], fast, coef, lhalo);
+        else
+            conv[d] = fast ? fast_krn : slow_conv(queue[d]);
+
+        if (fast) {
             conv[d].config(queue[d], smem_required);
             smem[d] = smem_required(conv[d].workgroup_size());
+        } else {
+            conv[d].config(queue[d], [](size_t){ return 0; });
+            smem[d] = 0;
         }
     }
 }
@@ -433,30 +874,141 @@ template <typename T>
 void stencil<T>::apply(const vex::vector<T> &x, vex::vector<T> &y,
         T alpha, bool append) const
 {
-    Base::exchange_halos(x);
-
     T beta = append ? 1 : 0;
 
+    auto convolve = [&](unsigned d, size_t start, size_t m) {
+        size_t psize     = x.part_size(d);
+        char   has_left  = d > 0;
+        char   has_right = d + 1 < queue.size();
+
+        conv[d].push_arg(psize);
+        conv[d].push_arg(start);
+        conv[d].push_arg(m);
+        conv[d].push_arg(has_left);
+        conv[d].push_arg(has_right);
+        conv[d].push_arg(lhalo);
+        conv[d].push_arg(rhalo);
+        conv[d].push_arg(s[d]);
+        conv[d].push_arg(x(d));
+        conv[d].push_arg(dbuf[d]);
+        conv[d].push_arg(y(d));
+        conv[d].push_arg(beta);
+        conv[d].push_arg(alpha);
+
+        if (smem[d]) conv[d].set_smem([&](size_t){ return smem[d]; });
+
+        conv[d](queue[d]);
+    };
+
+    // Interior points do not need halos and are processed while the halos
+    // are being exchanged over the secondary queues.
+    Base::sync_halo_queues();
+
+    for(unsigned d = 0; d < queue.size(); d++) {
+        size_t lo, hi;
+        Base::interior(d, x.part_size(d), lo, hi);
+        if (hi > lo) convolve(d, lo, hi - lo);
+    }
+
+    Base::exchange_halos(x, lhalo, rhalo, dbuf, hbuf);
+
+    for(unsigned d = 0; d < queue.size(); d++) {
+        size_t psize = x.part_size(d), lo, hi;
+        Base::interior(d, psize, lo, hi);
+        if (lo > 0)     convolve(d, 0, lo);
+        if (hi < psize) convolve(d, hi, psize - hi);
+    }
+}
+
+template <typename T>
+void stencil<T>::apply_k(const vex::vector<T> &x, vex::vector<T> &y,
+        unsigned k) const
+{
+    precondition(std::addressof(x) != std::addressof(y),
+            "apply_k() can not be done in place");
+
+    if (k == 0) {
+        y = x;
+        return;
+    }
+
+    if (k == 1) {
+        apply(x, y);
+        return;
+    }
+
+    const int      kl    = k * lhalo;
+    const int      kr    = k * rhalo;
+    const unsigned width = lhalo + rhalo + 1;
+
+    auto smem_required = [width, k](size_t wgs) {
+        return sizeof(T) * (width + 2 * (wgs + k * (width - 1)));
+    };
+
+    // Neighbour halos should not reach the ends of the vector, since the
+    // boundary values of intermediate sweeps are not known there.
+    bool blocked = true;
+    for(unsigned d = 0; d < queue.size() && blocked; d++) {
+        if (!x.part_size(d)) continue;
+
+        if (backend::is_cpu(queue[d]) ||
+                sweep_conv(queue[d]).max_shared_memory_per_block(queue[d]) < smem_required(64))
+            blocked = false;
+
+        if (d > 0 && x.part_start(d) < static_cast<size_t>(kl))
+            blocked = false;
+
+        if (d + 1 < queue.size() && x.size() - x.part_start(d + 1) < static_cast<size_t>(kr))
+            blocked = false;
+    }
+
+    if (!blocked) {
+        vex::vector<T> tmp(queue, x.size());
+
+        const vex::vector<T> *src = std::addressof(x);
+        vex::vector<T>       *dst = std::addressof((k % 2) ? y : tmp);
+
+        for(unsigned t = 0; t < k; ++t) {
+            apply(*src, *dst);
+            src = dst;
+            dst = std::addressof(dst == std::addressof(y) ? tmp : y);
+        }
+
+        return;
+    }
+
+    if (kbuf_k != k) {
+        khbuf.resize(queue.size() * (kl + kr));
+        for(unsigned d = 0; d < queue.size(); d++)
+            kbuf[d] = backend::device_vector<T>(queue[d], kl + kr + 1);
+        kbuf_k = k;
+    }
+
+    Base::sync_halo_queues();
+    Base::exchange_halos(x, kl, kr, kbuf, khbuf);
+
     for(unsigned d = 0; d < queue.size(); d++) {
         if (size_t psize = x.part_size(d)) {
             char has_left  = d > 0;
             char has_right = d + 1 < queue.size();
-
-            conv[d].push_arg(psize);
-            conv[d].push_arg(has_left);
-            conv[d].push_arg(has_right);
-            conv[d].push_arg(lhalo);
-            conv[d].push_arg(rhalo);
-            conv[d].push_arg(s[d]);
-            conv[d].push_arg(x(d));
-            conv[d].push_arg(dbuf[d]);
-            conv[d].push_arg(y(d));
-            conv[d].push_arg(beta);
-            conv[d].push_arg(alpha);
-
-            if (smem[d]) conv[d].set_smem([&](size_t){ return smem[d]; });
-
-            conv[d](queue[d]);
+            int  nk        = k;
+
+            backend::kernel krn = sweep_conv(queue[d]);
+            krn.config(queue[d], smem_required);
+
+            krn.push_arg(psize);
+            krn.push_arg(has_left);
+            krn.push_arg(has_right);
+            krn.push_arg(lhalo);
+            krn.push_arg(rhalo);
+            krn.push_arg(nk);
+            krn.push_arg(s[d]);
+            krn.push_arg(x(d));
+            krn.push_arg(kbuf[d]);
+            krn.push_arg(y(d));
+            krn.set_smem(smem_required);
+
+            krn(queue[d]);
         }
     }
 }
@@ -559,7 +1111,7 @@ void StencilOperator<T, width, center, Impl>::apply(
     static kernel_cache cache;
     static std::map<backend::kernel_cache_key, size_t> lmem;
 
-    Base::exchange_halos(x);
+    std::vector<kernel_cache::store_type::iterator> conv(queue.size());
 
     for(unsigned d = 0; d < queue.size(); d++) {
         backend::select_context(queue[d]);
@@ -582,6 +1134,8 @@ void StencilOperator<T, width, center, Impl>::apply(
             source.kernel("convolve")
                 .open("(")
                     .template parameter<size_t>("n")
+                    .template parameter<size_t>("start")
+                    .template parameter<size_t>("m")
                     .template parameter<char>("has_left")
                     .template parameter<char>("has_right")
                     .template parameter<int>("lhalo")
@@ -601,18 +1155,19 @@ void StencilOperator<T, width, center, Impl>::apply(
             source.new_line() << "int l_id = " << source.local_id(0) << ";";
             source.new_line() << "int block_size = " << source.local_size(0) << ";";
             source.new_line() << "for(long g_id = " << source.global_id(0)
-                << ", pos = 0; pos < n; g_id += grid_size, pos += grid_size)";
+                << ", pos = 0; pos < m; g_id += grid_size, pos += grid_size)";
             source.open("{");
-            source.new_line() << "for(int i = l_id, j = g_id - lhalo; i < block_size + lhalo + rhalo; i += block_size, j += block_size)";
+            source.new_line() << "for(int i = l_id, j = start + g_id - lhalo; i < block_size + lhalo + rhalo; i += block_size, j += block_size)";
             source.open("{");
             source.new_line() << "X[i] = read_x(j, n, has_left, has_right, lhalo, rhalo, xloc, xrem);";
             source.close("}");
             source.new_line().barrier();
-            source.new_line() << "if (g_id < n)";
+            source.new_line() << "if (g_id < m)";
             source.open("{");
+            source.new_line() << "size_t idx = start + g_id;";
             source.new_line() << type_name<T>() << " sum = stencil_oper(X + lhalo + l_id);";
-            source.new_line() << "if (alpha) y[g_id] = alpha * y[g_id] + beta * sum;";
-            source.new_line() << "else y[g_id] = beta * sum;";
+            source.new_line() << "if (alpha) y[idx] = alpha * y[idx] + beta * sum;";
+            source.new_line() << "else y[idx] = beta * sum;";
             source.close("}");
             source.new_line().barrier();
             source.close("}").close("}");
@@ -625,26 +1180,53 @@ void StencilOperator<T, width, center, Impl>::apply(
             lmem[key] = sizeof(T) * (krn.workgroup_size() + width - 1);
         }
 
-        if (size_t psize = x.part_size(d)) {
-            char has_left  = d > 0;
-            char has_right = d + 1 < queue.size();
+        conv[d] = kernel;
+    }
 
-            kernel->second.push_arg(psize);
-            kernel->second.push_arg(has_left);
-            kernel->second.push_arg(has_right);
-            kernel->second.push_arg(lhalo);
-            kernel->second.push_arg(rhalo);
-            kernel->second.push_arg(x(d));
-            kernel->second.push_arg(dbuf[d]);
-            kernel->second.push_arg(y(d));
-            kernel->second.push_arg(beta);
-            kernel->second.push_arg(alpha);
-
-            size_t smem_bytes = lmem[key];
-            kernel->second.set_smem([smem_bytes](size_t){ return smem_bytes; });
-
-            kernel->second(queue[d]);
-        }
+    auto convolve = [&](unsigned d, size_t start, size_t m) {
+        backend::kernel &krn = conv[d]->second;
+
+        size_t psize     = x.part_size(d);
+        char   has_left  = d > 0;
+        char   has_right = d + 1 < queue.size();
+
+        backend::select_context(queue[d]);
+
+        krn.push_arg(psize);
+        krn.push_arg(start);
+        krn.push_arg(m);
+        krn.push_arg(has_left);
+        krn.push_arg(has_right);
+        krn.push_arg(lhalo);
+        krn.push_arg(rhalo);
+        krn.push_arg(x(d));
+        krn.push_arg(dbuf[d]);
+        krn.push_arg(y(d));
+        krn.push_arg(beta);
+        krn.push_arg(alpha);
+
+        size_t smem_bytes = lmem[conv[d]->first];
+        krn.set_smem([smem_bytes](size_t){ return smem_bytes; });
+
+        krn(queue[d]);
+    };
+
+    // Interior points are processed while the halos are being exchanged.
+    Base::sync_halo_queues();
+
+    for(unsigned d = 0; d < queue.size(); d++) {
+        size_t lo, hi;
+        Base::interior(d, x.part_size(d), lo, hi);
+        if (hi > lo) convolve(d, lo, hi - lo);
+    }
+
+    Base::exchange_halos(x, lhalo, rhalo, dbuf, hbuf);
+
+    for(unsigned d = 0; d < queue.size(); d++) {
+        size_t psize = x.part_size(d), lo, hi;
+        Base::interior(d, psize, lo, hi);
+        if (lo > 0)     convolve(d, 0, lo);
+        if (hi < psize) convolve(d, hi, psize - hi);
     }
 }
 
@@ -0,0 +1,726 @@
+#ifndef VEXCL_STENCIL_ND_HPP
+#define VEXCL_STENCIL_ND_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2026 Denis Demidov <ddemidov@ksu.ru>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/stencil_nd.hpp
+ * \author Denis Demidov <ddemidov@ksu.ru>
+ * \brief  Multidimensional stencil convolution.
+ */
+
+#include <vector>
+#include <array>
+#include <string>
+#include <sstream>
+#include <algorithm>
+
+#include <vexcl/vector.hpp>
+#include <vexcl/vector_view.hpp>
+#include <vexcl/multi_array.hpp>
+#include <vexcl/operations.hpp>
+
+namespace vex {
+
+/// Multidimensional stencil.
+/**
+ * Convolves a stencil with a vector holding a row-major NDIM-dimensional
+ * array, as in
+ * \code
+ * // 5-point Laplacian on n x m grid:
+ * vex::stencil_nd<double, 2> L(ctx, vex::extents[n][m],
+ *     {{{0, 0}}, {{-1, 0}}, {{1, 0}}, {{0, -1}}, {{0, 1}}},
+ *     {4, -1, -1, -1, -1});
+ *
+ * y = x - L * x;
+ * \endcode
+ * The stencil is given by offsets of its points from the center and their
+ * coefficients. Points outside of the array are replaced with the nearest
+ * boundary points (as with the one-dimensional vex::stencil).
+ *
+ * The array is split across devices along its slowest (first) dimension in
+ * the same way as vex::multi_array is, and the halo planes are exchanged
+ * between devices before the convolution. Vectors partitioned otherwise
+ * (for example, plain vectors on several devices) are copied to and from
+ * internal buffers split along the planes on each application, so it is
+ * cheaper to keep the array in a vex::multi_array. On GPUs each workgroup loads a
+ * tile of the array together with its halo into local memory, so that each
+ * input element is read from global memory once per tile instead of once
+ * per stencil point.
+ */
+template <typename T, size_t NDIM>
+class stencil_nd {
+    public:
+        typedef T value_type;
+
+        /// Offset of a stencil point from the center.
+        typedef std::array<int, NDIM> offset_type;
+
+        /// Constructor.
+        /**
+         * \param queue  vector of queues. Each queue represents one
+         *               compute device.
+         * \param ext    dimensions of the array.
+         * \param offset offsets of the stencil points.
+         * \param coef   coefficients of the stencil points.
+         */
+        stencil_nd(const std::vector<backend::command_queue> &queue,
+                const extent_gen<NDIM> &ext,
+                const std::vector<offset_type> &offset,
+                const std::vector<T> &coef
+                )
+            : queue(queue), dim(ext.dim), rows(vex::partition(ext.dim[0], queue)),
+              part(rows), lh(queue.size(), 0), rh(queue.size(), 0),
+              dbuf(queue.size()), dcoef(queue.size()), doff(queue.size()),
+              dsoff(queue.size()), krn(queue.size()), tiled(queue.size(), false),
+              smem(queue.size(), 0), npts(offset.size()), direct(queue.size() > 1)
+        {
+            precondition(!offset.empty() && offset.size() == coef.size(),
+                    "Wrong stencil definition");
+
+            init(offset, coef);
+        }
+
+        /// Constructor.
+        /**
+         * Takes queues and dimensions from the array the stencil is going to
+         * be applied to.
+         */
+        stencil_nd(const multi_array<T, NDIM> &x,
+                const std::vector<offset_type> &offset,
+                const std::vector<T> &coef
+                )
+            : queue(x.vec().queue_list()), dim(x.slice.dim), rows(x.slab_partition()),
+              part(rows), lh(queue.size(), 0), rh(queue.size(), 0),
+              dbuf(queue.size()), dcoef(queue.size()), doff(queue.size()),
+              dsoff(queue.size()), krn(queue.size()), tiled(queue.size(), false),
+              smem(queue.size(), 0), npts(offset.size()), direct(queue.size() > 1)
+        {
+            precondition(!offset.empty() && offset.size() == coef.size(),
+                    "Wrong stencil definition");
+
+            init(offset, coef);
+        }
+
+        /// Convolve stencil with a vector.
+        /**
+         * y = alpha * conv(x) + y;
+         * \param x input vector.
+         * \param y output vector.
+         * \param alpha Scaling coefficient in front of y.
+         * \param append whether to append the result to the output vector
+         *               (alternative is to replace the output vector).
+         */
+        void apply(const vex::vector<T> &x, vex::vector<T> &y,
+                T alpha = 1, bool append = false) const;
+    private:
+        const std::vector<backend::command_queue> &queue;
+
+        std::array<size_t, NDIM> dim;
+
+        // Partitioning of the first dimension and of the array elements.
+        std::vector<size_t> rows;
+        std::vector<size_t> part;
+
+        // Stencil reach in each dimension.
+        std::array<int, NDIM> lo, hi;
+
+        // Number of halo planes received from the left/right neighbours.
+        std::vector<size_t> lh, rh;
+
+        std::vector< backend::device_vector<T> >   dbuf;
+        std::vector< backend::device_vector<T> >   dcoef;
+        std::vector< backend::device_vector<int> > doff;
+        std::vector< backend::device_vector<int> > dsoff;
+
+        mutable std::vector<backend::kernel> krn;
+        std::vector<char> tiled;
+        std::vector<size_t> smem;
+
+        // Tile dimensions on each device.
+        std::vector< std::array<size_t, NDIM> > tile;
+
+        size_t npts;
+
+        // Halos are copied directly between devices sharing a context.
+        bool direct;
+
+        void init(const std::vector<offset_type> &offset, const std::vector<T> &coef);
+
+        // Number of elements in a plane of the first dimension.
+        size_t plane() const {
+            size_t p = 1;
+            for(size_t k = 1; k < NDIM; ++k) p *= dim[k];
+            return p;
+        }
+
+        std::array<size_t, NDIM> tile_dims(size_t wgs) const;
+
+        size_t tile_smem(const std::array<size_t, NDIM> &t) const {
+            size_t s = sizeof(T);
+            for(size_t k = 0; k < NDIM; ++k) s *= t[k] + lo[k] + hi[k];
+            return s;
+        }
+
+        // Vectors split along the planes, used in place of arguments that
+        // are partitioned otherwise.
+        mutable vex::vector<T> xbuf, ybuf;
+
+        void exchange_halos(const vex::vector<T> &x) const;
+
+        bool split_along_planes(const vex::vector<T> &x) const {
+            return x.nparts() == queue.size() && x.partition() == part;
+        }
+
+        vex::vector<T>& planes(vex::vector<T> &buf) const;
+
+        void convolve(const vex::vector<T> &x, vex::vector<T> &y,
+                T alpha, bool append) const;
+
+        static void repartition(const vex::vector<T> &x, vex::vector<T> &y);
+
+        static void define_read(backend::source_generator &src);
+
+        static const detail::kernel_cache_entry& direct_conv(const backend::command_queue &queue);
+        static const detail::kernel_cache_entry& tiled_conv(const backend::command_queue &queue);
+};
+
+/// \cond INTERNAL
+
+template <typename T, size_t NDIM>
+void stencil_nd<T, NDIM>::init(
+        const std::vector<offset_type> &offset, const std::vector<T> &coef)
+{
+    static_assert(NDIM > 0, "Zero-dimensional stencil");
+
+    const size_t np = plane();
+
+    for(unsigned d = 0; d < queue.size(); d++) part[d + 1] *= np;
+
+    for(size_t k = 0; k < NDIM; ++k) {
+        lo[k] = hi[k] = 0;
+        for(auto o = offset.begin(); o != offset.end(); ++o) {
+            lo[k] = std::max(lo[k], -(*o)[k]);
+            hi[k] = std::max(hi[k],  (*o)[k]);
+        }
+    }
+
+    for(unsigned d = 1; d < queue.size(); d++)
+        if (!backend::is_same_context(queue[0], queue[d])) direct = false;
+
+    std::vector<int> off;
+    off.reserve(NDIM * npts);
+    for(auto o = offset.begin(); o != offset.end(); ++o)
+        off.insert(off.end(), o->begin(), o->end());
+
+    tile.resize(queue.size());
+
+    for(unsigned d = 0; d < queue.size(); d++) {
+        lh[d] = std::min<size_t>(lo[0], rows[d]);
+        rh[d] = std::min<size_t>(hi[0], dim[0] - rows[d + 1]);
+
+        // Allocate one element more than needed, to be sure size is nonzero.
+        dbuf[d]  = backend::device_vector<T>(queue[d], (lh[d] + rh[d]) * np + 1);
+        dcoef[d] = backend::device_vector<T>(queue[d], npts, coef.data(), backend::MEM_READ_ONLY);
+        doff[d]  = backend::device_vector<int>(queue[d], off.size(), off.data(), backend::MEM_READ_ONLY);
+
+        // Tiled kernel is used on GPUs, provided that a reasonably sized
+        // tile fits into local memory.
+        auto tiled_krn = tiled_conv(queue[d]);
+        size_t max_smem = tiled_krn.max_shared_memory_per_block(queue[d]);
+
+        auto smem_required = [this](size_t wgs) { return tile_smem(tile_dims(wgs)); };
+
+        if (backend::is_cpu(queue[d]) || max_smem < smem_required(64)) {
+            krn[d] = direct_conv(queue[d]);
+            krn[d].config(queue[d], [](size_t){ return 0; });
+            continue;
+        }
+
+        krn[d] = tiled_krn;
+        krn[d].config(queue[d], smem_required);
+
+        tiled[d] = true;
+        tile[d]  = tile_dims(krn[d].workgroup_size());
+        smem[d]  = tile_smem(tile[d]);
+
+        // Offsets of the stencil points inside the local memory tile.
+        std::vector<int> soff(npts);
+        for(size_t j = 0; j < npts; ++j) {
+            int s = 0;
+            for(size_t k = 0; k < NDIM; ++k)
+                s = s * static_cast<int>(tile[d][k] + lo[k] + hi[k]) + offset[j][k];
+            soff[j] = s;
+        }
+
+        dsoff[d] = backend::device_vector<int>(queue[d], npts, soff.data(), backend::MEM_READ_ONLY);
+    }
+
+    for(unsigned d = 0; d < queue.size(); d++) queue[d].finish();
+}
+
+template <typename T, size_t NDIM>
+std::array<size_t, NDIM> stencil_nd<T, NDIM>::tile_dims(size_t wgs) const {
+    std::array<size_t, NDIM> t;
+    std::fill(t.begin(), t.end(), 1);
+
+    // The tile spans the two fastest dimensions; a warp-sized row of the
+    // fastest one keeps global memory reads coalesced.
+    if (NDIM == 1) {
+        t[0] = std::min(dim[0], wgs);
+    } else {
+        t[NDIM - 1] = std::min<size_t>(dim[NDIM - 1], 32);
+        t[NDIM - 2] = std::max<size_t>(1, std::min(dim[NDIM - 2], wgs / t[NDIM - 1]));
+    }
+
+    return t;
+}
+
+template <typename T, size_t NDIM>
+void stencil_nd<T, NDIM>::exchange_halos(const vex::vector<T> &x) const {
+    if (queue.size() <= 1) return;
+
+    const size_t np = plane();
+
+    // Make sure x is ready on all devices.
+    for(unsigned d = 0; d < queue.size(); d++) queue[d].finish();
+
+    if (direct) {
+        for(unsigned d = 0; d < queue.size(); d++) {
+            if (rows[d + 1] == rows[d]) continue;
+
+            // Halo planes may span several devices.
+            auto copy = [&](size_t begin, size_t end, size_t pos) {
+                for(unsigned p = 0; p < queue.size() && begin < end; p++) {
+                    size_t b = std::max(begin, part[p]);
+                    size_t e = std::min(end,   part[p + 1]);
+
+                    if (b < e)
+                        dbuf[d].copy_from(queue[d], x(p), b - part[p], pos + b - begin, e - b);
+                }
+            };
+
+            if (lh[d]) copy(part[d] - lh[d] * np, part[d], 0);
+            if (rh[d]) copy(part[d + 1], part[d + 1] + rh[d] * np, lh[d] * np);
+        }
+
+        return;
+    }
+
+    std::vector<size_t> offset(queue.size() + 1, 0);
+    for(unsigned d = 0; d < queue.size(); d++)
+        offset[d + 1] = offset[d] + (rows[d + 1] > rows[d] ? (lh[d] + rh[d]) * np : 0);
+
+    if (!offset.back()) return;
+
+    std::vector<T> hbuf(offset.back());
+
+    for(unsigned d = 0; d < queue.size(); d++) {
+        if (offset[d + 1] == offset[d]) continue;
+
+        if (lh[d])
+            x.read_data(part[d] - lh[d] * np, lh[d] * np, &hbuf[offset[d]], false);
+
+        if (rh[d])
+            x.read_data(part[d + 1], rh[d] * np, &hbuf[offset[d] + lh[d] * np], false);
+    }
+
+    for(unsigned d = 0; d < queue.size(); d++) queue[d].finish();
+
+    for(unsigned d = 0; d < queue.size(); d++)
+        if (offset[d + 1] > offset[d])
+            dbuf[d].write(queue[d], 0, offset[d + 1] - offset[d], &hbuf[offset[d]]);
+
+    for(unsigned d = 0; d < queue.size(); d++) queue[d].finish();
+}
+
+template <typename T, size_t NDIM>
+void stencil_nd<T, NDIM>::define_read(backend::source_generator &src) {
+    // Reads element with the given coordinates. The first coordinate is
+    // relative to the device slab; coordinates outside of the array are
+    // clamped to its boundary.
+    src.function<T>("read_x")
+        .open("(");
+
+    for(size_t k = 0; k < NDIM; ++k)
+        src.template parameter<ptrdiff_t>("i") << k;
+    for(size_t k = 0; k < NDIM; ++k)
+        src.template parameter<ptrdiff_t>("n") << k;
+
+    src.template parameter<ptrdiff_t>("lh")
+       .template parameter<ptrdiff_t>("rh")
+       .template parameter< global_ptr<const T> >("xloc")
+       .template parameter< global_ptr<const T> >("xrem")
+       .close(")").open("{");
+
+    src.new_line() << "if (i0 < -lh) i0 = -lh;";
+    src.new_line() << "if (i0 >= n0 + rh) i0 = n0 + rh - 1;";
+
+    for(size_t k = 1; k < NDIM; ++k) {
+        src.new_line() << "if (i" << k << " < 0) i" << k << " = 0;";
+        src.new_line() << "if (i" << k << " >= n" << k << ") i" << k << " = n" << k << " - 1;";
+    }
+
+    src.new_line() << type_name<ptrdiff_t>() << " p = 1, j = 0;";
+    for(size_t k = NDIM; k-- > 1; )
+        src.new_line() << "j += i" << k << " * p; p *= n" << k << ";";
+
+    src.new_line() << "if (i0 < 0) return xrem[(lh + i0) * p + j];";
+    src.new_line() << "if (i0 >= n0) return xrem[(lh + i0 - n0) * p + j];";
+    src.new_line() << "return xloc[i0 * p + j];";
+    src.close("}");
+}
+
+template <typename T, size_t NDIM>
+const detail::kernel_cache_entry& stencil_nd<T, NDIM>::direct_conv(const backend::command_queue &queue) {
+    using namespace detail;
+
+    static kernel_cache cache;
+
+    auto key    = backend::cache_key(queue);
+    auto kernel = cache.find(key);
+
+    backend::select_context(queue);
+
+    if (kernel == cache.end()) {
+        backend::source_generator src(queue);
+
+        define_read(src);
+
+        src.kernel("stencil_nd_direct").open("(")
+            .template parameter<size_t>("n");
+
+        for(size_t k = 0; k < NDIM; ++k)
+            src.template parameter<ptrdiff_t>("n") << k;
+
+        src.template parameter<ptrdiff_t>("lh")
+           .template parameter<ptrdiff_t>("rh")
+           .template parameter<int>("npts")
+           .template parameter< global_ptr<const T> >("coef")
+           .template parameter< global_ptr<const int> >("off")
+           .template parameter< global_ptr<const T> >("xloc")
+           .template parameter< global_ptr<const T> >("xrem")
+           .template parameter< global_ptr<T> >("y")
+           .template parameter<T>("alpha")
+           .template parameter<T>("beta")
+           .close(")").open("{");
+
+        src.grid_stride_loop().open("{");
+
+        src.new_line() << type_name<ptrdiff_t>() << " r = idx;";
+        for(size_t k = NDIM; k-- > 1; )
+            src.new_line() << type_name<ptrdiff_t>() << " c" << k << " = r % n" << k << "; r /= n" << k << ";";
+        src.new_line() << type_name<ptrdiff_t>() << " c0 = r;";
+
+        src.new_line() << type_name<T>() << " sum = 0;";
+        src.new_line() << "for(int j = 0; j < npts; ++j)";
+        src.open("{");
+        src.new_line() << "sum += coef[j] * read_x(";
+        for(size_t k = 0; k < NDIM; ++k)
+            src << "c" << k << " + off[j * " << NDIM << " + " << k << "], ";
+        for(size_t k = 0; k < NDIM; ++k) src << "n" << k << ", ";
+        src << "lh, rh, xloc, xrem);";
+        src.close("}");
+        src.new_line() << "if (beta) y[idx] = alpha * sum + beta * y[idx];";
+        src.new_line() << "else y[idx] = alpha * sum;";
+        src.close("}").close("}");
+
+        backend::kernel k(queue, src.str(), "stencil_nd_direct");
+        kernel = cache.insert(std::make_pair(key, k)).first;
+    }
+
+    return kernel->second;
+}
+
+template <typename T, size_t NDIM>
+const detail::kernel_cache_entry& stencil_nd<T, NDIM>::tiled_conv(const backend::command_queue &queue) {
+    using namespace detail;
+
+    static kernel_cache cache;
+
+    auto key    = backend::cache_key(queue);
+    auto kernel = cache.find(key);
+
+    backend::select_context(queue);
+
+    if (kernel == cache.end()) {
+        backend::source_generator src(queue);
+
+        define_read(src);
+
+        src.kernel("stencil_nd_tiled").open("(")
+            .template parameter<size_t>("n");
+
+        for(size_t k = 0; k < NDIM; ++k)
+            src.template parameter<ptrdiff_t>("n") << k;
+        for(size_t k = 0; k < NDIM; ++k)
+            src.template parameter<ptrdiff_t>("t") << k;
+        for(size_t k = 0; k < NDIM; ++k)
+            src.template parameter<ptrdiff_t>("lo") << k;
+        for(size_t k = 0; k < NDIM; ++k)
+            src.template parameter<ptrdiff_t>("e") << k;
+
+        src.template parameter<ptrdiff_t>("lh")
+           .template parameter<ptrdiff_t>("rh")
+           .template parameter<int>("npts")
+           .template parameter< global_ptr<const T> >("coef")
+           .template parameter< global_ptr<const int> >("soff")
+           .template parameter< global_ptr<const T> >("xloc")
+           .template parameter< global_ptr<const T> >("xrem")
+           .template parameter< global_ptr<T> >("y")
+           .template parameter<T>("alpha")
+           .template parameter<T>("beta")
+           .template smem_parameter<T>()
+           .close(")").open("{");
+
+        src.smem_declaration<T>();
+        src.new_line() << type_name< shared_ptr<T> >() << " X = smem;";
+
+        const std::string l = type_name<ptrdiff_t>();
+
+        src.new_line() << l << " l_id = " << src.local_id(0) << ";";
+        src.new_line() << l << " block_size = " << src.local_size(0) << ";";
+        src.new_line() << l << " num_groups = " << src.global_size(0) << " / block_size;";
+
+        src.new_line() << l << " ntiles = 1, tsize = 1, esize = 1;";
+        for(size_t k = 0; k < NDIM; ++k) {
+            src.new_line() << l << " nt" << k << " = (n" << k << " + t" << k << " - 1) / t" << k << ";";
+            src.new_line() << "ntiles *= nt" << k << "; tsize *= t" << k << "; esize *= e" << k << ";";
+        }
+
+        src.new_line() << "for(" << l << " tile = " << src.group_id(0) << "; tile < ntiles; tile += num_groups)";
+        src.open("{");
+
+        // Origin of the tile.
+        src.new_line() << l << " r = tile;";
+        for(size_t k = NDIM; k-- > 1; )
+            src.new_line() << l << " o" << k << " = (r % nt" << k << ") * t" << k << "; r /= nt" << k << ";";
+        src.new_line() << l << " o0 = r * t0;";
+
+        // Load the tile together with its halo into local memory.
+        src.new_line() << "for(" << l << " i = l_id; i < esize; i += block_size)";
+        src.open("{");
+        src.new_line() << "r = i;";
+        for(size_t k = NDIM; k-- > 1; )
+            src.new_line() << l << " c" << k << " = r % e" << k << "; r /= e" << k << ";";
+        src.new_line() << l << " c0 = r;";
+        src.new_line() << "X[i] = read_x(";
+        for(size_t k = 0; k < NDIM; ++k) src << "o" << k << " + c" << k << " - lo" << k << ", ";
+        for(size_t k = 0; k < NDIM; ++k) src << "n" << k << ", ";
+        src << "lh, rh, xloc, xrem);";
+        src.close("}");
+
+        src.new_line().barrier();
+
+        // Apply the stencil to the tile.
+        src.new_line() << "for(" << l << " i = l_id; i < tsize; i += block_size)";
+        src.open("{");
+        src.new_line() << "r = i;";
+        for(size_t k = NDIM; k-- > 1; )
+            src.new_line() << l << " c" << k << " = r % t" << k << "; r /= t" << k << ";";
+        src.new_line() << l << " c0 = r;";
+
+        src.new_line() << "if (";
+        for(size_t k = 0; k < NDIM; ++k)
+            src << (k ? " && " : "") << "o" << k << " + c" << k << " < n" << k;
+        src << ")";
+        src.open("{");
+
+        src.new_line() << l << " center = 0, g = 0;";
+        for(size_t k = 0; k < NDIM; ++k) {
+            src.new_line() << "center = center * e" << k << " + c" << k << " + lo" << k << ";";
+            src.new_line() << "g = g * n" << k << " + o" << k << " + c" << k << ";";
+        }
+
+        src.new_line() << type_name<T>() << " sum = 0;";
+        src.new_line() << "for(int j = 0; j < npts; ++j) sum += coef[j] * X[center + soff[j]];";
+        src.new_line() << "if (beta) y[g] = alpha * sum + beta * y[g];";
+        src.new_line() << "else y[g] = alpha * sum;";
+        src.close("}");
+        src.close("}");
+
+        src.new_line().barrier();
+        src.close("}");
+        src.close("}");
+
+        backend::kernel k(queue, src.str(), "stencil_nd_tiled");
+        kernel = cache.insert(std::make_pair(key, k)).first;
+    }
+
+    return kernel->second;
+}
+
+template <typename T, size_t NDIM>
+void stencil_nd<T, NDIM>::apply(const vex::vector<T> &x, vex::vector<T> &y,
+        T alpha, bool append) const
+{
+    bool sx = split_along_planes(x);
+    bool sy = split_along_planes(y);
+
+    if (sx && sy) {
+        convolve(x, y, alpha, append);
+        return;
+    }
+
+    precondition(x.size() == part.back() && y.size() == part.back(),
+            "Vector size does not match the stencil dimensions");
+
+    if (!sx) repartition(x, planes(xbuf));
+
+    if (sy) {
+        convolve(sx ? x : xbuf, y, alpha, append);
+    } else {
+        if (append) repartition(y, planes(ybuf));
+
+        convolve(sx ? x : xbuf, planes(ybuf), alpha, append);
+        repartition(ybuf, y);
+    }
+}
+
+template <typename T, size_t NDIM>
+vex::vector<T>& stencil_nd<T, NDIM>::planes(vex::vector<T> &buf) const {
+    if (buf.size() != part.back()) {
+        vex::vector<T> tmp(part, queue);
+        buf.swap(tmp);
+    }
+
+    return buf;
+}
+
+// Copies x to y partitioned differently. Ranges on devices sharing a context
+// are copied directly, others are staged through host memory.
+template <typename T, size_t NDIM>
+void stencil_nd<T, NDIM>::repartition(const vex::vector<T> &x, vex::vector<T> &y) {
+    const std::vector<backend::command_queue> &xq = x.queue_list();
+    const std::vector<backend::command_queue> &yq = y.queue_list();
+
+    const std::vector<size_t> &xp = x.partition();
+    const std::vector<size_t> &yp = y.partition();
+
+    // Make sure x is ready on all devices.
+    for(unsigned p = 0; p < xq.size(); p++) xq[p].finish();
+
+    for(unsigned d = 0; d < yq.size(); d++) {
+        for(unsigned p = 0; p < xq.size(); p++) {
+            size_t b = std::max(xp[p], yp[d]);
+            size_t e = std::min(xp[p + 1], yp[d + 1]);
+
+            if (b >= e) continue;
+
+            if (backend::is_same_context(xq[p], yq[d])) {
+                y(d).copy_from(yq[d], x(p), b - xp[p], b - yp[d], e - b);
+            } else {
+                std::vector<T> h(e - b);
+                x(p).read(xq[p], b - xp[p], e - b, h.data(), true);
+                y(d).write(yq[d], b - yp[d], e - b, h.data(), true);
+            }
+        }
+    }
+}
+
+template <typename T, size_t NDIM>
+void stencil_nd<T, NDIM>::convolve(const vex::vector<T> &x, vex::vector<T> &y,
+        T alpha, bool append) const
+{
+    exchange_halos(x);
+
+    T beta = append ? 1 : 0;
+
+    for(unsigned d = 0; d < queue.size(); d++) {
+        if (rows[d + 1] == rows[d]) continue;
+
+        backend::select_context(queue[d]);
+
+        std::array<size_t, NDIM> n = dim;
+        n[0] = rows[d + 1] - rows[d];
+
+        krn[d].push_arg(part[d + 1] - part[d]);
+
+        for(size_t k = 0; k < NDIM; ++k)
+            krn[d].push_arg(static_cast<ptrdiff_t>(n[k]));
+
+        if (tiled[d]) {
+            for(size_t k = 0; k < NDIM; ++k)
+                krn[d].push_arg(static_cast<ptrdiff_t>(tile[d][k]));
+            for(size_t k = 0; k < NDIM; ++k)
+                krn[d].push_arg(static_cast<ptrdiff_t>(lo[k]));
+            for(size_t k = 0; k < NDIM; ++k)
+                krn[d].push_arg(static_cast<ptrdiff_t>(tile[d][k] + lo[k] + hi[k]));
+        }
+
+        krn[d].push_arg(static_cast<ptrdiff_t>(lh[d]));
+        krn[d].push_arg(static_cast<ptrdiff_t>(rh[d]));
+        krn[d].push_arg(static_cast<int>(npts));
+        krn[d].push_arg(dcoef[d]);
+        krn[d].push_arg(tiled[d] ? dsoff[d] : doff[d]);
+        krn[d].push_arg(x(d));
+        krn[d].push_arg(dbuf[d]);
+        krn[d].push_arg(y(d));
+        krn[d].push_arg(alpha);
+        krn[d].push_arg(beta);
+
+        if (tiled[d]) krn[d].set_smem([&](size_t){ return smem[d]; });
+
+        krn[d](queue[d]);
+    }
+}
+
+/// \endcond
+
+/// Convolve the stencil with the vector.
+template <typename T, size_t NDIM>
+additive_operator< stencil_nd<T, NDIM>, vector<T> >
+operator*(const stencil_nd<T, NDIM> &s, const vector<T> &x) {
+    return additive_operator< stencil_nd<T, NDIM>, vector<T> >(s, x);
+}
+
+/// Convolve the stencil with the multidimensional array.
+/**
+ * The result is assigned to the underlying vector of an array with the same
+ * dimensions:
+ * \code
+ * y.vec() = L * x;
+ * \endcode
+ */
+template <typename T, size_t NDIM>
+additive_operator< stencil_nd<T, NDIM>, vector<T> >
+operator*(const stencil_nd<T, NDIM> &s, const multi_array<T, NDIM> &x) {
+    return additive_operator< stencil_nd<T, NDIM>, vector<T> >(s, x.vec());
+}
+
+#ifdef VEXCL_MULTIVECTOR_HPP
+
+/// Convolve the stencil with the multivector.
+template <typename T, size_t NDIM, size_t N>
+multiadditive_operator< stencil_nd<T, NDIM>, multivector<T, N> >
+operator*(const stencil_nd<T, NDIM> &s, const multivector<T, N> &x) {
+    return multiadditive_operator< stencil_nd<T, NDIM>, multivector<T, N> >(s, x);
+}
+
+#endif
+
+} // namespace vex
+
+#endif
@@ -0,0 +1,201 @@
+#ifndef VEXCL_STREAM_HPP
+#define VEXCL_STREAM_HPP
+
+/*
+The MIT License
+
+Copyright (c) 2026 Denis Demidov <ddemidov@ksu.ru>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+/**
+ * \file   vexcl/stream.hpp
+ * \author Denis Demidov <ddemidov@ksu.ru>
+ * \brief  Independent command queues for concurrent execution of operations.
+ */
+
+#include <vector>
+
+#include <vexcl/backend.hpp>
+#include <vexcl/util.hpp>
+#include <vexcl/vector.hpp>
+
+namespace vex {
+
+/// Set of command queues, one per device of the parent queue list.
+/**
+ * Operations submitted to different streams are independent and may be
+ * executed concurrently by the compute devices. A vector is bound to a
+ * stream with
+ * \code
+ * vex::stream s(ctx);
+ * auto X = s(x);   // Shares memory with x,
+ * X = sin(X);      // but the kernel is submitted to the stream.
+ * \endcode
+ */
+class stream {
+    public:
+        /// Creates queues on the contexts and devices of the given queues.
+        explicit stream(const std::vector<backend::command_queue> &parent) {
+            q.reserve(parent.size());
+            for(auto p = parent.begin(); p != parent.end(); ++p)
+                q.push_back(backend::duplicate_queue(*p));
+        }
+
+        const std::vector<backend::command_queue>& queue() const {
+            return q;
+        }
+
+        operator const std::vector<backend::command_queue>&() const {
+            return q;
+        }
+
+        const backend::command_queue& queue(unsigned d) const {
+            return q[d];
+        }
+
+        size_t size() const {
+            return q.size();
+        }
+
+        /// Returns vector sharing memory with v, bound to the stream.
+        template <typename T>
+        vector<T> operator()(const vector<T> &v) const {
+            return vector<T>(q, v);
+        }
+
+        /// Operations submitted after this call wait for the given queues.
+        /**
+         * Does not block the host.
+         */
+        void wait_for(const std::vector<backend::command_queue> &queue) const {
+            precondition(queue.size() == q.size(), "Incompatible queue lists");
+
+            for(unsigned d = 0; d < q.size(); d++)
+                backend::enqueue_wait(q[d],
+                        std::vector<backend::event>(1, backend::enqueue_marker(queue[d])));
+        }
+
+        /// Blocks until all operations submitted to the stream are complete.
+        void finish() const {
+            for(auto queue = q.begin(); queue != q.end(); ++queue)
+                queue->finish();
+        }
+    private:
+        std::vector<backend::command_queue> q;
+};
+
+/// Distributes independent operations across a pool of streams.
+/**
+ * The streams are forked from the parent queues: the first operation
+ * submitted to a stream waits until all work previously submitted to the
+ * parent queues is complete. join() (also called by the destructor) makes the
+ * parent queues wait for all the streams. Neither blocks the host.
+ * \code
+ * vex::parallel_section par(ctx);
+ * for(int i = 0; i < n; ++i) {
+ *     const vex::stream &s = par.next();
+ *     auto Y = s(y[i]);
+ *     Y = sin(s(x[i]));
+ * }
+ * par.join();
+ * \endcode
+ * The section may be reused after join() without recreating the queues.
+ */
+class parallel_section {
+    public:
+        /// Creates the pool with the given number of streams.
+        parallel_section(
+                const std::vector<backend::command_queue> &queue,
+                unsigned nstreams = 4
+                ) : queue(queue), current(0), forked(false)
+        {
+            precondition(nstreams > 0, "Empty stream pool");
+
+            s.reserve(nstreams);
+            for(unsigned i = 0; i < nstreams; ++i)
+                s.push_back(stream(queue));
+        }
+
+        ~parallel_section() {
+            join();
+        }
+
+        /// Returns next stream in round-robin order.
+        const stream& next() {
+            fork();
+
+            const stream &n = s[current];
+            current = (current + 1) % s.size();
+            return n;
+        }
+
+        /// Returns i-th stream of the pool.
+        const stream& operator[](unsigned i) {
+            fork();
+            return s[i];
+        }
+
+        /// Number of streams in the pool.
+        size_t size() const {
+            return s.size();
+        }
+
+        /// Makes the parent queues wait for all operations in the streams.
+        void join() {
+            if (!forked) return;
+
+            for(unsigned d = 0; d < queue.size(); d++) {
+                std::vector<backend::event> done;
+                done.reserve(s.size());
+
+                for(auto i = s.begin(); i != s.end(); ++i)
+                    done.push_back(backend::enqueue_marker(i->queue(d)));
+
+                backend::enqueue_wait(queue[d], done);
+            }
+
+            forked  = false;
+            current = 0;
+        }
+    private:
+        std::vector<backend::command_queue> queue;
+        std::vector<stream> s;
+
+        size_t current;
+        bool   forked;
+
+        void fork() {
+            if (forked) return;
+
+            for(unsigned d = 0; d < queue.size(); d++) {
+                std::vector<backend::event> ready(1, backend::enqueue_marker(queue[d]));
+
+                for(auto i = s.begin(); i != s.end(); ++i)
+                    backend::enqueue_wait(i->queue(d), ready);
+            }
+
+            forked = true;
+        }
+};
+
+} // namespace vex
+
+#endif
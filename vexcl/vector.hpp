@@ -374,6 +374,37 @@ class vector : public vector_terminal_expression {
             part[1] = size ? size : buffer.size();
         }
 
+        /// Share device memory of another vector.
+        /**
+         * Operations with the new vector are submitted to the given queues.
+         * The queues should be attached to the same contexts and devices as
+         * the queues of the original vector (see vex::stream).
+         */
+        vector(const std::vector<backend::command_queue> &queue,
+               const vector &v
+               ) : queue(queue), part(v.part), buf(v.buf)
+        {
+            precondition(queue.size() == v.queue.size(),
+                    "Queue list does not match the vector partitioning");
+        }
+
+        /// Allocate the buffer with the given partitioning.
+        /**
+         * Device d holds elements [part[d], part[d + 1]) of the vector. This
+         * allows containers to split their storage at boundaries of their
+         * own (e.g. at rows of a matrix or at planes of a grid).
+         */
+        vector(const std::vector<size_t> &part,
+               const std::vector<backend::command_queue> &queue,
+               backend::mem_flags flags = backend::MEM_READ_WRITE
+              ) : queue(queue), part(part)
+        {
+            precondition(part.size() == queue.size() + 1 && part.front() == 0,
+                    "Partitioning does not match the queue list");
+
+            if (part.back()) allocate_buffers(flags, 0);
+        }
+
         /// Copy host data to the new buffer.
         vector(const std::vector<backend::command_queue> &queue,
                 size_t size, const T *host = 0,
@@ -795,12 +826,27 @@ class vector : public vector_terminal_expression {
             buf.clear();
             buf.reserve(queue.size());
 
-            for(unsigned d = 0; d < queue.size(); d++)
-                buf.push_back(
-                        backend::device_vector<T>(
-                            queue[d], part[d + 1] - part[d],
-                            hostptr ? hostptr + part[d] : 0, flags)
-                        );
+            for(unsigned d = 0; d < queue.size(); d++) {
+                size_t n = part[d + 1] - part[d];
+
+                if (hostptr && n && backend::is_sub_device(queue[d])) {
+                    // Memory of a CPU sub-device should be first touched
+                    // by the sub-device itself, so that it ends up in the
+                    // sub-device's NUMA domain. So the host data is copied
+                    // into the buffer with a kernel (which needs the buffer
+                    // to be writable).
+                    buf.push_back(backend::device_vector<T>(queue[d], n, 0,
+                                backend::MEM_READ_WRITE));
+
+                    backend::device_vector<T> tmp(queue[d], n, hostptr + part[d]);
+                    vector(queue[d], buf[d], n) = vector(queue[d], tmp, n);
+                } else {
+                    buf.push_back(
+                            backend::device_vector<T>(
+                                queue[d], n, hostptr ? hostptr + part[d] : 0, flags)
+                            );
+                }
+            }
         }
 
         template <typename S, size_t N>
@@ -43,9 +43,13 @@ THE SOFTWARE.
 #include <vexcl/temporary.hpp>
 #include <vexcl/cast.hpp>
 #include <vexcl/multivector.hpp>
+#include <vexcl/dynamic_multivector.hpp>
+#include <vexcl/dense.hpp>
+#include <vexcl/batched.hpp>
 #include <vexcl/reductor.hpp>
 #include <vexcl/spmat.hpp>
 #include <vexcl/stencil.hpp>
+#include <vexcl/solver.hpp>
 #include <vexcl/gather.hpp>
 #include <vexcl/random.hpp>
 #include <vexcl/fft.hpp>
@@ -55,6 +59,7 @@ THE SOFTWARE.
 #include <vexcl/sort.hpp>
 #include <vexcl/scan.hpp>
 #include <vexcl/reduce_by_key.hpp>
+#include <vexcl/stream.hpp>
 #include <vexcl/profiler.hpp>
 
 #endif